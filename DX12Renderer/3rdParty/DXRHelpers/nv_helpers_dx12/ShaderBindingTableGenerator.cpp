@@ -35,6 +35,7 @@ dispatch rays description.
 */
 
 #include "ShaderBindingTableGenerator.h"
+#include "Helpers/WriteCombinedCopy.h"
 #include <string>
 #include  <stdexcept>
 
@@ -114,17 +115,26 @@ void ShaderBindingTableGenerator::Generate(ID3D12Resource* sbtBuffer,
   {
     throw std::logic_error("Could not map the shader binding table");
   }
+  // The SBT buffer is write-combined memory, so the table is built in regular memory first
+  // and streamed into the buffer with a single copy. The staging buffer keeps its capacity
+  // between calls
+  m_sbtData.resize(m_rayGenEntrySize * m_rayGen.size() + m_missEntrySize * m_miss.size() +
+                   m_hitGroupEntrySize * m_hitGroup.size());
+  uint8_t* pStaging = m_sbtData.data();
+
   // Copy the shader identifiers followed by their resource pointers or root constants: first the
   // ray generation, then the miss shaders, and finally the set of hit groups
   uint32_t offset = 0;
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_rayGen, m_rayGenEntrySize);
-  pData += offset;
+  offset = CopyShaderData(raytracingPipeline, pStaging, m_rayGen, m_rayGenEntrySize);
+  pStaging += offset;
+
+  offset = CopyShaderData(raytracingPipeline, pStaging, m_miss, m_missEntrySize);
+  pStaging += offset;
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_miss, m_missEntrySize);
-  pData += offset;
+  offset = CopyShaderData(raytracingPipeline, pStaging, m_hitGroup, m_hitGroupEntrySize);
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_hitGroup, m_hitGroupEntrySize);
+  DDM::WriteCombined::Copy(pData, m_sbtData.data(), m_sbtData.size());
 
   // Unmap the SBT
   sbtBuffer->Unmap(0, nullptr);
@@ -196,5 +196,9 @@ private:
   /// The program names are translated into program identifiers.The size in bytes of an identifier
   /// is provided by the device and is the same for all categories.
   UINT m_progIdSize;
+
+  /// The SBT is built in this buffer before it is streamed into the write-combined SBT buffer.
+  /// It is kept between calls, so regenerating the SBT does not allocate
+  std::vector<uint8_t> m_sbtData;
 };
 } // namespace nv_helpers_dx12
@@ -46,7 +46,9 @@ buffer needs to be kept until the command list execution is finished.
 */
 
 #include "TopLevelASGenerator.h"
+#include "Helpers/WriteCombinedCopy.h"
 #include  <stdexcept>
+#include <vector>
 
 // Helper to compute aligned buffer sizes
 #ifndef ROUND_UP
@@ -161,9 +163,9 @@ void TopLevelASGenerator::Generate(
 )
 {
   // Copy the descriptors in the target descriptor buffer
-  D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs;
-  descriptorsBuffer->Map(0, nullptr, reinterpret_cast<void**>(&instanceDescs));
-  if (!instanceDescs)
+  D3D12_RAYTRACING_INSTANCE_DESC* mappedDescs;
+  descriptorsBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedDescs));
+  if (!mappedDescs)
   {
     throw std::logic_error("Cannot map the instance descriptor buffer - is it "
                            "in the upload heap?");
@@ -171,11 +173,11 @@ void TopLevelASGenerator::Generate(
 
   auto instanceCount = static_cast<UINT>(m_instances.size());
 
-  // Initialize the memory to zero on the first time only
-  if (!updateOnly)
-  {
-    ZeroMemory(instanceDescs, m_instanceDescsSizeInBytes);
-  }
+  // The descriptor buffer is write-combined memory, so the descriptors are built in
+  // regular memory first and streamed into the buffer with a single copy. The staging
+  // buffer keeps its capacity between calls
+  m_instanceDescs.resize(instanceCount);
+  D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs = m_instanceDescs.data();
 
   // Create the description for each instance
   for (uint32_t i = 0; i < instanceCount; i++)
@@ -198,6 +200,16 @@ void TopLevelASGenerator::Generate(
     instanceDescs[i].InstanceMask = 0xFF;
   }
 
+  size_t instanceDescsSize = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instanceCount;
+  DDM::WriteCombined::Copy(mappedDescs, instanceDescs, instanceDescsSize);
+
+  // Initialize the padding after the descriptors to zero on the first time only
+  if (!updateOnly)
+  {
+    ZeroMemory(reinterpret_cast<uint8_t*>(mappedDescs) + instanceDescsSize,
+               m_instanceDescsSizeInBytes - instanceDescsSize);
+  }
+
   descriptorsBuffer->Unmap(0, nullptr);
 
   // If this in an update operation we need to provide the source buffer
@@ -157,5 +157,10 @@ private:
   UINT64 m_instanceDescsSizeInBytes;
   /// Size of the buffer containing the TLAS
   UINT64 m_resultSizeInBytes;
+
+  /// The instance descriptors are built in this buffer before they are streamed into the
+  /// write-combined descriptor buffer. It is kept between calls, so per-frame updates do not
+  /// allocate
+  std::vector<D3D12_RAYTRACING_INSTANCE_DESC> m_instanceDescs;
 };
 } // namespace nv_helpers_dx12
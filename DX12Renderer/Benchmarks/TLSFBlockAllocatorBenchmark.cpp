@@ -0,0 +1,258 @@
+// TLSFBlockAllocatorBenchmark.cpp
+
+/**
+ * Compares the TLSF block manager of the descriptor allocator pages with the
+ * map-based free list it replaced.
+ *
+ * Both allocators replay the same sequence of allocations and frees on a range
+ * the size of a descriptor page. Most requests are small (single descriptors and
+ * short tables), a few are large, which is the mix a renderer produces.
+ * Reports the time per operation and the number of requests that could not be
+ * satisfied, which shows how well each free list resists fragmentation.
+ */
+
+// File includes
+#include "Application/DescriptorAllocator/TLSFBlockAllocator.h"
+
+// Standard library includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// The free list of DescriptorAllocatorPage before it was replaced by the TLSF block manager.
+	class MapFreeList final
+	{
+	public:
+		explicit MapFreeList(uint32_t numElements)
+		{
+			AddNewBlock(0, numElements);
+		}
+
+		uint32_t Allocate(uint32_t size)
+		{
+			auto smallestBlockIt = m_FreeListBySize.lower_bound(size);
+			if (smallestBlockIt == m_FreeListBySize.end())
+			{
+				return DDM::TLSFBlockAllocator::InvalidOffset;
+			}
+
+			uint32_t blockSize = smallestBlockIt->first;
+			auto offsetIt = smallestBlockIt->second;
+			uint32_t offset = offsetIt->first;
+
+			m_FreeListBySize.erase(smallestBlockIt);
+			m_FreeListByOffset.erase(offsetIt);
+
+			if (blockSize > size)
+			{
+				AddNewBlock(offset + size, blockSize - size);
+			}
+
+			return offset;
+		}
+
+		void Free(uint32_t offset, uint32_t size)
+		{
+			auto nextBlockIt = m_FreeListByOffset.upper_bound(offset);
+
+			auto prevBlockIt = nextBlockIt;
+			if (prevBlockIt != m_FreeListByOffset.begin())
+			{
+				--prevBlockIt;
+			}
+			else
+			{
+				prevBlockIt = m_FreeListByOffset.end();
+			}
+
+			if (prevBlockIt != m_FreeListByOffset.end() &&
+				offset == prevBlockIt->first + prevBlockIt->second.Size)
+			{
+				offset = prevBlockIt->first;
+				size += prevBlockIt->second.Size;
+
+				m_FreeListBySize.erase(prevBlockIt->second.FreeListBySizeIt);
+				m_FreeListByOffset.erase(prevBlockIt);
+			}
+
+			if (nextBlockIt != m_FreeListByOffset.end() &&
+				offset + size == nextBlockIt->first)
+			{
+				size += nextBlockIt->second.Size;
+
+				m_FreeListBySize.erase(nextBlockIt->second.FreeListBySizeIt);
+				m_FreeListByOffset.erase(nextBlockIt);
+			}
+
+			AddNewBlock(offset, size);
+		}
+
+	private:
+		struct FreeBlockInfo;
+		using FreeListByOffset = std::map<uint32_t, FreeBlockInfo>;
+		using FreeListBySize = std::multimap<uint32_t, FreeListByOffset::iterator>;
+
+		struct FreeBlockInfo
+		{
+			FreeBlockInfo(uint32_t size)
+				: Size(size)
+			{}
+
+			uint32_t Size;
+			FreeListBySize::iterator FreeListBySizeIt;
+		};
+
+		void AddNewBlock(uint32_t offset, uint32_t size)
+		{
+			auto offsetIt = m_FreeListByOffset.emplace(offset, size);
+			auto sizeIt = m_FreeListBySize.emplace(size, offsetIt.first);
+			offsetIt.first->second.FreeListBySizeIt = sizeIt;
+		}
+
+		FreeListByOffset m_FreeListByOffset;
+		FreeListBySize m_FreeListBySize;
+	};
+
+	struct Operation
+	{
+		// Zero for a free.
+		uint32_t Size;
+		// Selects the live allocation that is freed.
+		uint32_t Selector;
+	};
+
+	struct Result
+	{
+		double NanosecondsPerOperation;
+		uint32_t NumFailedAllocations;
+	};
+
+	constexpr uint32_t NumElements = 1024;
+	constexpr uint32_t NumOperations = 1 << 20;
+	constexpr int NumRepetitions = 5;
+
+	std::vector<Operation> GenerateOperations()
+	{
+		std::mt19937 generator(1234);
+		std::uniform_int_distribution<uint32_t> percentage(0, 99);
+		std::uniform_int_distribution<uint32_t> smallSize(2, 8);
+		std::uniform_int_distribution<uint32_t> largeSize(9, 64);
+		std::uniform_int_distribution<uint32_t> selector;
+
+		std::vector<Operation> operations(NumOperations);
+		for (Operation& operation : operations)
+		{
+			uint32_t roll = percentage(generator);
+			if (roll < 48)
+			{
+				operation.Size = 0;
+			}
+			else if (roll < 78)
+			{
+				operation.Size = 1;
+			}
+			else if (roll < 96)
+			{
+				operation.Size = smallSize(generator);
+			}
+			else
+			{
+				operation.Size = largeSize(generator);
+			}
+
+			operation.Selector = selector(generator);
+		}
+
+		return operations;
+	}
+
+	template<typename FreeList>
+	Result Run(const std::vector<Operation>& operations)
+	{
+		struct Allocation
+		{
+			uint32_t Offset;
+			uint32_t Size;
+		};
+
+		Result result = { 0.0, 0 };
+		double bestNanoseconds = 0.0;
+
+		std::vector<Allocation> allocations;
+		allocations.reserve(NumElements);
+
+		for (int repetition = 0; repetition < NumRepetitions; ++repetition)
+		{
+			FreeList freeList(NumElements);
+			allocations.clear();
+			uint32_t numFailedAllocations = 0;
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (const Operation& operation : operations)
+			{
+				if (operation.Size == 0)
+				{
+					if (allocations.empty())
+					{
+						continue;
+					}
+
+					size_t index = operation.Selector % allocations.size();
+					freeList.Free(allocations[index].Offset, allocations[index].Size);
+					allocations[index] = allocations.back();
+					allocations.pop_back();
+				}
+				else
+				{
+					uint32_t offset = freeList.Allocate(operation.Size);
+					if (offset == DDM::TLSFBlockAllocator::InvalidOffset)
+					{
+						++numFailedAllocations;
+						continue;
+					}
+
+					allocations.push_back({ offset, operation.Size });
+				}
+			}
+
+			auto end = std::chrono::steady_clock::now();
+
+			double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+			if (repetition == 0 || nanoseconds < bestNanoseconds)
+			{
+				bestNanoseconds = nanoseconds;
+			}
+
+			result.NumFailedAllocations = numFailedAllocations;
+		}
+
+		result.NanosecondsPerOperation = bestNanoseconds / operations.size();
+
+		return result;
+	}
+
+	void Print(const char* name, const Result& result)
+	{
+		std::printf("%-24s %8.2f ns/op %10u failed allocations\n",
+			name, result.NanosecondsPerOperation, result.NumFailedAllocations);
+	}
+}
+
+int main()
+{
+	std::vector<Operation> operations = GenerateOperations();
+
+	std::printf("%u operations on a range of %u elements, best of %d runs\n",
+		NumOperations, NumElements, NumRepetitions);
+
+	Print("Map free list", Run<MapFreeList>(operations));
+	Print("TLSF block allocator", Run<DDM::TLSFBlockAllocator>(operations));
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+// WriteCombinedCopyBenchmark.cpp
+
+/**
+ * Measures the copy kernels of WriteCombinedCopy.h against memcpy.
+ *
+ * Every kernel copies buffers from 4KB to 64MB into two kinds of destination
+ * memory: ordinary cached memory and write-combined memory, which is how the
+ * CPU sees a mapped upload heap. The best throughput of a number of runs is
+ * reported in GB/s.
+ */
+
+// File includes
+#include "Helpers/WriteCombinedCopy.h"
+
+// Standard library includes
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+namespace
+{
+	using CopyFunction = void(*)(void*, const void*, size_t);
+
+	struct Kernel
+	{
+		const char* Name;
+		CopyFunction Function;
+	};
+
+	// Destination memory of the copies.
+	struct DestinationMemory
+	{
+		const char* Name;
+		uint8_t* pData;
+	};
+
+	constexpr size_t MaxCopySize = size_t(64) << 20;
+	// Copy at least this many bytes per measurement, so small copies are timed over many calls.
+	constexpr size_t MinBytesPerRun = size_t(256) << 20;
+	constexpr int NumRuns = 5;
+
+	void CopyMemcpy(void* destination, const void* source, size_t sizeInBytes)
+	{
+		std::memcpy(destination, source, sizeInBytes);
+	}
+
+	uint8_t* AllocateWriteCombined(size_t sizeInBytes)
+	{
+#if defined(_WIN32)
+		return static_cast<uint8_t*>(::VirtualAlloc(nullptr, sizeInBytes, MEM_COMMIT | MEM_RESERVE,
+			PAGE_READWRITE | PAGE_WRITECOMBINE));
+#else
+		(void)sizeInBytes;
+		return nullptr;
+#endif
+	}
+
+	void FreeWriteCombined(uint8_t* pData)
+	{
+#if defined(_WIN32)
+		if (pData)
+		{
+			::VirtualFree(pData, 0, MEM_RELEASE);
+		}
+#else
+		(void)pData;
+#endif
+	}
+
+	double MeasureGigabytesPerSecond(CopyFunction copy, uint8_t* pDestination, const uint8_t* pSource, size_t copySize)
+	{
+		size_t numCopies = std::max<size_t>(1, MinBytesPerRun / copySize);
+		double bestSeconds = 0.0;
+
+		for (int run = 0; run < NumRuns; ++run)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			for (size_t i = 0; i < numCopies; ++i)
+			{
+				copy(pDestination, pSource, copySize);
+			}
+
+			auto end = std::chrono::steady_clock::now();
+
+			double seconds = std::chrono::duration<double>(end - start).count();
+			if (run == 0 || seconds < bestSeconds)
+			{
+				bestSeconds = seconds;
+			}
+		}
+
+		return static_cast<double>(numCopies * copySize) / bestSeconds * 1e-9;
+	}
+}
+
+int main()
+{
+	using namespace DDM::WriteCombined;
+
+	// The scalar kernel is memcpy.
+	std::vector<Kernel> kernels = { { "memcpy", CopyMemcpy } };
+#if DDM_WRITE_COMBINED_X86
+	CopyKernel detectedKernel = DetectCopyKernel();
+	if (detectedKernel == CopyKernel::SSE2 || detectedKernel == CopyKernel::AVX2)
+	{
+		kernels.push_back({ "SSE2", CopySSE2 });
+	}
+	if (detectedKernel == CopyKernel::AVX2)
+	{
+		kernels.push_back({ "AVX2", CopyAVX2 });
+	}
+#endif
+
+	std::vector<uint8_t> source(MaxCopySize);
+	for (size_t i = 0; i < source.size(); ++i)
+	{
+		source[i] = static_cast<uint8_t>(i * 31);
+	}
+
+	std::vector<uint8_t> cachedDestination(MaxCopySize);
+	uint8_t* pWriteCombinedDestination = AllocateWriteCombined(MaxCopySize);
+
+	std::vector<DestinationMemory> destinations = { { "cached", cachedDestination.data() } };
+	if (pWriteCombinedDestination)
+	{
+		destinations.push_back({ "write-combined", pWriteCombinedDestination });
+	}
+	else
+	{
+		std::printf("Write-combined memory is not available, only cached memory is measured.\n");
+	}
+
+	for (const DestinationMemory& destination : destinations)
+	{
+		std::printf("\nDestination: %s memory (GB/s, best of %d runs)\n", destination.Name, NumRuns);
+
+		std::printf("%10s", "size");
+		for (const Kernel& kernel : kernels)
+		{
+			std::printf("%10s", kernel.Name);
+		}
+		std::printf("\n");
+
+		for (size_t copySize = size_t(4) << 10; copySize <= MaxCopySize; copySize *= 4)
+		{
+			if (copySize >= (size_t(1) << 20))
+			{
+				std::printf("%8zuMB", copySize >> 20);
+			}
+			else
+			{
+				std::printf("%8zuKB", copySize >> 10);
+			}
+
+			for (const Kernel& kernel : kernels)
+			{
+				std::printf("%10.2f", MeasureGigabytesPerSecond(kernel.Function, destination.pData, source.data(), copySize));
+			}
+			std::printf("\n");
+		}
+	}
+
+	FreeWriteCombined(pWriteCombinedDestination);
+
+	return 0;
+}
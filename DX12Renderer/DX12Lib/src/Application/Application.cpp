@@ -9,6 +9,13 @@
 #include "Helpers/DirectXHelpers.h"
 #include "Events.h"
 #include "CommandQueue.h"
+#include "UploadRingBuffer.h"
+#include "DynamicDescriptorHeap.h"
+#include "DescriptorAllocator/BindlessDescriptorHeap.h"
+#include "DescriptorAllocator/DescriptorAllocator.h"
+#include "DescriptorAllocator/ViewDescriptorCache.h"
+#include "UploadManager.h"
+#include "Resources/ResourceStateTracker.h"
 #include "Games/Game.h"
 
 static std::shared_ptr<DDM::Window> gs_Window;
@@ -48,9 +55,24 @@ bool DDM::Application::Initialize(HINSTANCE hInst)
     EnableDebugLayer();
 
     m_Device = CreateDevice(GetAdapter(m_UseWarp));
+
+    if (m_UseEnhancedBarriers)
+    {
+        ResourceStateTracker::SetBarrierBackend(ResourceStateTracker::BarrierBackend::Enhanced);
+    }
     
     m_pDirectCommandQueue = std::make_unique<DDM::CommandQueue>(m_Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
     m_pCopyCommandQueue = std::make_unique<DDM::CommandQueue>(m_Device, D3D12_COMMAND_LIST_TYPE_COPY);
+    m_pComputeCommandQueue = std::make_unique<DDM::CommandQueue>(m_Device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+    {
+        m_DescriptorAllocators[i] = std::make_unique<DescriptorAllocator>(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(i));
+    }
+
+    m_pViewDescriptorCache = std::make_unique<ViewDescriptorCache>();
+
+    m_pUploadManager = std::make_unique<UploadManager>(m_pCopyCommandQueue.get());
 
     return true;
 }
@@ -58,12 +80,27 @@ bool DDM::Application::Initialize(HINSTANCE hInst)
 void DDM::Application::ShutDown()
 {
     DestroyWindow();
-    m_Device.Reset();
+    // Submits the uploads that are still pending, which may create command lists through the device.
+    m_pUploadManager.reset();
     m_pDirectCommandQueue->Flush();
     m_pCopyCommandQueue->Flush();
+    m_pComputeCommandQueue->Flush();
+    // Resources may outlive the application and free their bindless descriptors later.
+    if (m_pBindlessDescriptorHeap)
+    {
+        m_pBindlessDescriptorHeap->ReleaseCommandQueues();
+    }
+    m_pBindlessDescriptorHeap.reset();
+    m_pViewDescriptorCache.reset();
+    for (auto& descriptorAllocator : m_DescriptorAllocators)
+    {
+        descriptorAllocator.reset();
+    }
     m_pDirectCommandQueue.reset();
     m_pCopyCommandQueue.reset();
-
+    m_pComputeCommandQueue.reset();
+    // Released last, everything above may still use the device.
+    m_Device.Reset();
 }
 
 int DDM::Application::Run(std::shared_ptr<Game> pGame)
@@ -85,6 +122,7 @@ int DDM::Application::Run(std::shared_ptr<Game> pGame)
 
     m_pDirectCommandQueue->Flush();
     m_pCopyCommandQueue->Flush();
+    m_pComputeCommandQueue->Flush();
 
     pGame->UnloadContent();
     pGame->Destroy();
@@ -103,6 +141,10 @@ void DDM::Application::ParseCommandLineArguments()
         {
             m_UseWarp = true;
         }
+        if (::wcscmp(argv[i], L"-enhancedbarriers") == 0 || ::wcscmp(argv[i], L"--enhancedbarriers") == 0)
+        {
+            m_UseEnhancedBarriers = true;
+        }
     }
 
     // Free memory allocated by CommandLineToArgvW
@@ -163,6 +205,9 @@ DDM::CommandQueue* DDM::Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE typ
     case D3D12_COMMAND_LIST_TYPE_COPY:
         return m_pCopyCommandQueue.get();
         break;
+    case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+        return m_pComputeCommandQueue.get();
+        break;
     }
 
 
@@ -176,8 +221,89 @@ ComPtr<ID3D12Device5> DDM::Application::GetDevice()
 
 void DDM::Application::Flush()
 {
+    if (m_pUploadManager)
+    {
+        m_pUploadManager->Submit();
+    }
+
     m_pDirectCommandQueue->Flush();
     m_pCopyCommandQueue->Flush();
+    m_pComputeCommandQueue->Flush();
+}
+
+void DDM::Application::EndFrame()
+{
+    // Uploads of this frame that did not fill a batch are submitted here.
+    m_pUploadManager->Submit();
+
+    m_pDirectCommandQueue->GetUploadRingBuffer()->EndFrame();
+    m_pCopyCommandQueue->GetUploadRingBuffer()->EndFrame();
+    m_pComputeCommandQueue->GetUploadRingBuffer()->EndFrame();
+
+    DynamicDescriptorHeap::EndFrame();
+    ResourceStateTracker::EndFrame();
+
+    // The descriptors that were freed in this frame are released once every queue has
+    // completed the work it was given so far, on the retirement thread of the last queue.
+    uint64_t frameNumber = m_FrameNumber++;
+
+    CommandQueue* commandQueues[] = { m_pDirectCommandQueue.get(), m_pCopyCommandQueue.get(), m_pComputeCommandQueue.get() };
+    auto numPendingQueues = std::make_shared<std::atomic<uint32_t>>(static_cast<uint32_t>(std::size(commandQueues)));
+
+    for (auto commandQueue : commandQueues)
+    {
+        commandQueue->AddCompletionCallback(commandQueue->GetNextFenceValue() - 1, [this, frameNumber, numPendingQueues]()
+            {
+                if (--*numPendingQueues == 0)
+                {
+                    ReleaseStaleDescriptors(frameNumber);
+                }
+            });
+    }
+
+    if (m_pBindlessDescriptorHeap)
+    {
+        m_pBindlessDescriptorHeap->ReleaseStaleDescriptors();
+    }
+}
+
+DDM::DescriptorAllocation DDM::Application::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors)
+{
+    return m_DescriptorAllocators[type]->Allocate(numDescriptors);
+}
+
+void DDM::Application::ReleaseStaleDescriptors(uint64_t finishedFrame)
+{
+    for (auto& descriptorAllocator : m_DescriptorAllocators)
+    {
+        descriptorAllocator->ReleaseStaleDescriptors(finishedFrame);
+    }
+}
+
+DDM::ViewDescriptorCache* DDM::Application::GetViewDescriptorCache() const
+{
+    return m_pViewDescriptorCache.get();
+}
+
+DDM::UploadManager* DDM::Application::GetUploadManager() const
+{
+    return m_pUploadManager.get();
+}
+
+void DDM::Application::EnableBindlessDescriptors(uint32_t numDescriptors)
+{
+    assert(!m_pBindlessDescriptorHeap && "Bindless descriptors are already enabled.");
+
+    // Shaders access the views from the direct and compute queues, so a descriptor is only reused once
+    // the fences of both have completed. Copy command lists can not bind descriptor heaps.
+    CommandQueue* commandQueues[] = { m_pDirectCommandQueue.get(), m_pComputeCommandQueue.get() };
+
+    m_pBindlessDescriptorHeap = std::make_shared<BindlessDescriptorHeap>(commandQueues, numDescriptors);
+}
+
+DDM::BindlessDescriptorHeap* DDM::Application::GetBindlessDescriptorHeap() const
+{
+    return m_pBindlessDescriptorHeap.get();
 }
 
 uint32_t DDM::Application::GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type)
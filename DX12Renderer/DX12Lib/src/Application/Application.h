@@ -7,9 +7,11 @@
 #include "../Includes/DirectXIncludes.h"
 #include "Singleton.h"
 #include "CommandQueue.h"
+#include "DescriptorAllocator/DescriptorAllocation.h"
 
 // Standard library includes
 #include <memory> // For std::unique_ptr
+#include <atomic> // For std::atomic
 #include <Windows.h>
 #include <inttypes.h>
 #include <vector>
@@ -21,6 +23,10 @@ namespace DDM
 {
 	class Window;
 	class Game;
+	class BindlessDescriptorHeap;
+	class DescriptorAllocator;
+	class ViewDescriptorCache;
+	class UploadManager;
 
 	class Application final : public Singleton<Application>
 	{
@@ -49,8 +55,42 @@ namespace DDM
 
 		void Flush();
 
+		// Called once the game has rendered a frame.
+		// Updates the upload memory and descriptor copy counters and releases upload heaps that are no longer needed.
+		void EndFrame();
+
+		/**
+		 * Allocate a number of CPU visible descriptors.
+		 */
+		DescriptorAllocation AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors = 1);
+
+		/**
+		 * Release stale descriptors. This should only be called with a completed frame counter.
+		 */
+		void ReleaseStaleDescriptors(uint64_t finishedFrame);
+
+		// The cache of the views that were created for resources.
+		ViewDescriptorCache* GetViewDescriptorCache() const;
+
+		// Uploads buffers on the copy queue, the pending uploads are submitted at the end of every frame.
+		UploadManager* GetUploadManager() const;
+
+		/**
+		 * Opt in to bindless rendering. Creates the shader visible descriptor heap
+		 * in which resources write their views when they are created.
+		 * Must be called before the resources that should be bindless are created.
+		 */
+		void EnableBindlessDescriptors(uint32_t numDescriptors = 65536);
+
+		// Get the bindless descriptor heap, nullptr if bindless rendering is not enabled.
+		BindlessDescriptorHeap* GetBindlessDescriptorHeap() const;
+
 		UINT FrameCount() const { return m_FrameCount; }
 
+		// The number of the frame that is being recorded, incremented by EndFrame.
+		// Descriptors that are freed are released once the submissions of their frame have completed.
+		uint64_t GetFrameNumber() const { return m_FrameNumber; }
+
 		uint32_t GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type);
 		
 		void QueryRaytracingSupport();
@@ -58,6 +98,8 @@ namespace DDM
 		// Number of frames in flight.
 		const UINT m_FrameCount = 3;
 
+		std::atomic<uint64_t> m_FrameNumber = 0;
+
 		std::wstring m_WindowClassName = L"DX12WindowClass";
 		
 		HINSTANCE m_Instance = nullptr;
@@ -65,11 +107,24 @@ namespace DDM
 		// Use WARP adapter
 		bool m_UseWarp = false;
 
+		// Record barriers with the enhanced barrier API if the device supports it
+		bool m_UseEnhancedBarriers = false;
+
 		// DirectX 12 Objects
 		ComPtr<ID3D12Device5> m_Device;
 
 		std::unique_ptr<CommandQueue> m_pDirectCommandQueue;
 		std::unique_ptr<CommandQueue> m_pCopyCommandQueue;
+		std::unique_ptr<CommandQueue> m_pComputeCommandQueue;
+
+		std::unique_ptr<DescriptorAllocator> m_DescriptorAllocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+
+		std::unique_ptr<ViewDescriptorCache> m_pViewDescriptorCache;
+
+		std::unique_ptr<UploadManager> m_pUploadManager;
+
+		// Shared by the descriptors that were allocated from it.
+		std::shared_ptr<BindlessDescriptorHeap> m_pBindlessDescriptorHeap;
 
 		void ParseCommandLineArguments();
 
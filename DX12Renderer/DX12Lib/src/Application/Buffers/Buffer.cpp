@@ -1,5 +1,10 @@
 #include "Buffer.h"
 
+#include "Application/Application.h"
+#include "Application/DescriptorAllocator/ViewDescriptorCache.h"
+
+#include <cassert>
+
 DDM::Buffer::Buffer(const std::wstring& name)
 	:Resource(name)
 {
@@ -9,3 +14,80 @@ DDM::Buffer::Buffer(const D3D12_RESOURCE_DESC& resDesc, size_t numElements, size
 	: Resource(resDesc, nullptr, name)
 {
 }
+
+void DDM::Buffer::CreateBindlessByteAddressView()
+{
+	if (!m_d3d12Resource)
+	{
+		return;
+	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = GetByteAddressShaderResourceViewDesc();
+
+	CreateBindlessShaderResourceView(&srvDesc);
+}
+
+D3D12_SHADER_RESOURCE_VIEW_DESC DDM::Buffer::GetByteAddressShaderResourceViewDesc() const
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = static_cast<UINT>(m_d3d12Resource->GetDesc().Width / 4);
+	srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+
+	return srvDesc;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::Buffer::GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc) const
+{
+	// Buffers have no default view.
+	if (!srvDesc)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC byteAddressDesc = GetByteAddressShaderResourceViewDesc();
+		return Resource::GetShaderResourceView(&byteAddressDesc);
+	}
+
+	return Resource::GetShaderResourceView(srvDesc);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::Buffer::GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc) const
+{
+	if (!uavDesc)
+	{
+		D3D12_UNORDERED_ACCESS_VIEW_DESC byteAddressDesc = {};
+		byteAddressDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		byteAddressDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		byteAddressDesc.Buffer.FirstElement = 0;
+		byteAddressDesc.Buffer.NumElements = static_cast<UINT>(m_d3d12Resource->GetDesc().Width / 4);
+		byteAddressDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+
+		return Resource::GetUnorderedAccessView(&byteAddressDesc);
+	}
+
+	return Resource::GetUnorderedAccessView(uavDesc);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::Buffer::GetConstantBufferView(uint64_t offsetInBytes, uint32_t sizeInBytes) const
+{
+	assert(m_d3d12Resource && "The buffer has no views.");
+
+	uint64_t bufferSize = m_d3d12Resource->GetDesc().Width;
+	if (sizeInBytes == 0)
+	{
+		sizeInBytes = static_cast<uint32_t>(bufferSize - offsetInBytes);
+	}
+
+	assert(offsetInBytes % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT == 0 &&
+		sizeInBytes % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT == 0 &&
+		offsetInBytes + sizeInBytes <= bufferSize && "Constant buffer views are 256 byte aligned.");
+
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress() + offsetInBytes;
+	cbvDesc.SizeInBytes = sizeInBytes;
+
+	// The cache keeps the view alive together with the resource.
+	auto view = Application::Get().GetViewDescriptorCache()->GetConstantBufferView(m_d3d12Resource.Get(), cbvDesc);
+	return view->GetDescriptorHandle();
+}
@@ -50,7 +50,40 @@ namespace DDM
          */
         virtual void CreateViews(size_t numElements, size_t elementSize) = 0;
 
+        /**
+         * Get a SRV of the buffer.
+         *
+         * @param srvDesc The description of the SRV, the default is nullptr which
+         * returns a raw (ByteAddressBuffer) view of the whole buffer.
+         */
+        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc = nullptr) const override;
+
+        /**
+         * Get a UAV of the buffer.
+         *
+         * @param uavDesc The description of the UAV, the default is nullptr which
+         * returns a raw (RWByteAddressBuffer) view of the whole buffer.
+         */
+        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc = nullptr) const override;
+
+        /**
+         * Get a CBV of a range of the buffer.
+         *
+         * @param offsetInBytes The start of the range, a multiple of 256 bytes.
+         * @param sizeInBytes The size of the range, a multiple of 256 bytes.
+         * The default is 0, which views the rest of the buffer.
+         */
+        D3D12_CPU_DESCRIPTOR_HANDLE GetConstantBufferView(uint64_t offsetInBytes = 0, uint32_t sizeInBytes = 0) const;
+
     protected:
+        /**
+         * Write a raw (ByteAddressBuffer) view of the whole buffer into the bindless
+         * descriptor heap, if bindless descriptors are enabled.
+         */
+        void CreateBindlessByteAddressView();
+
+        // The description of a raw view of the whole buffer.
+        D3D12_SHADER_RESOURCE_VIEW_DESC GetByteAddressShaderResourceViewDesc() const;
 
     private:
 
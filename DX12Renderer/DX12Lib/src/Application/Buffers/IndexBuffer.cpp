@@ -22,14 +22,6 @@ void DDM::IndexBuffer::CreateViews(size_t numElements, size_t elementSize)
 	m_IndexBufferView.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress();
 	m_IndexBufferView.SizeInBytes = static_cast<UINT>(numElements * elementSize);
 	m_IndexBufferView.Format = m_IndexFormat;
-}
 
-D3D12_CPU_DESCRIPTOR_HANDLE DDM::IndexBuffer::GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc) const
-{
-	throw std::exception("IndexBuffer::GetShaderResourceView should not be called.");
-}
-
-D3D12_CPU_DESCRIPTOR_HANDLE DDM::IndexBuffer::GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc) const
-{
-	throw std::exception("IndexBuffer::GetUnorderedAccessView should not be called.");
+	CreateBindlessByteAddressView();
 }
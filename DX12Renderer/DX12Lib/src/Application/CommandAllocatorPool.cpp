@@ -0,0 +1,225 @@
+// CommandAllocatorPool.cpp
+
+// Header include
+#include "CommandAllocatorPool.h"
+
+// File includes
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace
+{
+    // The private data GUID of the pool entry of an allocator, {8E3B6C1F-2A4D-4F7B-B5E9-3C6D0A9F1E42}.
+    constexpr GUID CommandAllocatorEntryGuid = { 0x8e3b6c1f, 0x2a4d, 0x4f7b, { 0xb5, 0xe9, 0x3c, 0x6d, 0x0a, 0x9f, 0x1e, 0x42 } };
+
+    std::atomic<uint64_t> s_NextPoolId = 1;
+}
+
+DDM::CommandAllocatorPool::CommandAllocatorPool(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+    : m_Id(s_NextPoolId++)
+    , m_d3d12Device(device)
+    , m_CommandListType(type)
+    , m_NumCommandAllocators(0)
+    , m_NumCommandAllocatorsInFlight(0)
+    , m_NumCreated(0)
+    , m_NumReused(0)
+{
+}
+
+DDM::CommandAllocatorPool::~CommandAllocatorPool()
+{
+}
+
+Microsoft::WRL::ComPtr<ID3D12CommandAllocator> DDM::CommandAllocatorPool::Acquire(uint64_t completedFenceValue)
+{
+    ThreadPool& threadPool = GetThreadPool();
+
+    // Take over the allocators that were returned since the last call.
+    Entry* returnedEntry = threadPool.ReturnedEntries.exchange(nullptr, std::memory_order_acquire);
+    while (returnedEntry)
+    {
+        threadPool.RetiredEntries.push_back(returnedEntry);
+        returnedEntry = returnedEntry->Next;
+    }
+
+    ++m_NumCommandAllocatorsInFlight;
+
+    // Reuse any completed allocator, the order they were retired in does not matter.
+    // If none has completed, look once more after taking over the allocators of exited threads.
+    auto& retiredEntries = threadPool.RetiredEntries;
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        for (size_t i = 0; i < retiredEntries.size(); ++i)
+        {
+            Entry* entry = retiredEntries[i];
+            if (entry->FenceValue <= completedFenceValue)
+            {
+                retiredEntries[i] = retiredEntries.back();
+                retiredEntries.pop_back();
+
+                ThrowIfFailed(entry->CommandAllocator->Reset());
+                ++m_NumReused;
+
+                return entry->CommandAllocator;
+            }
+        }
+
+        if (attempt == 0 && !AdoptOrphanedEntries(threadPool))
+        {
+            break;
+        }
+    }
+
+    auto entry = std::make_unique<Entry>();
+    ThrowIfFailed(m_d3d12Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&entry->CommandAllocator)));
+    entry->FenceValue = 0;
+    entry->Owner = &threadPool;
+    entry->Next = nullptr;
+
+    Entry* pEntry = entry.get();
+    ThrowIfFailed(entry->CommandAllocator->SetPrivateData(CommandAllocatorEntryGuid, sizeof(pEntry), &pEntry));
+
+    threadPool.Entries.push_back(std::move(entry));
+
+    ++m_NumCommandAllocators;
+    ++m_NumCreated;
+
+    return pEntry->CommandAllocator;
+}
+
+void DDM::CommandAllocatorPool::Retire(ID3D12CommandAllocator* commandAllocator, uint64_t fenceValue)
+{
+    Entry* entry = nullptr;
+    UINT dataSize = sizeof(entry);
+    ThrowIfFailed(commandAllocator->GetPrivateData(CommandAllocatorEntryGuid, &dataSize, &entry));
+    assert(entry && entry->CommandAllocator.Get() == commandAllocator && "The allocator was not acquired from this pool.");
+
+    entry->FenceValue = fenceValue;
+
+    // Push the entry to the returned entries of the owner, which only ever takes all of them at once.
+    std::atomic<Entry*>& returnedEntries = entry->Owner->ReturnedEntries;
+    entry->Next = returnedEntries.load(std::memory_order_relaxed);
+    while (!returnedEntries.compare_exchange_weak(entry->Next, entry, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+void DDM::CommandAllocatorPool::CompleteCommandAllocators(uint32_t numCommandAllocators)
+{
+    assert(m_NumCommandAllocatorsInFlight >= numCommandAllocators && "More allocators completed than were acquired.");
+    m_NumCommandAllocatorsInFlight -= numCommandAllocators;
+}
+
+DDM::CommandAllocatorPool::Statistics DDM::CommandAllocatorPool::GetStatistics() const
+{
+    Statistics statistics = {};
+    statistics.NumCommandAllocators = m_NumCommandAllocators;
+    statistics.NumCommandAllocatorsInFlight = m_NumCommandAllocatorsInFlight;
+    statistics.NumCreated = m_NumCreated;
+    statistics.NumReused = m_NumReused;
+
+    {
+        std::lock_guard<std::mutex> lock(m_ThreadPoolsMutex);
+        statistics.NumThreadPools = static_cast<uint32_t>(m_ThreadPools.size());
+    }
+
+    return statistics;
+}
+
+DDM::CommandAllocatorPool::ThreadPool& DDM::CommandAllocatorPool::GetThreadPool()
+{
+    // The pools of the calling thread, by the id of the command allocator pool they belong to.
+    // When the thread exits, the pools that are still alive are marked as orphaned.
+    struct ThreadPools
+    {
+        struct Registration
+        {
+            ThreadPool* Pool;
+            std::weak_ptr<ThreadPool> WeakPool;
+        };
+
+        ~ThreadPools()
+        {
+            for (auto& [id, registration] : Registrations)
+            {
+                if (auto threadPool = registration.WeakPool.lock())
+                {
+                    threadPool->IsOrphaned.store(true, std::memory_order_release);
+                }
+            }
+        }
+
+        std::unordered_map<uint64_t, Registration> Registrations;
+    };
+    thread_local ThreadPools threadPools;
+
+    auto iter = threadPools.Registrations.find(m_Id);
+    if (iter != threadPools.Registrations.end())
+    {
+        return *iter->second.Pool;
+    }
+
+    // The thread pools are owned by the command allocator pool, so the allocators
+    // outlive the thread that recorded with them.
+    auto threadPool = std::make_shared<ThreadPool>();
+
+    {
+        std::lock_guard<std::mutex> lock(m_ThreadPoolsMutex);
+        m_ThreadPools.push_back(threadPool);
+    }
+
+    threadPools.Registrations.emplace(m_Id, ThreadPools::Registration{ threadPool.get(), threadPool });
+
+    return *threadPool;
+}
+
+bool DDM::CommandAllocatorPool::AdoptOrphanedEntries(ThreadPool& threadPool)
+{
+    std::lock_guard<std::mutex> lock(m_ThreadPoolsMutex);
+
+    bool hasAdopted = false;
+
+    for (auto& orphanedPool : m_ThreadPools)
+    {
+        if (orphanedPool.get() == &threadPool || !orphanedPool->IsOrphaned.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        // The allocators that are still in flight are returned to the orphaned pool, and adopted on a later call.
+        Entry* returnedEntry = orphanedPool->ReturnedEntries.exchange(nullptr, std::memory_order_acquire);
+        while (returnedEntry)
+        {
+            orphanedPool->RetiredEntries.push_back(returnedEntry);
+            returnedEntry = returnedEntry->Next;
+        }
+
+        for (Entry* entry : orphanedPool->RetiredEntries)
+        {
+            auto& entries = orphanedPool->Entries;
+            auto entryIter = std::find_if(entries.begin(), entries.end(),
+                [entry](const std::unique_ptr<Entry>& ownedEntry) { return ownedEntry.get() == entry; });
+            assert(entryIter != entries.end() && "The retired allocator is not owned by its pool.");
+
+            threadPool.Entries.push_back(std::move(*entryIter));
+            *entryIter = std::move(entries.back());
+            entries.pop_back();
+
+            entry->Owner = &threadPool;
+            threadPool.RetiredEntries.push_back(entry);
+            hasAdopted = true;
+        }
+        orphanedPool->RetiredEntries.clear();
+    }
+
+    // Release the orphaned pools that have no allocators left.
+    m_ThreadPools.erase(std::remove_if(m_ThreadPools.begin(), m_ThreadPools.end(),
+        [](const std::shared_ptr<ThreadPool>& pool) { return pool->IsOrphaned.load(std::memory_order_acquire) && pool->Entries.empty(); }),
+        m_ThreadPools.end());
+
+    return hasAdopted;
+}
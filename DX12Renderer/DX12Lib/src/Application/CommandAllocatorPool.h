@@ -0,0 +1,134 @@
+// CommandAllocatorPool.h
+
+/**
+ * Command allocators of a command queue, pooled per recording thread.
+ *
+ * Every thread that gets a command list takes its allocators from a pool of its own,
+ * so threads that record at the same time do not contend for a lock. An allocator is
+ * retired with the fence value of the submission that executes it, possibly on another
+ * thread, and goes back to the pool of the thread that acquired it through a lock-free
+ * list. Any retired allocator of which the fence value has completed is reused, not
+ * just the oldest one, so a single long running submission does not make the pool grow.
+ * When a thread exits, its pool is orphaned, and the threads that run out of allocators
+ * take over the allocators it retired.
+ */
+
+#ifndef _COMMAND_ALLOCATOR_POOL_
+#define _COMMAND_ALLOCATOR_POOL_
+
+// File includes
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DDM
+{
+	class CommandAllocatorPool final
+	{
+	public:
+		// Command allocator counters, for example for a statistics overlay.
+		struct Statistics
+		{
+			// The number of allocators the pool owns.
+			uint32_t NumCommandAllocators;
+			// The number of allocators that are recorded to, or of which the fence value has not completed.
+			uint32_t NumCommandAllocatorsInFlight;
+			// The number of threads that have a pool of their own.
+			uint32_t NumThreadPools;
+			// The number of times an allocator was created, or a completed one was reused.
+			uint64_t NumCreated;
+			uint64_t NumReused;
+		};
+
+		CommandAllocatorPool(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+
+		~CommandAllocatorPool();
+
+		CommandAllocatorPool(CommandAllocatorPool& other) = delete;
+		CommandAllocatorPool(CommandAllocatorPool&& other) = delete;
+
+		CommandAllocatorPool& operator=(CommandAllocatorPool& other) = delete;
+		CommandAllocatorPool& operator=(CommandAllocatorPool&& other) = delete;
+
+		/**
+		 * Get a reset allocator from the pool of the calling thread. A retired allocator is
+		 * reused if its fence value is less than or equal to the completed fence value.
+		 * Otherwise the retired allocators of the pools of exited threads are taken over,
+		 * and only if none of those has completed either, a new allocator is created.
+		 */
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Acquire(uint64_t completedFenceValue);
+
+		/**
+		 * Return an allocator that was acquired from this pool, on any thread.
+		 * The allocator is reused once the fence value has completed.
+		 */
+		void Retire(ID3D12CommandAllocator* commandAllocator, uint64_t fenceValue);
+
+		// Called once the fence values of a number of retired allocators have completed.
+		void CompleteCommandAllocators(uint32_t numCommandAllocators);
+
+		Statistics GetStatistics() const;
+
+	private:
+		struct ThreadPool;
+
+		// An allocator of the pool. Its address is stored in the private data of the allocator.
+		struct Entry
+		{
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocator;
+			uint64_t FenceValue;
+			// The pool of the thread that acquired the allocator.
+			ThreadPool* Owner;
+			// The next entry in the list of allocators that were returned to the owner.
+			Entry* Next;
+		};
+
+		struct ThreadPool
+		{
+			// All allocators of the thread.
+			std::vector<std::unique_ptr<Entry>> Entries;
+			// Retired allocators, only accessed by the thread that owns the pool.
+			std::vector<Entry*> RetiredEntries;
+			// Allocators that are returned by other threads, a lock-free stack.
+			std::atomic<Entry*> ReturnedEntries{ nullptr };
+			// Set when the thread exits. The entries are then only accessed under the thread pools mutex.
+			std::atomic<bool> IsOrphaned{ false };
+		};
+
+		// Get the pool of the calling thread, registering it on first use.
+		ThreadPool& GetThreadPool();
+
+		/**
+		 * Move the retired allocators of the pools of exited threads to the pool of the calling
+		 * thread. The allocators of those threads that are still in flight are taken over
+		 * once they are returned. Orphaned pools are released when they have no allocators left.
+		 *
+		 * @return true if any allocator was taken over.
+		 */
+		bool AdoptOrphanedEntries(ThreadPool& threadPool);
+
+		// Identifies the pool in the thread local pool lookup, unlike its address this is never reused.
+		uint64_t m_Id;
+
+		Microsoft::WRL::ComPtr<ID3D12Device2> m_d3d12Device;
+		D3D12_COMMAND_LIST_TYPE m_CommandListType;
+
+		// Shared with the threads, which orphan their pools when they exit.
+		std::vector<std::shared_ptr<ThreadPool>> m_ThreadPools;
+		// Guards registering thread pools, which only happens once per thread, and adopting orphaned pools.
+		mutable std::mutex m_ThreadPoolsMutex;
+
+		std::atomic<uint32_t> m_NumCommandAllocators;
+		std::atomic<uint32_t> m_NumCommandAllocatorsInFlight;
+		std::atomic<uint64_t> m_NumCreated;
+		std::atomic<uint64_t> m_NumReused;
+	};
+}
+
+#endif // !_COMMAND_ALLOCATOR_POOL_
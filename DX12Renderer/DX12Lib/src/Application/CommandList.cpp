@@ -12,25 +12,43 @@
 #include "Buffers/IndexBuffer.h"
 #include "Buffers/VertexBuffer.h"
 #include "Resources/ResourceStateTracker.h"
+#include "Helpers/WriteCombinedCopy.h"
+#include "Helpers/Helpers.h"
+#include "DescriptorAllocator/BindlessDescriptorHeap.h"
 
-DDM::CommandList::CommandList(D3D12_COMMAND_LIST_TYPE type)
+DDM::CommandList::CommandList(D3D12_COMMAND_LIST_TYPE type, std::shared_ptr<UploadRingBuffer> uploadRing,
+    std::shared_ptr<ShaderVisibleDescriptorRing> resourceDescriptorRing, std::shared_ptr<ShaderVisibleDescriptorRing> samplerDescriptorRing,
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator)
     :m_d3d12CommandListType(type)
 {
     auto device = Application::Get().GetDevice();
 
-    ThrowIfFailed(device->CreateCommandAllocator(m_d3d12CommandListType, IID_PPV_ARGS(&m_d3d12CommandAllocator)));
+    if (!commandAllocator)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(m_d3d12CommandListType, IID_PPV_ARGS(&m_d3d12CommandAllocator)));
+        commandAllocator = m_d3d12CommandAllocator;
+    }
 
-    ThrowIfFailed(device->CreateCommandList(0, m_d3d12CommandListType, m_d3d12CommandAllocator.Get(),
+    ThrowIfFailed(device->CreateCommandList(0, m_d3d12CommandListType, commandAllocator.Get(),
         nullptr, IID_PPV_ARGS(&m_d3d12CommandList)));
 
+    // Only available on runtimes that support enhanced barriers, m_d3d12CommandList7 stays nullptr otherwise.
+    m_d3d12CommandList.As(&m_d3d12CommandList7);
 
-    m_UploadBuffer = std::make_unique<UploadBuffer>();
+    m_UploadBuffer = std::make_unique<UploadBuffer>(_2MB, uploadRing);
 
-    m_ResourceStateTracker = std::make_unique<ResourceStateTracker>();
+    m_ResourceStateTracker = std::make_unique<ResourceStateTracker>(m_d3d12CommandListType);
+
+    // RTV and DSV descriptors can not be bound through descriptor tables,
+    // only the shader visible heap types get a dynamic descriptor heap.
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV] =
+        std::make_unique<DynamicDescriptorHeap>(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, resourceDescriptorRing);
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER] =
+        std::make_unique<DynamicDescriptorHeap>(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, samplerDescriptorRing);
+    m_StaleDescriptorHeapBitMask = 0;
 
     for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
     {
-        m_DynamicDescriptorHeap[i] = std::make_unique<DynamicDescriptorHeap>(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(i));
         m_DescriptorHeaps[i] = nullptr;
     }
 
@@ -45,10 +63,36 @@ void DDM::CommandList::SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heapType, ID
     if (m_DescriptorHeaps[heapType] != heap)
     {
         m_DescriptorHeaps[heapType] = heap;
+
+        // The dynamic descriptor heap has to check if its descriptor tables are still bound.
+        if (m_DynamicDescriptorHeap[heapType])
+        {
+            m_StaleDescriptorHeapBitMask |= (1 << heapType);
+        }
+
         BindDescriptorHeaps();
     }
 }
 
+void DDM::CommandList::SetBindlessDescriptorHeap()
+{
+    auto bindlessDescriptorHeap = Application::Get().GetBindlessDescriptorHeap();
+    assert(bindlessDescriptorHeap && "Bindless descriptors are not enabled.");
+
+    SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, bindlessDescriptorHeap->GetD3D12DescriptorHeap());
+}
+
+void DDM::CommandList::SetDescriptorTableReuse(bool enabled)
+{
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+    {
+        if (m_DynamicDescriptorHeap[i])
+        {
+            m_DynamicDescriptorHeap[i]->SetTableCacheEnabled(enabled);
+        }
+    }
+}
+
 void DDM::CommandList::CopyVertexBuffer(VertexBuffer& vertexBuffer, size_t numVertices, size_t vertexStride, const void* vertexBufferData)
 {
     CopyBuffer(vertexBuffer, numVertices, vertexStride, vertexBufferData);
@@ -60,11 +104,53 @@ void DDM::CommandList::CopyIndexBuffer(IndexBuffer& indexBuffer, size_t numIndic
     CopyBuffer(indexBuffer, numIndicies, indexSizeInBytes, indexBufferData);
 }
 
+void DDM::CommandList::RetireUploadMemory(uint64_t fenceValue)
+{
+    m_UploadBuffer->Retire(fenceValue);
+}
+
+void DDM::CommandList::RetireDescriptors(uint64_t fenceValue)
+{
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+    {
+        if (m_DynamicDescriptorHeap[i])
+        {
+            m_DynamicDescriptorHeap[i]->Retire(fenceValue);
+        }
+
+        // The command list is reset before it is reused, which unbinds the descriptor heaps.
+        m_DescriptorHeaps[i] = nullptr;
+    }
+
+    m_StaleDescriptorHeapBitMask = 0;
+}
+
 void DDM::CommandList::FlushResourceBarriers()
 {
     m_ResourceStateTracker->FlushResourceBarriers(*this);
 }
 
+bool DDM::CommandList::Close(CommandList& pendingCommandList, std::unordered_set<ID3D12Resource*>& decayingResources)
+{
+    // Flush any remaining barriers.
+    FlushResourceBarriers();
+
+    m_d3d12CommandList->Close();
+
+    // Flush pending resource barriers.
+    uint32_t numPendingBarriers = m_ResourceStateTracker->FlushPendingResourceBarriers(pendingCommandList);
+    // Commit the final resource state to the global state.
+    m_ResourceStateTracker->CommitFinalResourceStates(decayingResources);
+
+    return numPendingBarriers > 0;
+}
+
+void DDM::CommandList::Close()
+{
+    FlushResourceBarriers();
+    m_d3d12CommandList->Close();
+}
+
 void DDM::CommandList::SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY primitiveTopology)
 {
     m_d3d12CommandList->IASetPrimitiveTopology(primitiveTopology);
@@ -92,14 +178,59 @@ void DDM::CommandList::SetIndexBuffer(IndexBuffer& indexBuffer)
     TrackResource(indexBuffer);
 }
 
+void DDM::CommandList::SetDynamicConstantBuffer(uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData)
+{
+    // Constant buffers must be 256 byte aligned.
+    auto allocation = m_UploadBuffer->Allocate(sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    WriteCombined::Copy(allocation.CPU, bufferData, sizeInBytes);
+
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineCBV(rootParameterIndex, allocation.GPU);
+    m_StaleDescriptorHeapBitMask |= (1 << D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void DDM::CommandList::SetDynamicStructuredBuffer(uint32_t rootParameterIndex, size_t numElements, size_t elementSize, const void* bufferData)
+{
+    size_t bufferSize = numElements * elementSize;
+
+    auto allocation = m_UploadBuffer->Allocate(bufferSize, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+    WriteCombined::Copy(allocation.CPU, bufferData, bufferSize);
+
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineSRV(rootParameterIndex, allocation.GPU);
+    m_StaleDescriptorHeapBitMask |= (1 << D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void DDM::CommandList::SetShaderResourceView(uint32_t rootParameterIndex, const Buffer& buffer, size_t offset, D3D12_RESOURCE_STATES stateAfter)
+{
+    auto d3d12Resource = buffer.GetD3D12Resource();
+    assert(d3d12Resource && offset < buffer.GetD3D12ResourceDesc().Width);
+
+    TransitionBarrier(buffer, stateAfter);
+
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineSRV(rootParameterIndex,
+        d3d12Resource->GetGPUVirtualAddress() + offset);
+    m_StaleDescriptorHeapBitMask |= (1 << D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    TrackResource(buffer);
+}
+
+void DDM::CommandList::SetUnorderedAccessView(uint32_t rootParameterIndex, const Buffer& buffer, size_t offset)
+{
+    auto d3d12Resource = buffer.GetD3D12Resource();
+    assert(d3d12Resource && offset < buffer.GetD3D12ResourceDesc().Width);
+
+    TransitionBarrier(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineUAV(rootParameterIndex,
+        d3d12Resource->GetGPUVirtualAddress() + offset);
+    m_StaleDescriptorHeapBitMask |= (1 << D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    TrackResource(buffer);
+}
+
 void DDM::CommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
 {
     FlushResourceBarriers();
-
-    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
-    {
-        m_DynamicDescriptorHeap[i]->CommitStagedDescriptorsForDraw(*this);
-    }
+    CommitStagedDescriptorsForDraw();
 
     m_d3d12CommandList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
 }
@@ -107,17 +238,26 @@ void DDM::CommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32
 void DDM::CommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
 {
     FlushResourceBarriers();
-
-    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
-    {
-        m_DynamicDescriptorHeap[i]->CommitStagedDescriptorsForDraw(*this);
-    }
+    CommitStagedDescriptorsForDraw();
 
     m_d3d12CommandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
 
 }
 
 
+void DDM::CommandList::CommitStagedDescriptorsForDraw()
+{
+    // Only visit the dynamic descriptor heaps that have something to commit.
+    DWORD heapType;
+    while (_BitScanForward(&heapType, m_StaleDescriptorHeapBitMask))
+    {
+        m_DynamicDescriptorHeap[heapType]->CommitStagedDescriptorsForDraw(*this);
+
+        // Cleared after the commit, binding the heap of the ring during the commit sets the bit again.
+        m_StaleDescriptorHeapBitMask &= ~(1u << heapType);
+    }
+}
+
 void DDM::CommandList::TransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource, bool flushBarriers)
 {
     TransitionBarrier(resource.GetD3D12Resource(), stateAfter, subresource, flushBarriers);
@@ -138,6 +278,26 @@ void DDM::CommandList::TransitionBarrier(Microsoft::WRL::ComPtr<ID3D12Resource>
     }
 }
 
+void DDM::CommandList::BeginTransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource)
+{
+    m_ResourceStateTracker->BeginTransitionResource(resource.GetD3D12Resource().Get(), stateAfter, subresource);
+}
+
+void DDM::CommandList::EndTransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource, bool flushBarriers)
+{
+    m_ResourceStateTracker->EndTransitionResource(resource.GetD3D12Resource().Get(), stateAfter, subresource);
+
+    if (flushBarriers)
+    {
+        FlushResourceBarriers();
+    }
+}
+
+void DDM::CommandList::HandoffResource(const Resource& resource, D3D12_COMMAND_LIST_TYPE destinationType)
+{
+    m_ResourceStateTracker->HandoffResource(resource.GetD3D12Resource().Get(), destinationType);
+}
+
 void DDM::CommandList::TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object)
 {
     m_TrackedObjects.push_back(object);
@@ -184,7 +344,8 @@ void DDM::CommandList::CopyBuffer(Buffer& buffer, size_t numElements, size_t ele
     else
     {
         auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags);
+        // Round up to whole 32-bit elements so the buffer can be fully viewed as a ByteAddressBuffer.
+        auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(Math::AlignUp<size_t>(bufferSize, 4), flags);
 
         ThrowIfFailed(device->CreateCommittedResource(
             &heapProperties,
@@ -199,33 +360,17 @@ void DDM::CommandList::CopyBuffer(Buffer& buffer, size_t numElements, size_t ele
 
         if (bufferData != nullptr)
         {
-            // Create an upload resource to use as an intermediate buffer to copy the buffer resource 
+            // Stage the data in the upload memory of the command list, which is shared with the
+            // other command lists of the queue and reused once the copy has executed.
+            auto uploadAllocation = m_UploadBuffer->Allocate(bufferSize, 4);
 
-            auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-
-            ComPtr<ID3D12Resource> uploadResource;
-            ThrowIfFailed(device->CreateCommittedResource(
-                &heapProperties,
-                D3D12_HEAP_FLAG_NONE,
-                &resourceDesc,
-                D3D12_RESOURCE_STATE_GENERIC_READ,
-                nullptr,
-                IID_PPV_ARGS(&uploadResource)));
-
-            D3D12_SUBRESOURCE_DATA subresourceData = {};
-            subresourceData.pData = bufferData;
-            subresourceData.RowPitch = bufferSize;
-            subresourceData.SlicePitch = subresourceData.RowPitch;
+            // The upload heap is write-combined, stream the data into it.
+            WriteCombined::Copy(uploadAllocation.CPU, bufferData, bufferSize);
 
             m_ResourceStateTracker->TransitionResource(d3d12Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
             FlushResourceBarriers();
 
-            UpdateSubresources(m_d3d12CommandList.Get(), d3d12Resource.Get(),
-                uploadResource.Get(), 0, 0, 1, &subresourceData);
-
-            // Add references to resources so they stay in scope until the command list is reset.
-            TrackResource(uploadResource);
+            m_d3d12CommandList->CopyBufferRegion(d3d12Resource.Get(), 0, uploadAllocation.Resource, uploadAllocation.Offset, bufferSize);
         }
         TrackResource(d3d12Resource);
     }
@@ -9,6 +9,7 @@
 
 // Standard library includes
 #include <wrl.h>
+#include <unordered_set>
 #include <vector>
 
 namespace DDM
@@ -20,12 +21,27 @@ namespace DDM
 	class Buffer;
 	class Resource;
 	class ResourceStateTracker;
+	class UploadRingBuffer;
+	class ShaderVisibleDescriptorRing;
 	//class UploadBuffer;
 
 	class CommandList final
 	{
 	public:
-		CommandList(D3D12_COMMAND_LIST_TYPE type);
+		/**
+		 * @param uploadRing The upload memory that is shared by the command lists
+		 * of the command queue. If nullptr, the command list uses a ring of its own.
+		 * @param resourceDescriptorRing, samplerDescriptorRing The shader visible
+		 * CBV/SRV/UAV and sampler heaps that are shared by the command lists of the
+		 * command queue. If nullptr, the command list uses rings of its own.
+		 * @param commandAllocator The allocator the command list is created with, for example
+		 * one of the allocator pool of the command queue. If nullptr, the command list creates
+		 * an allocator of its own.
+		 */
+		CommandList(D3D12_COMMAND_LIST_TYPE type, std::shared_ptr<UploadRingBuffer> uploadRing = nullptr,
+			std::shared_ptr<ShaderVisibleDescriptorRing> resourceDescriptorRing = nullptr,
+			std::shared_ptr<ShaderVisibleDescriptorRing> samplerDescriptorRing = nullptr,
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator = nullptr);
 		virtual ~CommandList();
 
 		// Delete copy and move operations
@@ -51,8 +67,38 @@ namespace DDM
 			return m_d3d12CommandList;
 		}
 
+		/**
+		 * Get the ID3D12GraphicsCommandList7 interface, used for enhanced barriers.
+		 * nullptr if the runtime does not support it.
+		 */
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList7> GetGraphicsCommandList7() const
+		{
+			return m_d3d12CommandList7;
+		}
+
 		void SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heapType, ID3D12DescriptorHeap* heap);
 
+		// Get the descriptor heap of the type that is bound to the command list.
+		ID3D12DescriptorHeap* GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heapType) const
+		{
+			return m_DescriptorHeaps[heapType];
+		}
+
+		/**
+		 * Bind the bindless descriptor heap, so shaders can access the views of resources
+		 * through ResourceDescriptorHeap[]. The root signature has to be created with
+		 * D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED.
+		 * Staging CBV/SRV/UAV descriptors afterwards binds a dynamic descriptor heap instead.
+		 */
+		void SetBindlessDescriptorHeap();
+
+		/**
+		 * Enable or disable the reuse of descriptor tables that were already copied to the
+		 * dynamic descriptor heaps. Only enable it if the CPU descriptors that are staged
+		 * are not rewritten while the command list is recorded.
+		 */
+		void SetDescriptorTableReuse(bool enabled);
+
 		/**
 	 * Copy the contents to a vertex buffer in GPU memory.
 	 */
@@ -82,17 +128,79 @@ namespace DDM
 		 */
 		void ReleaseTrackedObjects();
 
+		/**
+		 * Return the upload memory that was used by this command list to the upload ring.
+		 * The memory is reused once the command queue fence reaches the fence value.
+		 */
+		void RetireUploadMemory(uint64_t fenceValue);
+
+		/**
+		 * Return the shader visible descriptors that were used by this command list to the
+		 * descriptor rings. They are reused once the command queue fence reaches the fence value.
+		 */
+		void RetireDescriptors(uint64_t fenceValue);
+
 		/**
 		 * Flush any barriers that have been pushed to the command list.
 		 */
 		void FlushResourceBarriers();
 
+		/**
+		 * Close the command list for execution, and commit the final states of the
+		 * resources it used to their global state.
+		 *
+		 * @param pendingCommandList The command list that is executed right before this one.
+		 * It receives the barriers that move the resources from their global state to the
+		 * state this command list expects them in.
+		 * @param decayingResources The resources that decay to the common state once the
+		 * command lists that are executed together with this one have executed.
+		 * @return true if barriers were recorded to the pending command list.
+		 */
+		bool Close(CommandList& pendingCommandList, std::unordered_set<ID3D12Resource*>& decayingResources);
+
+		/**
+		 * Close the command list without resolving pending barriers.
+		 */
+		void Close();
+
 		void SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 		void SetVertexBuffer(UINT startSlot, VertexBuffer& vertexBuffer);
 
 		void SetIndexBuffer(IndexBuffer& indexBuffer);
 
+		/**
+		 * Set a constant buffer as a root descriptor (inline CBV), without a descriptor table.
+		 * The data is copied to upload memory, so it only has to stay valid during the call.
+		 * The root descriptor is set on the command list by the next Draw.
+		 */
+		void SetDynamicConstantBuffer(uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData);
+		template<typename T>
+		void SetDynamicConstantBuffer(uint32_t rootParameterIndex, const T& data)
+		{
+			SetDynamicConstantBuffer(rootParameterIndex, sizeof(T), &data);
+		}
+
+		/**
+		 * Set a structured buffer as a root descriptor (inline SRV), without a descriptor table.
+		 * The data is copied to upload memory, so it only has to stay valid during the call.
+		 */
+		void SetDynamicStructuredBuffer(uint32_t rootParameterIndex, size_t numElements, size_t elementSize, const void* bufferData);
+		template<typename T>
+		void SetDynamicStructuredBuffer(uint32_t rootParameterIndex, const std::vector<T>& bufferData)
+		{
+			SetDynamicStructuredBuffer(rootParameterIndex, bufferData.size(), sizeof(T), bufferData.data());
+		}
+
+		/**
+		 * Set a buffer as a root SRV or UAV. The buffer is transitioned to the matching state.
+		 *
+		 * @param offset The offset in bytes from the start of the buffer.
+		 */
+		void SetShaderResourceView(uint32_t rootParameterIndex, const Buffer& buffer, size_t offset = 0,
+			D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		void SetUnorderedAccessView(uint32_t rootParameterIndex, const Buffer& buffer, size_t offset = 0);
+
 		/**
 	 * Draw geometry.
 	 */
@@ -112,20 +220,50 @@ namespace DDM
 		void TransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flushBarriers = false);
 		void TransitionBarrier(Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flushBarriers = false);
 
+		/**
+		 * Begin the transition of a resource early, so the GPU can perform it while the commands
+		 * that are recorded until EndTransitionBarrier run. The resource may not be used until
+		 * the transition is ended.
+		 */
+		void BeginTransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+		/**
+		 * End a transition that was begun with BeginTransitionBarrier, right before the resource is used.
+		 * The resource is transitioned as usual if the transition was not begun.
+		 */
+		void EndTransitionBarrier(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flushBarriers = false);
+
+		/**
+		 * Hand off a resource to a queue of another type, that uses it after this command list.
+		 * The resource is transitioned to the common state if the other queue does not support its state.
+		 * The other queue has to wait for this command list with CommandQueue::Wait before it uses the resource.
+		 *
+		 * @param destinationType The type of the queue that uses the resource next.
+		 */
+		void HandoffResource(const Resource& resource, D3D12_COMMAND_LIST_TYPE destinationType);
+
 
 	private:
+		// Records the copies of its batches through CopyBuffer.
+		friend class UploadManager;
+
 		void TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object);
 		void TrackResource(const Resource& res);
 
 		// Binds the current descriptor heaps to the command list.
 		void BindDescriptorHeaps();
 
+		// Commit the descriptors that were staged since the last draw.
+		void CommitStagedDescriptorsForDraw();
+
 		// Copy the contents of a CPU buffer to a GPU buffer (possibly replacing the previous buffer contents).
 		void CopyBuffer(Buffer& buffer, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
 
 		D3D12_COMMAND_LIST_TYPE m_d3d12CommandListType;
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> m_d3d12CommandList;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList7> m_d3d12CommandList7;
+		// Only set if the command list created its own allocator.
 		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_d3d12CommandAllocator;
 
 		// Keep track of the currently bound root signatures to minimize root
@@ -143,8 +281,13 @@ namespace DDM
 		// The dynamic descriptor heap allows for descriptors to be staged before
 		// being committed to the command list. Dynamic descriptors need to be
 		// committed before a Draw or Dispatch.
+		// Only the CBV/SRV/UAV and sampler heap types have one.
 		std::unique_ptr<DynamicDescriptorHeap> m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
+		// Each bit set represents a dynamic descriptor heap type with descriptors that were
+		// staged, or a descriptor heap that was bound, since the last commit.
+		uint32_t m_StaleDescriptorHeapBitMask;
+
 
 		using TrackedObjects = std::vector < Microsoft::WRL::ComPtr<ID3D12Object> >;
 		// Objects that are being tracked by a command list that is "in-flight" on 
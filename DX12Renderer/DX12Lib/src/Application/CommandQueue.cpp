@@ -6,15 +6,27 @@
 // File includes
 #include "Helpers/Helpers.h"
 #include "CommandList.h"
+#include "CommandAllocatorPool.h"
+#include "D3D12Fence.h"
+#include "FenceTimeline.h"
+#include "QueueDependencies.h"
+#include "Resources/ResourceStateTracker.h"
+#include "UploadRingBuffer.h"
+#include "DescriptorAllocator/ShaderVisibleDescriptorRing.h"
 #include "Includes/DXRHelpersIncludes.h"
 
 // Standard library includes
+#include <algorithm>
 #include <cassert>
+#include <unordered_set>
+#include <vector>
 
 DDM::CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
 	:m_FenceValue{0},
 	m_CommandListType{type},
-	m_d3d12Device{device}
+	m_d3d12Device{device},
+	m_RetiredFenceValue{0},
+	m_StopRetirement{false}
 {
 	D3D12_COMMAND_QUEUE_DESC desc = {};
 	desc.Type = type;
@@ -23,54 +35,66 @@ DDM::CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3
 	desc.NodeMask = 0;
 	
 	ThrowIfFailed(m_d3d12Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_d3d12CommandQueue)));
-	ThrowIfFailed(m_d3d12Device->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
+	ThrowIfFailed(m_d3d12Device->CreateFence(m_FenceValue.load(), D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
 
-	m_FenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(m_FenceEvent && "Failed to create fence event handle");
-}
+	auto fence = std::make_shared<D3D12Fence>(m_d3d12Fence);
+	m_pFenceTimeline = std::make_unique<FenceTimeline>(fence);
+	m_pQueueDependencies = std::make_unique<QueueDependencies>();
+	m_pCommandAllocatorPool = std::make_unique<CommandAllocatorPool>(m_d3d12Device, m_CommandListType);
 
-DDM::CommandQueue::~CommandQueue()
-{
+	m_UploadRingBuffer = std::make_shared<UploadRingBuffer>(m_d3d12Fence);
 
+	// Copy command lists can not bind descriptor heaps.
+	if (type != D3D12_COMMAND_LIST_TYPE_COPY)
+	{
+		m_ResourceDescriptorRing = std::make_shared<ShaderVisibleDescriptorRing>(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, fence);
+		m_SamplerDescriptorRing = std::make_shared<ShaderVisibleDescriptorRing>(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, fence);
+	}
+
+	m_RetirementThread = std::thread(&CommandQueue::RetirementThread, this);
 }
 
-Microsoft::WRL::ComPtr<ID3D12CommandAllocator> DDM::CommandQueue::CreateCommandAllocator()
+DDM::CommandQueue::~CommandQueue()
 {
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-	ThrowIfFailed(m_d3d12Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&commandAllocator)));
+	{
+		std::lock_guard<std::mutex> lock(m_InFlightMutex);
+		m_StopRetirement = true;
+	}
 
-	return commandAllocator;
+	m_RetirementCondition.notify_one();
+	m_RetirementThread.join();
 }
 
 std::shared_ptr<DDM::CommandList> DDM::CommandQueue::CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator)
 {
-	auto commandList = std::make_shared<DDM::CommandList>(m_CommandListType);
+	auto commandList = std::make_shared<DDM::CommandList>(m_CommandListType, m_UploadRingBuffer,
+		m_ResourceDescriptorRing, m_SamplerDescriptorRing, allocator);
 
 	return commandList;
 }
 
 std::shared_ptr<DDM::CommandList> DDM::CommandQueue::GetCommandList()
 {
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
 	std::shared_ptr<CommandList> commandList;
 
-	if (!m_CommandAllocatorQueue.empty() && IsFenceComplete(m_CommandAllocatorQueue.front().fenceValue))
-	{
-		commandAllocator = m_CommandAllocatorQueue.front().commandAllocator;
-		m_CommandAllocatorQueue.pop();
+	uint64_t completedFenceValue = m_pFenceTimeline->GetCompletedValue();
+
+	// Any completed allocator of this thread is reused, the pool does not take a lock.
+	auto commandAllocator = m_pCommandAllocatorPool->Acquire(completedFenceValue);
 
-		ThrowIfFailed(commandAllocator->Reset());
-	}
-	else
 	{
-		commandAllocator = CreateCommandAllocator();
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+
+		if (!m_CommandListQueue.empty())
+		{
+			commandList = m_CommandListQueue.front();
+			m_CommandListQueue.pop();
+		}
 	}
 
-	if (!m_CommandListQueue.empty())
+	// The command list is owned by this thread now, it is reset or created without holding the lock.
+	if (commandList)
 	{
-		commandList = m_CommandListQueue.front();
-		m_CommandListQueue.pop();
-
 		ThrowIfFailed(commandList->GetGraphicsCommandList()->Reset(commandAllocator.Get(), nullptr));
 	}
 	else
@@ -88,61 +112,271 @@ std::shared_ptr<DDM::CommandList> DDM::CommandQueue::GetCommandList()
 
 uint64_t DDM::CommandQueue::ExecuteCommandList(std::shared_ptr<CommandList> commandList)
 {
-	auto d3dcommandList = commandList->GetGraphicsCommandList();
+	return ExecuteCommandLists(std::span<const std::shared_ptr<CommandList>>(&commandList, 1));
+}
+
+uint64_t DDM::CommandQueue::ExecuteCommandLists(std::span<const std::shared_ptr<CommandList>> commandLists)
+{
+	std::lock_guard<std::mutex> lock(m_SubmitMutex);
 
-	d3dcommandList->Close();
+	// Every command list, and the command list with its pending barriers.
+	std::vector<std::shared_ptr<CommandList>> executedCommandLists;
+	executedCommandLists.reserve(commandLists.size() * 2);
 
-	ID3D12CommandAllocator* commandAllocator;
-	UINT dataSize = sizeof(commandAllocator);
-	ThrowIfFailed(d3dcommandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+	std::vector<ID3D12CommandList*> d3d12CommandLists;
+	d3d12CommandLists.reserve(commandLists.size() * 2);
 
-	ID3D12CommandList* const ppCommandLists[] = {
-		d3dcommandList.Get()
-	};
+	// The resources that decay to the common state once the command lists have executed.
+	std::unordered_set<ID3D12Resource*> decayingResources;
+
+	for (const auto& commandList : commandLists)
+	{
+		// The pending barriers of the command list are recorded to a command list
+		// that is executed before it. They are resolved after the final states of
+		// the command lists before it have been committed.
+		auto pendingCommandList = GetCommandList();
+
+		bool hasPendingBarriers = commandList->Close(*pendingCommandList, decayingResources);
+		pendingCommandList->Close();
+
+		if (hasPendingBarriers)
+		{
+			d3d12CommandLists.push_back(pendingCommandList->GetGraphicsCommandList().Get());
+		}
+		d3d12CommandLists.push_back(commandList->GetGraphicsCommandList().Get());
+
+		executedCommandLists.push_back(pendingCommandList);
+		executedCommandLists.push_back(commandList);
+	}
 
-	m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
+	m_d3d12CommandQueue->ExecuteCommandLists(static_cast<UINT>(d3d12CommandLists.size()), d3d12CommandLists.data());
 	uint64_t fenceValue = Signal();
 
-	m_CommandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandAllocator });
-	m_CommandListQueue.push(commandList);
+	// Decay only applies between ExecuteCommandLists calls. Still under the submit lock,
+	// so the next submission on this queue resolves its barriers against the decayed states.
+	ResourceStateTracker::DecayResourceStates(decayingResources);
 
-	// The ownership of the command allocator has been transferred
-	// in the ocmmand allocator queue. It is safe to release the reference
-	// in this temporary COM pointer here
-	commandAllocator->Release();
+	for (auto& executedCommandList : executedCommandLists)
+	{
+		auto d3dcommandList = executedCommandList->GetGraphicsCommandList();
+
+		ID3D12CommandAllocator* commandAllocator;
+		UINT dataSize = sizeof(commandAllocator);
+		ThrowIfFailed(d3dcommandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+
+		// The upload memory of the command list is reused once the fence value is reached.
+		executedCommandList->RetireUploadMemory(fenceValue);
+		executedCommandList->RetireDescriptors(fenceValue);
+
+		m_pCommandAllocatorPool->Retire(commandAllocator, fenceValue);
+
+		// The command allocator is owned by the command allocator pool.
+		// It is safe to release the reference in this temporary COM pointer here
+		commandAllocator->Release();
+	}
+
+	// The command lists are handed to the retirement thread, which makes them available
+	// again once the GPU is done with them.
+	{
+		std::lock_guard<std::mutex> lock(m_InFlightMutex);
+		m_InFlightCommandLists.push_back(InFlightCommandLists{ fenceValue, std::move(executedCommandLists) });
+	}
+
+	m_RetirementCondition.notify_one();
 
 	return fenceValue;
 }
 
 uint64_t DDM::CommandQueue::Signal()
 {
-	uint64_t fenceValueForSignal = ++m_FenceValue;
-	ThrowIfFailed(m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValueForSignal));
+	uint64_t fenceValueForSignal;
+
+	{
+		// Signal under the lock, so the fence values are signaled in order.
+		std::lock_guard<std::mutex> lock(m_InFlightMutex);
+
+		fenceValueForSignal = m_FenceValue.load(std::memory_order_relaxed) + 1;
+		m_FenceValue.store(fenceValueForSignal, std::memory_order_release);
+
+		ThrowIfFailed(m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValueForSignal));
+	}
+
+	m_RetirementCondition.notify_one();
 
 	return fenceValueForSignal;
 }
 
 bool DDM::CommandQueue::IsFenceComplete(uint64_t fenceValue)
 {
-	return m_d3d12Fence->GetCompletedValue() >= fenceValue;
+	return m_pFenceTimeline->IsComplete(fenceValue);
+}
+
+uint64_t DDM::CommandQueue::GetCompletedFenceValue() const
+{
+	return m_pFenceTimeline->GetCompletedValue();
+}
+
+uint64_t DDM::CommandQueue::GetNextFenceValue() const
+{
+	return m_FenceValue.load(std::memory_order_acquire) + 1;
 }
 
 void DDM::CommandQueue::WaitForFenceValue(uint64_t fenceValue)
 {
-	if (m_d3d12Fence->GetCompletedValue() < m_FenceValue)
-	{
-		ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(m_FenceValue, m_FenceEvent));
-		::WaitForSingleObject(m_FenceEvent, static_cast<DWORD>(1'000'000'000));
-	}
+	m_pFenceTimeline->WaitForValue(fenceValue);
 }
 
 void DDM::CommandQueue::Flush()
 {
 	uint64_t fenceValueForSignal = Signal();
 	WaitForFenceValue(fenceValueForSignal);
+
+	// Callers expect the objects the command lists track to be released, for example
+	// before the swap chain is resized, so this does not wait for the retirement thread.
+	RetireCommandLists();
+}
+
+void DDM::CommandQueue::AddCompletionCallback(uint64_t fenceValue, std::function<void()> callback)
+{
+	m_pFenceTimeline->AddCompletionCallback(fenceValue, std::move(callback));
+}
+
+DDM::CommandAllocatorPool& DDM::CommandQueue::GetCommandAllocatorPool() const
+{
+	return *m_pCommandAllocatorPool;
+}
+
+DDM::FenceTimeline& DDM::CommandQueue::GetFenceTimeline() const
+{
+	return *m_pFenceTimeline;
+}
+
+void DDM::CommandQueue::Wait(const CommandQueue& otherQueue, uint64_t fenceValue)
+{
+	// Commands on the same queue are executed in order.
+	if (&otherQueue == this)
+	{
+		return;
+	}
+
+	// The wait is ordered with the submissions of this queue.
+	std::lock_guard<std::mutex> lock(m_SubmitMutex);
+
+	if (m_pQueueDependencies->AddDependency(*otherQueue.m_pFenceTimeline, fenceValue))
+	{
+		ThrowIfFailed(m_d3d12CommandQueue->Wait(otherQueue.m_d3d12Fence.Get(), fenceValue));
+	}
+}
+
+void DDM::CommandQueue::RetirementThread()
+{
+	std::unique_lock<std::mutex> lock(m_InFlightMutex);
+
+	while (true)
+	{
+		// Wake up for every fence value that is signaled, and for command lists of which
+		// the fence value was already seen before they were handed over.
+		m_RetirementCondition.wait(lock, [this]()
+			{
+				return m_StopRetirement || m_FenceValue > m_RetiredFenceValue ||
+					(!m_InFlightCommandLists.empty() && m_InFlightCommandLists.front().fenceValue <= m_RetiredFenceValue);
+			});
+
+		if (m_StopRetirement)
+		{
+			break;
+		}
+
+		bool isFenceSignaled = m_FenceValue > m_RetiredFenceValue;
+		uint64_t fenceValue = m_RetiredFenceValue + 1;
+
+		lock.unlock();
+
+		// Block until the oldest submission that has not been retired completes.
+		if (isFenceSignaled)
+		{
+			m_pFenceTimeline->WaitForValue(fenceValue);
+		}
+
+		RetireCommandLists();
+
+		lock.lock();
+	}
+}
+
+void DDM::CommandQueue::RetireCommandLists()
+{
+	// Polling under the lock makes a flush wait for the callbacks that the retirement thread is running.
+	std::lock_guard<std::mutex> retireLock(m_RetireMutex);
+
+	uint64_t completedFenceValue = m_pFenceTimeline->Poll();
+
+	std::vector<std::shared_ptr<CommandList>> commandLists;
+
+	{
+		std::lock_guard<std::mutex> lock(m_InFlightMutex);
+
+		while (!m_InFlightCommandLists.empty() && m_InFlightCommandLists.front().fenceValue <= completedFenceValue)
+		{
+			auto& inFlightCommandLists = m_InFlightCommandLists.front().commandLists;
+			commandLists.insert(commandLists.end(), inFlightCommandLists.begin(), inFlightCommandLists.end());
+
+			m_InFlightCommandLists.pop_front();
+		}
+
+		m_RetiredFenceValue = std::max(m_RetiredFenceValue, completedFenceValue);
+	}
+
+	for (auto& commandList : commandLists)
+	{
+		commandList->ReleaseTrackedObjects();
+	}
+
+	// Every executed command list was recorded with an allocator of the pool.
+	if (!commandLists.empty())
+	{
+		m_pCommandAllocatorPool->CompleteCommandAllocators(static_cast<uint32_t>(commandLists.size()));
+	}
+
+	// Reclaim the memory here, instead of when the recording threads allocate.
+	m_UploadRingBuffer->ReclaimCompletedBlocks();
+
+	if (m_ResourceDescriptorRing)
+	{
+		m_ResourceDescriptorRing->ReclaimCompletedSegments();
+		m_SamplerDescriptorRing->ReclaimCompletedSegments();
+	}
+
+	if (!commandLists.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+
+		for (auto& commandList : commandLists)
+		{
+			m_CommandListQueue.push(commandList);
+		}
+	}
 }
 
 Microsoft::WRL::ComPtr<ID3D12CommandQueue> DDM::CommandQueue::GetD3D12CommandQueue() const
 {
 	return m_d3d12CommandQueue;
 }
+
+std::shared_ptr<DDM::UploadRingBuffer> DDM::CommandQueue::GetUploadRingBuffer() const
+{
+	return m_UploadRingBuffer;
+}
+
+std::shared_ptr<DDM::ShaderVisibleDescriptorRing> DDM::CommandQueue::GetDescriptorRing(D3D12_DESCRIPTOR_HEAP_TYPE type) const
+{
+	switch (type)
+	{
+	case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+		return m_ResourceDescriptorRing;
+	case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+		return m_SamplerDescriptorRing;
+	default:
+		return nullptr;
+	}
+}
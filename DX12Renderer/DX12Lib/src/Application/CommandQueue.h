@@ -10,13 +10,26 @@
 #include <d3D12.h> // For ID3D12CommandQueue, ID3D12Device2, and ID3D12Fence
 #include <wrl.h>    // For Microsoft::WRL::ComPtr
 
+#include <atomic>	// For std::atomic
 #include <cstdint>  // For uint64_t
+#include <functional> // For std::function
 #include <queue>    // For std::queue
 #include <memory>	// for std::shared_ptr
+#include <mutex>	// For std::mutex
+#include <condition_variable> // For std::condition_variable
+#include <thread>	// For std::thread
+#include <deque>	// For std::deque
+#include <vector>	// For std::vector
+#include <span>		// For std::span
 
 namespace DDM
 {
 	class CommandList;
+	class UploadRingBuffer;
+	class ShaderVisibleDescriptorRing;
+	class FenceTimeline;
+	class QueueDependencies;
+	class CommandAllocatorPool;
 
 	class CommandQueue
 	{
@@ -35,43 +48,129 @@ namespace DDM
 		CommandQueue& operator=(CommandQueue&& other) = delete;
 
 		 // Returns an available command list from the command queue
+		 // Can be called from several threads at the same time, for example by workers that each record a command list.
 		std::shared_ptr<CommandList> GetCommandList();
 
 		// Execute a command list
+		// The barriers that bring the resources from their global state into the state the
+		// command list expects are resolved here, and executed right before the command list.
 		// Returns the fence value to wait for for this comand list
 		uint64_t ExecuteCommandList(std::shared_ptr<CommandList> commandList);
 
+		// Execute several command lists in order, with a single ExecuteCommandLists call and a single signal.
+		// The pending barriers of each command list are resolved against the states the
+		// command lists before it leave the resources in, and executed right before it.
+		// Returns the fence value to wait for for these command lists
+		uint64_t ExecuteCommandLists(std::span<const std::shared_ptr<CommandList>> commandLists);
+
 		uint64_t Signal();
+
+		// Check if the GPU has reached the fence value. The fence is only queried
+		// if the last completed value that was seen has not reached it yet.
 		bool IsFenceComplete(uint64_t fenceValue);
+
+		// Get the last fence value that was completed by the GPU.
+		uint64_t GetCompletedFenceValue() const;
+
+		// Get the fence value that is signaled by the next submission.
+		uint64_t GetNextFenceValue() const;
+
+		// Wait until the GPU has reached the fence value. Submissions that were
+		// signaled after it are not waited for.
 		void WaitForFenceValue(uint64_t fenceValue);
+
+		// Wait until the GPU has finished all submitted work, and retire the executed command lists.
 		void Flush();
 
+		// Run the callback once the GPU has reached the fence value, for example to free
+		// or recycle objects that the submission uses. Runs right away if it already has.
+		// Callbacks run on the retirement thread of the queue, or on the thread that flushes it.
+		// They may not flush the queue themselves.
+		void AddCompletionCallback(uint64_t fenceValue, std::function<void()> callback);
+
+		FenceTimeline& GetFenceTimeline() const;
+
+		// Make the command lists that are executed after this call wait on the GPU until the
+		// other queue has reached the fence value. The CPU does not wait.
+		// Nothing is recorded if the other queue has already reached the value, or if
+		// this queue waited on the value, or a later one, before.
+		void Wait(const CommandQueue& otherQueue, uint64_t fenceValue);
+
+		D3D12_COMMAND_LIST_TYPE GetCommandListType() const { return m_CommandListType; }
+
+		// The command allocators of the command lists, pooled per recording thread.
+		CommandAllocatorPool& GetCommandAllocatorPool() const;
+
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
+
+		// The upload memory that is shared by the command lists of this queue.
+		std::shared_ptr<UploadRingBuffer> GetUploadRingBuffer() const;
+
+		// The shader visible descriptor heap of the type that is shared by the command lists of this queue.
+		// Returns nullptr for copy queues, and for the heap types that can not be shader visible.
+		std::shared_ptr<ShaderVisibleDescriptorRing> GetDescriptorRing(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 	
 	protected:
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CreateCommandAllocator();
 		std::shared_ptr<CommandList> CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
 
 	private:
-		// Keep track of command allocators that are "in-flight"
-		struct CommandAllocatorEntry
+		// Command lists that are executed, with the fence value that is signaled after them.
+		struct InFlightCommandLists
 		{
 			uint64_t fenceValue;
-			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+			std::vector<std::shared_ptr<CommandList>> commandLists;
 		};
 
-		using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
+		// Waits for the fence on a background thread and retires the command lists of completed submissions.
+		void RetirementThread();
+
+		// Run the completion callbacks, release what the command lists of completed
+		// submissions hold on to, and make them available again.
+		void RetireCommandLists();
+
 		using CommandListQueue = std::queue<std::shared_ptr<CommandList>>;
 
 		D3D12_COMMAND_LIST_TYPE						m_CommandListType;
 		Microsoft::WRL::ComPtr<ID3D12Device2>		m_d3d12Device;
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue>	m_d3d12CommandQueue;
 		Microsoft::WRL::ComPtr<ID3D12Fence>			m_d3d12Fence;
-		HANDLE										m_FenceEvent;
-		uint64_t									m_FenceValue;
+		std::unique_ptr<FenceTimeline>				m_pFenceTimeline;
+		// The last fence value that was signaled. Written under m_InFlightMutex,
+		// GetNextFenceValue reads it without the lock.
+		std::atomic<uint64_t>						m_FenceValue;
+
+		// The fence values of other queues this queue waits on.
+		std::unique_ptr<QueueDependencies>			m_pQueueDependencies;
 
-		CommandAllocatorQueue						m_CommandAllocatorQueue;
+		// Keeps the pending barriers of the command lists that are executed on this queue
+		// resolved in the same order as they are submitted.
+		std::mutex									m_SubmitMutex;
+
+		// Command allocators that are "in-flight" are retired to the pool of the thread that recorded with them.
+		std::unique_ptr<CommandAllocatorPool>		m_pCommandAllocatorPool;
 		CommandListQueue							m_CommandListQueue;
+
+		// Guards the command list queue.
+		std::mutex									m_QueueMutex;
+
+		// Command lists that are executed but not yet retired, in the order they are signaled.
+		std::deque<InFlightCommandLists>			m_InFlightCommandLists;
+		// The completed fence value up to which command lists have been retired.
+		uint64_t									m_RetiredFenceValue;
+		// Guards the in flight command lists and the fence values.
+		std::mutex									m_InFlightMutex;
+		// Held while the completion callbacks run and the command lists are retired.
+		std::mutex									m_RetireMutex;
+		std::condition_variable						m_RetirementCondition;
+		bool										m_StopRetirement;
+		std::thread									m_RetirementThread;
+
+		// Upload memory of the command lists, reclaimed as the fence completes.
+		std::shared_ptr<UploadRingBuffer>			m_UploadRingBuffer;
+
+		// Shader visible descriptors of the command lists, reclaimed as the fence completes.
+		std::shared_ptr<ShaderVisibleDescriptorRing>	m_ResourceDescriptorRing;
+		std::shared_ptr<ShaderVisibleDescriptorRing>	m_SamplerDescriptorRing;
 	};
 }
 
@@ -0,0 +1,35 @@
+// D3D12Fence.cpp
+
+// Header include
+#include "D3D12Fence.h"
+
+// File includes
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::D3D12Fence::D3D12Fence(Microsoft::WRL::ComPtr<ID3D12Fence> fence)
+    : m_d3d12Fence(fence)
+{
+    assert(m_d3d12Fence && "A D3D12 fence needs an ID3D12Fence.");
+}
+
+DDM::D3D12Fence::~D3D12Fence()
+{
+}
+
+uint64_t DDM::D3D12Fence::GetCompletedValue()
+{
+    return m_d3d12Fence->GetCompletedValue();
+}
+
+void DDM::D3D12Fence::WaitForValue(uint64_t value)
+{
+    if (m_d3d12Fence->GetCompletedValue() < value)
+    {
+        // Without an event the call blocks until the value is reached. Unlike a shared event,
+        // this is safe when several threads wait on the fence at the same time.
+        ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(value, nullptr));
+    }
+}
@@ -0,0 +1,43 @@
+// D3D12Fence.h
+
+/**
+ * Fence of a fence timeline that is signaled by a command queue on the GPU.
+ */
+
+#ifndef _D3D12_FENCE_
+#define _D3D12_FENCE_
+
+// File includes
+#include "FenceTimeline.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+
+namespace DDM
+{
+	class D3D12Fence final : public Fence
+	{
+	public:
+		explicit D3D12Fence(Microsoft::WRL::ComPtr<ID3D12Fence> fence);
+
+		virtual ~D3D12Fence() override;
+
+		D3D12Fence(D3D12Fence& other) = delete;
+		D3D12Fence(D3D12Fence&& other) = delete;
+
+		D3D12Fence& operator=(D3D12Fence& other) = delete;
+		D3D12Fence& operator=(D3D12Fence&& other) = delete;
+
+		virtual uint64_t GetCompletedValue() override;
+
+		virtual void WaitForValue(uint64_t value) override;
+
+		Microsoft::WRL::ComPtr<ID3D12Fence> GetD3D12Fence() const { return m_d3d12Fence; }
+
+	private:
+		Microsoft::WRL::ComPtr<ID3D12Fence> m_d3d12Fence;
+	};
+}
+
+#endif // !_D3D12_FENCE_
@@ -27,6 +27,16 @@ void DDM::Mesh::Initialize(CommandList& commandList)
     m_Initialized = true;
 }
 
+void DDM::Mesh::Initialize(UploadManager& uploadManager)
+{
+    uploadManager.CopyVertexBuffer(m_VertexBuffer, m_Vertices);
+
+    // Batches complete in order, so the ticket of the last upload covers both buffers.
+    m_UploadTicket = uploadManager.CopyIndexBuffer<uint16_t>(m_IndexBuffer, m_Indices);
+
+    m_Initialized = true;
+}
+
 void DDM::Mesh::SetMVPMatrix(CommandList& commandList, DirectX::XMMATRIX& viewMatrix, DirectX::XMMATRIX& projectionMatrix)
 {
     XMMATRIX scaleMatrix = XMMatrixScalingFromVector(m_Scale);
@@ -53,6 +63,22 @@ void DDM::Mesh::Draw(CommandList& commandList, DirectX::XMMATRIX& viewMatrix, Di
 }
 
 std::unique_ptr<DDM::Mesh> DDM::Mesh::CreateCube(CommandList& commandList)
+{
+    auto mesh = CreateCubeGeometry();
+    mesh->Initialize(commandList);
+
+    return mesh;
+}
+
+std::unique_ptr<DDM::Mesh> DDM::Mesh::CreateCube(UploadManager& uploadManager)
+{
+    auto mesh = CreateCubeGeometry();
+    mesh->Initialize(uploadManager);
+
+    return mesh;
+}
+
+std::unique_ptr<DDM::Mesh> DDM::Mesh::CreateCubeGeometry()
 {
     auto mesh = std::make_unique<Mesh>();
 
@@ -105,8 +131,6 @@ std::unique_ptr<DDM::Mesh> DDM::Mesh::CreateCube(CommandList& commandList)
         mesh->m_Vertices.push_back(VertexPosColor{ (normal + side1 - side2), XMFLOAT3(0,0,1) });
     }
 
-    mesh->Initialize(commandList);
-
     return mesh;
 }
 
@@ -11,6 +11,7 @@
 #include "Application/DataTypes/Structs.h"
 #include "Application/Buffers/VertexBuffer.h"
 #include "Application/Buffers/IndexBuffer.h"
+#include "Application/UploadManager.h"
 
 // Standard library includes
 #include <wrl.h>
@@ -40,11 +41,20 @@ namespace DDM
 		// Copyright(c) 2018 Jeremiah van Oosten
 		static std::unique_ptr<Mesh> CreateCube(CommandList& commandList);
 
+		// Create a cube of which the buffers are uploaded in a batch of the upload manager.
+		static std::unique_ptr<Mesh> CreateCube(UploadManager& uploadManager);
+
 		void SetPosition(float x, float y, float z);
 
+		// The ticket to wait on before drawing. Invalid, so waiting does nothing, unless the mesh was uploaded by an upload manager.
+		const UploadManager::Ticket& GetUploadTicket() const { return m_UploadTicket; }
+
 	private:
 
+		static std::unique_ptr<Mesh> CreateCubeGeometry();
+
 		void Initialize(CommandList& commandList);
+		void Initialize(UploadManager& uploadManager);
 
 		//Is model initialized
 		bool m_Initialized{ false };
@@ -64,6 +74,8 @@ namespace DDM
 		
 		VertexBuffer m_VertexBuffer;
 		IndexBuffer m_IndexBuffer;
+
+		UploadManager::Ticket m_UploadTicket;
 		
 		void SetMVPMatrix(CommandList& commandList, DirectX::XMMATRIX& viewMatrix, DirectX::XMMATRIX& projectionMatrix);
 
@@ -0,0 +1,197 @@
+// BindlessDescriptorHeap.cpp
+
+// Header include
+#include "BindlessDescriptorHeap.h"
+
+// File includes
+#include "Application/Application.h"
+#include "Application/CommandQueue.h"
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <algorithm>
+#include <new>
+
+DDM::BindlessDescriptor::BindlessDescriptor()
+    : m_Index(BindlessIndexAllocator::InvalidIndex)
+    , m_Heap(nullptr)
+{
+}
+
+DDM::BindlessDescriptor::BindlessDescriptor(uint32_t index, std::shared_ptr<BindlessDescriptorHeap> heap)
+    : m_Index(index)
+    , m_Heap(std::move(heap))
+{
+}
+
+DDM::BindlessDescriptor::~BindlessDescriptor()
+{
+    Free();
+}
+
+DDM::BindlessDescriptor::BindlessDescriptor(BindlessDescriptor&& other)
+    : m_Index(other.m_Index)
+    , m_Heap(std::move(other.m_Heap))
+{
+    other.m_Index = BindlessIndexAllocator::InvalidIndex;
+}
+
+DDM::BindlessDescriptor& DDM::BindlessDescriptor::operator=(BindlessDescriptor&& other)
+{
+    if (this != &other)
+    {
+        Free();
+
+        m_Index = other.m_Index;
+        m_Heap = std::move(other.m_Heap);
+
+        other.m_Index = BindlessIndexAllocator::InvalidIndex;
+    }
+
+    return *this;
+}
+
+bool DDM::BindlessDescriptor::IsNull() const
+{
+    return m_Index == BindlessIndexAllocator::InvalidIndex;
+}
+
+uint32_t DDM::BindlessDescriptor::GetIndex() const
+{
+    return m_Index;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::BindlessDescriptor::GetCPUDescriptorHandle() const
+{
+    assert(!IsNull());
+    return m_Heap->GetCPUDescriptorHandle(m_Index);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DDM::BindlessDescriptor::GetGPUDescriptorHandle() const
+{
+    assert(!IsNull());
+    return m_Heap->GetGPUDescriptorHandle(m_Index);
+}
+
+void DDM::BindlessDescriptor::Free()
+{
+    if (!IsNull() && m_Heap)
+    {
+        m_Heap->Free(m_Index);
+
+        m_Index = BindlessIndexAllocator::InvalidIndex;
+        m_Heap.reset();
+    }
+}
+
+DDM::BindlessDescriptorHeap::BindlessDescriptorHeap(std::span<CommandQueue* const> commandQueues, uint32_t numDescriptors)
+    : m_NumDescriptors(numDescriptors)
+    , m_CommandQueues(commandQueues.begin(), commandQueues.end())
+    , m_NumFences(static_cast<uint32_t>(commandQueues.size()))
+    , m_IndexAllocator(numDescriptors, static_cast<uint32_t>(commandQueues.size()))
+{
+    auto device = Application::Get().GetDevice();
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.NumDescriptors = m_NumDescriptors;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_d3d12DescriptorHeap)));
+
+    m_BaseCPUDescriptor = m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_BaseGPUDescriptor = m_d3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    m_DescriptorHandleIncrementSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+DDM::BindlessDescriptorHeap::~BindlessDescriptorHeap()
+{
+}
+
+DDM::BindlessDescriptor DDM::BindlessDescriptorHeap::Allocate()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    uint32_t index = m_IndexAllocator.Allocate();
+    if (index == BindlessIndexAllocator::InvalidIndex)
+    {
+        // Try again with the descriptors that were freed since the last frame.
+        uint64_t completedFenceValues[BindlessIndexAllocator::MaxNumFences];
+        GetCompletedFenceValues(completedFenceValues);
+
+        m_IndexAllocator.ReleaseCompletedIndices(std::span<const uint64_t>(completedFenceValues, m_NumFences));
+        index = m_IndexAllocator.Allocate();
+    }
+
+    if (index == BindlessIndexAllocator::InvalidIndex)
+    {
+        throw std::bad_alloc();
+    }
+
+    return BindlessDescriptor(index, shared_from_this());
+}
+
+void DDM::BindlessDescriptorHeap::ReleaseStaleDescriptors()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    uint64_t completedFenceValues[BindlessIndexAllocator::MaxNumFences];
+    GetCompletedFenceValues(completedFenceValues);
+
+    m_IndexAllocator.ReleaseCompletedIndices(std::span<const uint64_t>(completedFenceValues, m_NumFences));
+}
+
+void DDM::BindlessDescriptorHeap::ReleaseCommandQueues()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_CommandQueues.clear();
+
+    // The queues are flushed, so everything that is pending can be reused.
+    uint64_t completedFenceValues[BindlessIndexAllocator::MaxNumFences];
+    std::fill_n(completedFenceValues, m_NumFences, UINT64_MAX);
+
+    m_IndexAllocator.ReleaseCompletedIndices(std::span<const uint64_t>(completedFenceValues, m_NumFences));
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::BindlessDescriptorHeap::GetCPUDescriptorHandle(uint32_t index) const
+{
+    assert(index < m_NumDescriptors);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_BaseCPUDescriptor, index, m_DescriptorHandleIncrementSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DDM::BindlessDescriptorHeap::GetGPUDescriptorHandle(uint32_t index) const
+{
+    assert(index < m_NumDescriptors);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_BaseGPUDescriptor, index, m_DescriptorHandleIncrementSize);
+}
+
+uint32_t DDM::BindlessDescriptorHeap::GetNumAllocated() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    return m_IndexAllocator.GetNumAllocated();
+}
+
+void DDM::BindlessDescriptorHeap::Free(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Command lists that are still being recorded may reference the descriptor,
+    // so wait for the signal that follows their submission on every queue.
+    uint64_t fenceValues[BindlessIndexAllocator::MaxNumFences] = {};
+    for (size_t i = 0; i < m_CommandQueues.size(); ++i)
+    {
+        fenceValues[i] = m_CommandQueues[i]->GetNextFenceValue();
+    }
+
+    m_IndexAllocator.Free(index, std::span<const uint64_t>(fenceValues, m_NumFences));
+}
+
+void DDM::BindlessDescriptorHeap::GetCompletedFenceValues(uint64_t completedFenceValues[BindlessIndexAllocator::MaxNumFences]) const
+{
+    for (uint32_t i = 0; i < m_NumFences; ++i)
+    {
+        completedFenceValues[i] = i < m_CommandQueues.size() ? m_CommandQueues[i]->GetCompletedFenceValue() : UINT64_MAX;
+    }
+}
@@ -0,0 +1,144 @@
+// BindlessDescriptorHeap.h
+
+/**
+ * A single, large shader visible CBV/SRV/UAV descriptor heap for bindless rendering.
+ *
+ * Resources write their views into the heap once, when they are created, and keep
+ * the index of that descriptor for their lifetime. Shaders access the views through
+ * ResourceDescriptorHeap[index], so nothing has to be staged or copied per draw.
+ * The heap has to be bound with CommandList::SetBindlessDescriptorHeap.
+ *
+ * Freed indices are held back until every command queue that can bind the heap has
+ * completed all the work that was submitted before the descriptor was freed.
+ */
+
+#ifndef _BINDLESS_DESCRIPTOR_HEAP_
+#define _BINDLESS_DESCRIPTOR_HEAP_
+
+// File includes
+#include "BindlessIndexAllocator.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace DDM
+{
+	// Class forward declarations
+	class BindlessDescriptorHeap;
+	class CommandQueue;
+
+	// A descriptor in the bindless heap. The descriptor is freed when it is destroyed.
+	class BindlessDescriptor final
+	{
+	public:
+		// Creates a NULL descriptor
+		BindlessDescriptor();
+
+		BindlessDescriptor(uint32_t index, std::shared_ptr<BindlessDescriptorHeap> heap);
+
+		~BindlessDescriptor();
+
+		// Copies are not allowed.
+		BindlessDescriptor(const BindlessDescriptor&) = delete;
+		BindlessDescriptor& operator=(const BindlessDescriptor&) = delete;
+
+		// Move is allowed.
+		BindlessDescriptor(BindlessDescriptor&& other);
+		BindlessDescriptor& operator=(BindlessDescriptor&& other);
+
+		bool IsNull() const;
+
+		// Get the index that shaders use to access the descriptor.
+		uint32_t GetIndex() const;
+
+		// Get the CPU handle, used to write the view into the heap.
+		D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandle() const;
+
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle() const;
+
+	private:
+		void Free();
+
+		uint32_t m_Index;
+		std::shared_ptr<BindlessDescriptorHeap> m_Heap;
+	};
+
+	class BindlessDescriptorHeap final : public std::enable_shared_from_this<BindlessDescriptorHeap>
+	{
+	public:
+		static constexpr uint32_t DefaultNumDescriptors = 65536;
+
+		/**
+		 * @param commandQueues The queues that can bind the heap. Their fences decide
+		 * when a freed descriptor can be reused.
+		 * @param numDescriptors The number of descriptors in the heap.
+		 */
+		BindlessDescriptorHeap(std::span<CommandQueue* const> commandQueues, uint32_t numDescriptors = DefaultNumDescriptors);
+
+		~BindlessDescriptorHeap();
+
+		BindlessDescriptorHeap(BindlessDescriptorHeap& other) = delete;
+		BindlessDescriptorHeap(BindlessDescriptorHeap&& other) = delete;
+
+		BindlessDescriptorHeap& operator=(BindlessDescriptorHeap& other) = delete;
+		BindlessDescriptorHeap& operator=(BindlessDescriptorHeap&& other) = delete;
+
+		/**
+		 * Allocate a descriptor.
+		 * Throws std::bad_alloc if all the descriptors are in use.
+		 */
+		BindlessDescriptor Allocate();
+
+		/**
+		 * Return the descriptors of which the fence has completed to the free list.
+		 */
+		void ReleaseStaleDescriptors();
+
+		/**
+		 * Stop referencing the command queues, before they are destroyed.
+		 * The queues must be flushed, descriptors that are freed afterwards are reused right away.
+		 */
+		void ReleaseCommandQueues();
+
+		D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandle(uint32_t index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle(uint32_t index) const;
+
+		ID3D12DescriptorHeap* GetD3D12DescriptorHeap() const { return m_d3d12DescriptorHeap.Get(); }
+
+		uint32_t GetNumDescriptors() const { return m_NumDescriptors; }
+
+		// Get the number of descriptors that are in use, including the ones waiting for their fence.
+		uint32_t GetNumAllocated() const;
+
+	private:
+		friend class BindlessDescriptor;
+
+		// Free a descriptor, it is reused after the work that was submitted so far has completed.
+		void Free(uint32_t index);
+
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
+		D3D12_CPU_DESCRIPTOR_HANDLE m_BaseCPUDescriptor;
+		D3D12_GPU_DESCRIPTOR_HANDLE m_BaseGPUDescriptor;
+		uint32_t m_DescriptorHandleIncrementSize;
+		uint32_t m_NumDescriptors;
+
+		// Get the completed fence value of every queue, all zeros once the queues are released.
+		void GetCompletedFenceValues(uint64_t completedFenceValues[BindlessIndexAllocator::MaxNumFences]) const;
+
+		// Not owned, cleared by ReleaseCommandQueues.
+		std::vector<CommandQueue*> m_CommandQueues;
+		uint32_t m_NumFences;
+
+		BindlessIndexAllocator m_IndexAllocator;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_BINDLESS_DESCRIPTOR_HEAP_
@@ -0,0 +1,94 @@
+// BindlessIndexAllocator.cpp
+
+// Header include
+#include "BindlessIndexAllocator.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::BindlessIndexAllocator::BindlessIndexAllocator(uint32_t capacity, uint32_t numFences)
+    : m_Capacity(capacity)
+    , m_NumFences(numFences)
+    , m_NextUnusedIndex(0)
+    , m_NumAllocated(0)
+{
+    assert(numFences > 0 && numFences <= MaxNumFences);
+}
+
+DDM::BindlessIndexAllocator::~BindlessIndexAllocator()
+{
+}
+
+uint32_t DDM::BindlessIndexAllocator::Allocate()
+{
+    uint32_t index = InvalidIndex;
+
+    if (!m_FreeIndices.empty())
+    {
+        index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+    }
+    else if (m_NextUnusedIndex < m_Capacity)
+    {
+        index = m_NextUnusedIndex++;
+    }
+    else
+    {
+        return InvalidIndex;
+    }
+
+    ++m_NumAllocated;
+
+    return index;
+}
+
+void DDM::BindlessIndexAllocator::Free(uint32_t index, std::span<const uint64_t> fenceValues)
+{
+    assert(index < m_NextUnusedIndex && "The index was not allocated by this allocator.");
+    assert(fenceValues.size() == m_NumFences);
+
+    PendingIndex pendingIndex = { index, {} };
+    bool hasFenceValue = false;
+
+    for (uint32_t i = 0; i < m_NumFences; ++i)
+    {
+        pendingIndex.FenceValues[i] = fenceValues[i];
+        hasFenceValue |= fenceValues[i] != 0;
+    }
+
+    if (!hasFenceValue)
+    {
+        m_FreeIndices.push_back(index);
+        --m_NumAllocated;
+        return;
+    }
+
+    m_PendingIndices.push_back(pendingIndex);
+}
+
+void DDM::BindlessIndexAllocator::ReleaseCompletedIndices(std::span<const uint64_t> completedFenceValues)
+{
+    assert(completedFenceValues.size() == m_NumFences);
+
+    auto isCompleted = [this, completedFenceValues](const PendingIndex& pendingIndex)
+        {
+            for (uint32_t i = 0; i < m_NumFences; ++i)
+            {
+                if (pendingIndex.FenceValues[i] > completedFenceValues[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+    // Indices are freed with increasing fence values, so stop at the first one that is still in flight.
+    while (!m_PendingIndices.empty() && isCompleted(m_PendingIndices.front()))
+    {
+        m_FreeIndices.push_back(m_PendingIndices.front().Index);
+        m_PendingIndices.pop_front();
+
+        --m_NumAllocated;
+    }
+}
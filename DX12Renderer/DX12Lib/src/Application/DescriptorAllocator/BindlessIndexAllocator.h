@@ -0,0 +1,116 @@
+// BindlessIndexAllocator.h
+
+/**
+ * Allocator for the indices of a bindless descriptor heap.
+ *
+ * Every index refers to a single descriptor that keeps its place in the heap for
+ * the lifetime of the resource, so shaders can address it directly. Indices are
+ * handed out from a free list, with the most recently released index reused first,
+ * and never used indices are taken in order once the free list is empty.
+ * A freed index may still be read by GPU work that is in flight, so it is held back
+ * until the fence values it was freed with have completed. There is one fence per
+ * command queue that can read the descriptors.
+ *
+ * This class only manages indices and does not depend on a D3D12 device, the
+ * completed fence values are passed in by the caller.
+ */
+
+#ifndef _BINDLESS_INDEX_ALLOCATOR_
+#define _BINDLESS_INDEX_ALLOCATOR_
+
+// Standard library includes
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace DDM
+{
+	class BindlessIndexAllocator final
+	{
+	public:
+		// Returned by Allocate if all the indices are in use.
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		// The maximum number of fences a freed index can wait for.
+		static constexpr uint32_t MaxNumFences = 4;
+
+		/**
+		 * @param capacity The number of indices, the indices range from 0 to capacity - 1.
+		 * @param numFences The number of fences that freed indices wait for.
+		 */
+		explicit BindlessIndexAllocator(uint32_t capacity, uint32_t numFences = 1);
+
+		~BindlessIndexAllocator();
+
+		BindlessIndexAllocator(BindlessIndexAllocator& other) = delete;
+		BindlessIndexAllocator(BindlessIndexAllocator&& other) = delete;
+
+		BindlessIndexAllocator& operator=(BindlessIndexAllocator& other) = delete;
+		BindlessIndexAllocator& operator=(BindlessIndexAllocator&& other) = delete;
+
+		/**
+		 * Allocate an index.
+		 *
+		 * @return The index, or InvalidIndex if all the indices are in use or
+		 * waiting for their fence.
+		 */
+		uint32_t Allocate();
+
+		/**
+		 * Free an index. The index is reused once the completed value of every
+		 * fence reaches its fence value. A fence value of 0 does not wait, free
+		 * with only zeros to reuse the index right away.
+		 * @param fenceValues One fence value per fence.
+		 */
+		void Free(uint32_t index, std::span<const uint64_t> fenceValues);
+
+		// Free an index with the fence value of the only fence.
+		void Free(uint32_t index, uint64_t fenceValue) { Free(index, std::span<const uint64_t>(&fenceValue, 1)); }
+
+		/**
+		 * Return the freed indices of which every fence value is less than or equal
+		 * to the completed value of that fence to the free list.
+		 * @param completedFenceValues One completed fence value per fence.
+		 */
+		void ReleaseCompletedIndices(std::span<const uint64_t> completedFenceValues);
+
+		// Release the completed indices with the completed value of the only fence.
+		void ReleaseCompletedIndices(uint64_t completedFenceValue)
+		{
+			ReleaseCompletedIndices(std::span<const uint64_t>(&completedFenceValue, 1));
+		}
+
+		// Get the number of indices.
+		uint32_t GetCapacity() const { return m_Capacity; }
+
+		// Get the number of fences that freed indices wait for.
+		uint32_t GetNumFences() const { return m_NumFences; }
+
+		// Get the number of indices that are in use, including the ones waiting for their fence.
+		uint32_t GetNumAllocated() const { return m_NumAllocated; }
+
+		// Get the number of freed indices that are waiting for their fence.
+		uint32_t GetNumPending() const { return static_cast<uint32_t>(m_PendingIndices.size()); }
+
+	private:
+		struct PendingIndex
+		{
+			uint32_t Index;
+			uint64_t FenceValues[MaxNumFences];
+		};
+
+		// Indices that can be reused, the back is reused first.
+		std::vector<uint32_t> m_FreeIndices;
+		// Freed indices in the order they were freed.
+		std::deque<PendingIndex> m_PendingIndices;
+
+		uint32_t m_Capacity;
+		uint32_t m_NumFences;
+		// The first index that has never been handed out.
+		uint32_t m_NextUnusedIndex;
+		uint32_t m_NumAllocated;
+	};
+}
+
+#endif // !_BINDLESS_INDEX_ALLOCATOR_
@@ -81,7 +81,7 @@ void DDM::DescriptorAllocation::Free()
 {
 	if (!IsNull() && m_Page)
 	{
-		m_Page->Free(std::move(*this), Application::Get().FrameCount());
+		m_Page->Free(std::move(*this), Application::Get().GetFrameNumber());
 
 		m_Descriptor.ptr = 0;
 		m_NumHandles = 0;
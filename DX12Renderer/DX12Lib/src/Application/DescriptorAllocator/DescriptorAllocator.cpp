@@ -14,7 +14,9 @@
 
 DDM::DescriptorAllocator::DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap)
 	:m_HeapType(type),
-	m_NumDescriptorsPerHeap(numDescriptorsPerHeap)
+	m_NumDescriptorsPerHeap(numDescriptorsPerHeap),
+	m_StalePages(std::make_shared<StaleDescriptorPageList>()),
+	m_SingleDescriptorPage(nullptr)
 {
 }
 
@@ -24,26 +26,61 @@ DDM::DescriptorAllocator::~DescriptorAllocator()
 
 DDM::DescriptorAllocation DDM::DescriptorAllocator::Allocate(uint32_t numDescriptors)
 {
+    // Fast path: pop a reserved single descriptor without taking any lock.
+    if (numDescriptors == 1)
+    {
+        DescriptorAllocatorPage* singleDescriptorPage = m_SingleDescriptorPage.load(std::memory_order_acquire);
+        if (singleDescriptorPage)
+        {
+            DescriptorAllocation allocation = singleDescriptorPage->TryAllocateSingle();
+            if (!allocation.IsNull())
+            {
+                return allocation;
+            }
+        }
+    }
+
     std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
     DescriptorAllocation allocation;
 
-    for (auto iter = m_AvailableHeaps.begin(); iter != m_AvailableHeaps.end(); ++iter)
+    // The page with the smallest largest free block that can still satisfy the request.
+    for (auto iter = m_PagesByLargestFreeBlock.lower_bound({ numDescriptors, 0 });
+        iter != m_PagesByLargestFreeBlock.end();
+        iter = m_PagesByLargestFreeBlock.lower_bound({ numDescriptors, 0 }))
     {
-        auto allocatorPage = m_HeapPool[*iter];
+        size_t pageIndex = iter->second;
 
-        allocation = allocatorPage->Allocate(numDescriptors);
+        allocation = m_HeapPool[pageIndex]->Allocate(numDescriptors);
 
-        if (allocatorPage->NumFreeHandles() == 0)
-        {
-            iter = m_AvailableHeaps.erase(iter);
-        }
+        UpdatePageKey(pageIndex);
 
         // A valid allocation has been found.
         if (!allocation.IsNull())
         {
             break;
         }
+
+        // The key can only be too large if single descriptors were taken from the page
+        // without the lock. After the update the page is no longer a candidate.
+        if (m_PageLargestFreeBlock[pageIndex] >= numDescriptors)
+        {
+            break;
+        }
+    }
+
+    // The single descriptors that are reserved on a page may close the gaps between its
+    // free blocks. Only the page with the largest free block is tried, the page itself
+    // checks whether its free handles can form a large enough block.
+    if (allocation.IsNull() && numDescriptors > 1 && !m_PagesByLargestFreeBlock.empty() &&
+        m_PagesByLargestFreeBlock.rbegin()->first < numDescriptors)
+    {
+        // Pages with a large enough key have already been tried above.
+        size_t pageIndex = m_PagesByLargestFreeBlock.rbegin()->second;
+
+        allocation = m_HeapPool[pageIndex]->Allocate(numDescriptors);
+
+        UpdatePageKey(pageIndex);
     }
 
     // No available heap could satisfy the requested number of descriptors.
@@ -53,6 +90,14 @@ DDM::DescriptorAllocation DDM::DescriptorAllocator::Allocate(uint32_t numDescrip
         auto newPage = CreateAllocatorPage();
 
         allocation = newPage->Allocate(numDescriptors);
+
+        UpdatePageKey(m_HeapPool.size() - 1);
+    }
+
+    if (numDescriptors == 1 && !allocation.IsNull())
+    {
+        // Serve the next single descriptors from the same page.
+        m_SingleDescriptorPage.store(allocation.GetDescriptorAllocatorPage().get(), std::memory_order_release);
     }
 
     return allocation;
@@ -62,25 +107,50 @@ void DDM::DescriptorAllocator::ReleaseStaleDescriptors(uint64_t frameNumber)
 {
     std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
-    for (size_t i = 0; i < m_HeapPool.size(); ++i)
     {
-        auto page = m_HeapPool[i];
+        std::lock_guard<std::mutex> staleLock(m_StalePages->Mutex);
+        m_PagesToRelease.swap(m_StalePages->PageIndices);
+    }
 
-        page->ReleaseStaleDescriptors(frameNumber);
+    // Pages that still have descriptors of frames in flight add themselves to the list again.
+    for (uint32_t pageIndex : m_PagesToRelease)
+    {
+        m_HeapPool[pageIndex]->ReleaseStaleDescriptors(frameNumber);
 
-        if (page->NumFreeHandles() > 0)
-        {
-            m_AvailableHeaps.insert(i);
-        }
+        UpdatePageKey(pageIndex);
     }
+
+    m_PagesToRelease.clear();
 }
 
 std::shared_ptr<DDM::DescriptorAllocatorPage> DDM::DescriptorAllocator::CreateAllocatorPage()
 {
-	auto newPage = std::make_shared<DescriptorAllocatorPage>(m_HeapType, m_NumDescriptorsPerHeap);
+	size_t pageIndex = m_HeapPool.size();
+
+	auto newPage = std::make_shared<DescriptorAllocatorPage>(m_HeapType, m_NumDescriptorsPerHeap,
+		m_StalePages, static_cast<uint32_t>(pageIndex));
 
 	m_HeapPool.emplace_back(newPage);
-	m_AvailableHeaps.insert(m_HeapPool.size() - 1);
+	m_PageLargestFreeBlock.emplace_back(newPage->GetLargestFreeBlock());
+	m_PagesByLargestFreeBlock.insert({ m_PageLargestFreeBlock.back(), pageIndex });
 
 	return newPage;
 }
+
+void DDM::DescriptorAllocator::UpdatePageKey(size_t pageIndex)
+{
+	uint32_t largestFreeBlock = m_HeapPool[pageIndex]->GetLargestFreeBlock();
+	uint32_t& currentKey = m_PageLargestFreeBlock[pageIndex];
+
+	if (largestFreeBlock == currentKey)
+	{
+		return;
+	}
+
+	// Reuse the node of the set so updating the index does not allocate.
+	auto node = m_PagesByLargestFreeBlock.extract({ currentKey, pageIndex });
+	node.value().first = largestFreeBlock;
+	m_PagesByLargestFreeBlock.insert(std::move(node));
+
+	currentKey = largestFreeBlock;
+}
@@ -30,15 +30,18 @@
 #include "Includes/DirectXIncludes.h"
 
 // Standard library includes
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 namespace DDM
 {
 	class DescriptorAllocatorPage;
+	struct StaleDescriptorPageList;
 
     class DescriptorAllocator
     {
@@ -48,6 +51,14 @@ namespace DDM
 
         /**
          * Allocate a number of contiguous descriptors from a CPU visible descriptor heap.
+         * Single descriptor requests first try the lock-free single descriptor stack of
+         * the page that last served one, and only take the allocator lock when that
+         * stack is empty.
+         *
+         * Other requests go straight to the page with the smallest largest free block
+         * that can still hold the descriptors. If there is none, the page with the
+         * largest free block may merge its reserved single descriptors into a large
+         * enough block, otherwise a new page is created.
          *
          * @param numDescriptors The number of contiguous descriptors to allocate.
          * Cannot be more than the number of descriptors per descriptor heap.
@@ -56,20 +67,40 @@ namespace DDM
 
         /**
          * When the frame has completed, the stale descriptors can be released.
+         * Only the pages that have stale descriptors are visited.
          */
         void ReleaseStaleDescriptors(uint64_t frameNumber);
     private:
         using DescriptorHeapPool = std::vector< std::shared_ptr<DescriptorAllocatorPage> >;
 
+        // (largest free block, index in the heap pool)
+        using PageKey = std::pair<uint32_t, size_t>;
+
         // Create a new heap with a specific number of descriptors.
         std::shared_ptr<DescriptorAllocatorPage> CreateAllocatorPage();
 
+        // Move the page to its current position in the free block index.
+        void UpdatePageKey(size_t pageIndex);
+
         D3D12_DESCRIPTOR_HEAP_TYPE m_HeapType;
         uint32_t m_NumDescriptorsPerHeap;
 
         DescriptorHeapPool m_HeapPool;
-        // Indices of available heaps in the heap pool.
-        std::set<size_t> m_AvailableHeaps;
+        // Every page in the heap pool ordered by its largest free block.
+        std::set<PageKey> m_PagesByLargestFreeBlock;
+        // The key each page is currently stored with in m_PagesByLargestFreeBlock.
+        std::vector<uint32_t> m_PageLargestFreeBlock;
+
+        // Pages with stale descriptors add themselves to this list.
+        std::shared_ptr<StaleDescriptorPageList> m_StalePages;
+        // The pages that are processed by ReleaseStaleDescriptors. The vector is
+        // swapped with the stale page list so neither of them has to reallocate.
+        std::vector<uint32_t> m_PagesToRelease;
+
+        // The page that served the last single descriptor allocation.
+        // Pages are never removed from the heap pool, so the pointer stays valid
+        // for the lifetime of the allocator.
+        std::atomic<DescriptorAllocatorPage*> m_SingleDescriptorPage;
 
         std::mutex m_AllocationMutex;
     };
@@ -7,8 +7,30 @@
 #include "Application/Application.h"
 #include "Includes/DXRHelpersIncludes.h"
 
-DDM::DescriptorAllocatorPage::DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors)
-    : m_HeapType(type)
+// Standard library includes
+#include <algorithm>
+
+// Pack the ABA tag and the offset of the top of the single descriptor stack.
+static uint64_t PackSingleHead(uint32_t tag, uint32_t offset)
+{
+    return (static_cast<uint64_t>(tag) << 32) | offset;
+}
+
+DDM::DescriptorAllocatorPage::DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors,
+    std::shared_ptr<StaleDescriptorPageList> stalePages, uint32_t pageIndex)
+    : m_FreeList(numDescriptors)
+    , m_StaleDescriptors(numDescriptors)
+    , m_SingleDescriptorNext(std::make_unique<std::atomic<uint32_t>[]>(numDescriptors))
+    , m_SingleDescriptorFrameNumber(std::make_unique<uint64_t[]>(numDescriptors))
+    , m_SingleFreeHead(PackSingleHead(0, TLSFBlockAllocator::InvalidOffset))
+    , m_SingleStaleHead(TLSFBlockAllocator::InvalidOffset)
+    , m_NumFreeSingleDescriptors(0)
+    , m_NumFreeHandles(numDescriptors)
+    , m_LargestFreeBlock(numDescriptors)
+    , m_StalePages(std::move(stalePages))
+    , m_PageIndex(pageIndex)
+    , m_IsQueuedForRelease(false)
+    , m_HeapType(type)
     , m_NumDescriptorsInHeap(numDescriptors)
 {
     auto device = Application::Get().GetDevice();
@@ -21,10 +43,6 @@ DDM::DescriptorAllocatorPage::DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE
 
     m_BaseDescriptor = m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
     m_DescriptorHandleIncrementSize = device->GetDescriptorHandleIncrementSize(m_HeapType);
-    m_NumFreeHandles = m_NumDescriptorsInHeap;
-
-    // Initialize the free lists
-    AddNewBlock(0, m_NumFreeHandles);
 }
 
 DDM::DescriptorAllocatorPage::~DescriptorAllocatorPage()
@@ -38,88 +56,190 @@ D3D12_DESCRIPTOR_HEAP_TYPE DDM::DescriptorAllocatorPage::GetHeapType() const
 
 bool DDM::DescriptorAllocatorPage::HasSpace(uint32_t numDescriptors) const
 {
-    return m_FreeListBySize.lower_bound(numDescriptors) != m_FreeListBySize.end();
+    if (numDescriptors == 1 && m_NumFreeSingleDescriptors.load(std::memory_order_relaxed) > 0)
+    {
+        return true;
+    }
+
+    return m_FreeList.HasSpace(numDescriptors);
 }
 
 uint32_t DDM::DescriptorAllocatorPage::NumFreeHandles() const
 {
-	return m_NumFreeHandles;
+	return m_NumFreeHandles.load(std::memory_order_relaxed);
 }
 
-DDM::DescriptorAllocation DDM::DescriptorAllocatorPage::Allocate(uint32_t numDescriptors)
+uint32_t DDM::DescriptorAllocatorPage::GetLargestFreeBlock() const
 {
-    std::lock_guard<std::mutex> lock(m_AllocationMutex);
-    // There are less than the requested number of descriptors left in the heap.
-   // Return a NULL descriptor and try another heap.
-    if (numDescriptors > m_NumFreeHandles)
+    uint32_t largestFreeBlock = m_LargestFreeBlock.load(std::memory_order_relaxed);
+
+    if (largestFreeBlock == 0 &&
+        static_cast<uint32_t>(m_SingleFreeHead.load(std::memory_order_relaxed)) != TLSFBlockAllocator::InvalidOffset)
     {
-        return DescriptorAllocation();
+        return 1;
     }
 
-    // Get the first block that is large enough to satisfy the request.
-    auto smallestBlockIt = m_FreeListBySize.lower_bound(numDescriptors);
-    if (smallestBlockIt == m_FreeListBySize.end())
+    return largestFreeBlock;
+}
+
+DDM::DescriptorAllocation DDM::DescriptorAllocatorPage::Allocate(uint32_t numDescriptors)
+{
+    if (numDescriptors == 1)
     {
-        // There was no free block that could satisfy the request.
-        return DescriptorAllocation();
+        DescriptorAllocation allocation = TryAllocateSingle();
+        if (!allocation.IsNull())
+        {
+            return allocation;
+        }
     }
-    // The size of the smallest block that satisfies the request.
-    auto blockSize = smallestBlockIt->first;
 
-    // The pointer to the same entry in the FreeListByOffset map.
-    auto offsetIt = smallestBlockIt->second;
-
-    // The offset in the descriptor heap.
-    auto offset = offsetIt->first;
-    // Remove the existing free block from the free list.
-    m_FreeListBySize.erase(smallestBlockIt);
-    m_FreeListByOffset.erase(offsetIt);
+    std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
-    // Compute the new free block that results from splitting this block.
-    auto newOffset = offset + numDescriptors;
-    auto newSize = blockSize - numDescriptors;
+    uint32_t offset = TLSFBlockAllocator::InvalidOffset;
 
-    if (newSize > 0)
+    if (numDescriptors == 1)
+    {
+        // Another thread may have refilled the stack while waiting for the lock.
+        if (!PopFreeSingleDescriptor(offset))
+        {
+            // The single descriptor stack is empty, refill it from the free list.
+            RefillSingleDescriptors();
+
+            if (!PopFreeSingleDescriptor(offset))
+            {
+                return DescriptorAllocation();
+            }
+        }
+    }
+    else
     {
-        // If the allocation didn't exactly match the requested size,
-        // return the left-over to the free list.
-        AddNewBlock(newOffset, newSize);
+        // Get a free block that is large enough to satisfy the request.
+        offset = m_FreeList.Allocate(numDescriptors);
+        if (offset == TLSFBlockAllocator::InvalidOffset && CanMergeSingleDescriptors(numDescriptors) &&
+            ReturnSingleDescriptors(SingleDescriptorBatchSize))
+        {
+            // The reserved single descriptors may close the gaps between free blocks.
+            offset = m_FreeList.Allocate(numDescriptors);
+        }
+
+        if (offset == TLSFBlockAllocator::InvalidOffset)
+        {
+            // There was no free block that could satisfy the request.
+            // Return a NULL descriptor and try another heap.
+            return DescriptorAllocation();
+        }
+
+        UpdateLargestFreeBlock();
     }
+
     // Decrement free handles.
-    m_NumFreeHandles -= numDescriptors;
+    m_NumFreeHandles.fetch_sub(numDescriptors, std::memory_order_relaxed);
 
     return DescriptorAllocation(
         CD3DX12_CPU_DESCRIPTOR_HANDLE(m_BaseDescriptor, offset, m_DescriptorHandleIncrementSize),
         numDescriptors, m_DescriptorHandleIncrementSize, shared_from_this());
 }
 
+DDM::DescriptorAllocation DDM::DescriptorAllocatorPage::TryAllocateSingle()
+{
+    uint32_t offset;
+    if (!PopFreeSingleDescriptor(offset))
+    {
+        return DescriptorAllocation();
+    }
+
+    m_NumFreeHandles.fetch_sub(1, std::memory_order_relaxed);
+
+    return DescriptorAllocation(
+        CD3DX12_CPU_DESCRIPTOR_HANDLE(m_BaseDescriptor, offset, m_DescriptorHandleIncrementSize),
+        1, m_DescriptorHandleIncrementSize, shared_from_this());
+}
+
 void DDM::DescriptorAllocatorPage::Free(DescriptorAllocation&& descriptor, uint64_t frameNumber)
 {
     // Compute the offset of the descriptor within the descriptor heap.
     auto offset = ComputeOffset(descriptor.GetDescriptorHandle());
 
-    std::lock_guard<std::mutex> lock(m_AllocationMutex);
+    // Single descriptors always come from the single descriptor stack
+    // and are returned to it without taking the lock.
+    if (descriptor.GetNumHandles() == 1)
+    {
+        PushStaleSingleDescriptor(offset, frameNumber);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
-    // Don't add the block directly to the free list until the frame has completed.
-    m_StaleDescriptors.emplace(offset, descriptor.GetNumHandles(), frameNumber);
+        // Don't add the block directly to the free list until the frame has completed.
+        m_StaleDescriptors.Push({ offset, descriptor.GetNumHandles(), frameNumber });
+    }
+
+    QueueStaleRelease();
 }
 
 void DDM::DescriptorAllocatorPage::ReleaseStaleDescriptors(uint64_t frameNumber)
 {
-    std::lock_guard<std::mutex> lock(m_AllocationMutex);
+    // Clear the flag first, descriptors that are freed from here on queue the page again.
+    m_IsQueuedForRelease.store(false, std::memory_order_seq_cst);
 
-    while (!m_StaleDescriptors.empty() && m_StaleDescriptors.front().FrameNumber <= frameNumber)
+    bool hasPendingDescriptors = false;
+
+    // Take the whole stale single descriptor list. Descriptors that are freed
+    // while the list is processed are pushed to a new list and handled next time.
+    uint32_t staleOffset = m_SingleStaleHead.exchange(TLSFBlockAllocator::InvalidOffset, std::memory_order_acquire);
+    while (staleOffset != TLSFBlockAllocator::InvalidOffset)
     {
-        auto& staleDescriptor = m_StaleDescriptors.front();
+        uint32_t nextOffset = m_SingleDescriptorNext[staleOffset].load(std::memory_order_relaxed);
+        uint64_t staleFrameNumber = m_SingleDescriptorFrameNumber[staleOffset];
+
+        if (staleFrameNumber <= frameNumber)
+        {
+            PushFreeSingleDescriptor(staleOffset);
+            m_NumFreeHandles.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            // The frame the descriptor was freed in is still in flight.
+            PushStaleSingleDescriptor(staleOffset, staleFrameNumber);
+            hasPendingDescriptors = true;
+        }
+
+        staleOffset = nextOffset;
+    }
 
-        // The offset of the descriptor in the heap.
-        auto offset = staleDescriptor.Offset;
-        // The number of descriptors that were allocated.
-        auto numDescriptors = staleDescriptor.Size;
+    {
+        std::lock_guard<std::mutex> lock(m_AllocationMutex);
+
+        while (!m_StaleDescriptors.Empty() && m_StaleDescriptors.FrontEntry().FrameNumber <= frameNumber)
+        {
+            auto& staleDescriptor = m_StaleDescriptors.FrontEntry();
+
+            // The offset of the descriptor in the heap.
+            auto offset = staleDescriptor.Offset;
+            // The number of descriptors that were allocated.
+            auto numDescriptors = staleDescriptor.Size;
+
+            FreeBlock(offset, numDescriptors);
+
+            m_StaleDescriptors.Pop();
+        }
+
+        hasPendingDescriptors |= !m_StaleDescriptors.Empty();
 
-        FreeBlock(offset, numDescriptors);
+        // Don't let released single descriptors pile up on the stack, where they
+        // are lost to allocations of more than one descriptor.
+        if (m_NumFreeSingleDescriptors.load(std::memory_order_relaxed) > SingleDescriptorHighWatermark)
+        {
+            ReturnSingleDescriptors(SingleDescriptorBatchSize);
+        }
 
-        m_StaleDescriptors.pop();
+        UpdateLargestFreeBlock();
+    }
+
+    // Descriptors of frames that are still in flight are released next time.
+    if (hasPendingDescriptors)
+    {
+        QueueStaleRelease();
     }
 }
 
@@ -128,75 +248,136 @@ uint32_t DDM::DescriptorAllocatorPage::ComputeOffset(D3D12_CPU_DESCRIPTOR_HANDLE
     return static_cast<uint32_t>(handle.ptr - m_BaseDescriptor.ptr) / m_DescriptorHandleIncrementSize;
 }
 
-void DDM::DescriptorAllocatorPage::AddNewBlock(uint32_t offset, uint32_t numDescriptors)
+void DDM::DescriptorAllocatorPage::FreeBlock(uint32_t offset, uint32_t numDescriptors)
 {
-    auto offsetIt = m_FreeListByOffset.emplace(offset, numDescriptors);
-    auto sizeIt = m_FreeListBySize.emplace(numDescriptors, offsetIt.first);
-    offsetIt.first->second.FreeListBySizeIt = sizeIt;
+    // The TLSF free list merges the block with its free neighbours in constant time.
+    m_FreeList.Free(offset, numDescriptors);
+
+    // Add the number of free handles back to the heap.
+    m_NumFreeHandles.fetch_add(numDescriptors, std::memory_order_relaxed);
 }
 
-void DDM::DescriptorAllocatorPage::FreeBlock(uint32_t offset, uint32_t numDescriptors)
+void DDM::DescriptorAllocatorPage::RefillSingleDescriptors()
 {
-    // Find the first element whose offset is greater than the specified offset.
-    // This is the block that should appear after the block that is being freed.
-    auto nextBlockIt = m_FreeListByOffset.upper_bound(offset);
+    // Prefer one contiguous batch, otherwise collect whatever single descriptors are left.
+    uint32_t batchSize = std::min(SingleDescriptorBatchSize, m_FreeList.GetNumFree());
+    if (batchSize == 0)
+    {
+        return;
+    }
 
-    // Find the block that appears before the block being freed.
-    auto prevBlockIt = nextBlockIt;
-    // If it's not the first block in the list.
-    if (prevBlockIt != m_FreeListByOffset.begin())
+    uint32_t offset = m_FreeList.Allocate(batchSize);
+    if (offset != TLSFBlockAllocator::InvalidOffset)
     {
-        // Go to the previous block in the list.
-        --prevBlockIt;
+        // Push in reverse so the descriptors are handed out in order.
+        for (uint32_t i = batchSize; i > 0; --i)
+        {
+            PushFreeSingleDescriptor(offset + i - 1);
+        }
     }
     else
     {
-        // Otherwise, just set it to the end of the list to indicate that no
-        // block comes before the one being freed.
-        prevBlockIt = m_FreeListByOffset.end();
+        for (uint32_t i = 0; i < batchSize; ++i)
+        {
+            offset = m_FreeList.Allocate(1);
+            if (offset == TLSFBlockAllocator::InvalidOffset)
+            {
+                break;
+            }
+
+            PushFreeSingleDescriptor(offset);
+        }
     }
 
-    // Add the number of free handles back to the heap.
-    // This needs to be done before merging any blocks since merging
-    // blocks modifies the numDescriptors variable.
-    m_NumFreeHandles += numDescriptors;
+    UpdateLargestFreeBlock();
+}
 
-    if (prevBlockIt != m_FreeListByOffset.end() &&
-        offset == prevBlockIt->first + prevBlockIt->second.Size)
-    {
-        // The previous block is exactly behind the block that is to be freed.
-        //
-        // PrevBlock.Offset           Offset
-        // |                          |
-        // |<-----PrevBlock.Size----->|<------Size-------->|
-        //
+bool DDM::DescriptorAllocatorPage::CanMergeSingleDescriptors(uint32_t numDescriptors) const
+{
+    // A batch stays on the stack, so the next single descriptor allocations remain lock-free.
+    uint32_t numSingleDescriptors = m_NumFreeSingleDescriptors.load(std::memory_order_relaxed);
+    uint32_t numToReturn = numSingleDescriptors - std::min(numSingleDescriptors, SingleDescriptorBatchSize);
+
+    return m_FreeList.GetNumFree() + numToReturn >= numDescriptors;
+}
 
-        // Increase the block size by the size of merging with the previous block.
-        offset = prevBlockIt->first;
-        numDescriptors += prevBlockIt->second.Size;
+bool DDM::DescriptorAllocatorPage::ReturnSingleDescriptors(uint32_t numToKeep)
+{
+    bool hasReturned = false;
 
-        // Remove the previous block from the free list.
-        m_FreeListBySize.erase(prevBlockIt->second.FreeListBySizeIt);
-        m_FreeListByOffset.erase(prevBlockIt);
+    uint32_t offset;
+    while (m_NumFreeSingleDescriptors.load(std::memory_order_relaxed) > numToKeep &&
+        PopFreeSingleDescriptor(offset))
+    {
+        // The descriptor is still counted in m_NumFreeHandles, so only the free list changes.
+        m_FreeList.Free(offset, 1);
+        hasReturned = true;
     }
 
-    if (nextBlockIt != m_FreeListByOffset.end() &&
-        offset + numDescriptors == nextBlockIt->first)
+    return hasReturned;
+}
+
+void DDM::DescriptorAllocatorPage::PushFreeSingleDescriptor(uint32_t offset)
+{
+    uint64_t head = m_SingleFreeHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do
     {
-        // The next block is exactly in front of the block that is to be freed.
-        //
-        // Offset               NextBlock.Offset 
-        // |                    |
-        // |<------Size-------->|<-----NextBlock.Size----->|
+        m_SingleDescriptorNext[offset].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        newHead = PackSingleHead(static_cast<uint32_t>(head >> 32) + 1, offset);
+    } while (!m_SingleFreeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
 
-        // Increase the block size by the size of merging with the next block.
-        numDescriptors += nextBlockIt->second.Size;
+    m_NumFreeSingleDescriptors.fetch_add(1, std::memory_order_relaxed);
+}
 
-        // Remove the next block from the free list.
-        m_FreeListBySize.erase(nextBlockIt->second.FreeListBySizeIt);
-        m_FreeListByOffset.erase(nextBlockIt);
+bool DDM::DescriptorAllocatorPage::PopFreeSingleDescriptor(uint32_t& offset)
+{
+    uint64_t head = m_SingleFreeHead.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint32_t topOffset = static_cast<uint32_t>(head);
+        if (topOffset == TLSFBlockAllocator::InvalidOffset)
+        {
+            return false;
+        }
+
+        // The link may be stale if another thread popped the descriptor in the
+        // mean time, the tag makes the compare-exchange fail in that case.
+        uint32_t nextOffset = m_SingleDescriptorNext[topOffset].load(std::memory_order_relaxed);
+        uint64_t newHead = PackSingleHead(static_cast<uint32_t>(head >> 32) + 1, nextOffset);
+
+        if (m_SingleFreeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            m_NumFreeSingleDescriptors.fetch_sub(1, std::memory_order_relaxed);
+            offset = topOffset;
+            return true;
+        }
     }
-    // Add the freed block to the free list.
-    AddNewBlock(offset, numDescriptors);
 }
 
+void DDM::DescriptorAllocatorPage::PushStaleSingleDescriptor(uint32_t offset, uint64_t frameNumber)
+{
+    m_SingleDescriptorFrameNumber[offset] = frameNumber;
+
+    uint32_t head = m_SingleStaleHead.load(std::memory_order_relaxed);
+    do
+    {
+        m_SingleDescriptorNext[offset].store(head, std::memory_order_relaxed);
+    } while (!m_SingleStaleHead.compare_exchange_weak(head, offset, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void DDM::DescriptorAllocatorPage::QueueStaleRelease()
+{
+    if (!m_StalePages || m_IsQueuedForRelease.exchange(true, std::memory_order_seq_cst))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_StalePages->Mutex);
+    m_StalePages->PageIndices.push_back(m_PageIndex);
+}
+
+void DDM::DescriptorAllocatorPage::UpdateLargestFreeBlock()
+{
+    m_LargestFreeBlock.store(m_FreeList.GetLargestFreeBlock(), std::memory_order_relaxed);
+}
@@ -27,21 +27,41 @@
 
 // File includes
 #include "DescriptorAllocation.h"
+#include "TLSFBlockAllocator.h"
 #include "Includes/DirectXIncludes.h"
 
 // Standard library includes
 #include <wrl.h>
-#include <map>
+#include <atomic>
+#include <cassert>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 namespace DDM
 {
+	/**
+	 * The pages of a DescriptorAllocator that have stale descriptors.
+	 * A page adds itself when a descriptor is freed, so the allocator only has to
+	 * visit these pages when releasing stale descriptors.
+	 */
+	struct StaleDescriptorPageList
+	{
+		std::mutex Mutex;
+		// Indices of the pages in the heap pool of the allocator.
+		std::vector<uint32_t> PageIndices;
+	};
+
 	class DescriptorAllocatorPage : public std::enable_shared_from_this<DescriptorAllocatorPage>
 	{
 	public:
-		DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors);
+		/**
+		 * @param stalePages Optional list that the page adds its index to
+		 * when it has stale descriptors that need to be released.
+		 * @param pageIndex The index of the page in the heap pool of the allocator.
+		 */
+		DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors,
+			std::shared_ptr<StaleDescriptorPageList> stalePages = nullptr, uint32_t pageIndex = 0);
 
 		~DescriptorAllocatorPage();
 
@@ -64,13 +84,28 @@ namespace DDM
 		*/
 		uint32_t NumFreeHandles() const;
 
+		/**
+		 * Get the size of the largest contiguous block of descriptors that can be
+		 * allocated from this page. A single reserved descriptor counts as a block of one.
+		 */
+		uint32_t GetLargestFreeBlock() const;
+
 		/**
 		 * Allocate a number of descriptors from this descriptor heap.
 		 * If the allocation cannot be satisfied, then a NULL descriptor
 		 * is returned.
+		 * Single descriptors are served from the lock-free single descriptor stack,
+		 * which is refilled from the free list when it runs empty.
 		 */
 		DescriptorAllocation Allocate(uint32_t numDescriptors);
 
+		/**
+		 * Allocate a single descriptor without taking the page lock.
+		 * Returns a NULL descriptor if no reserved single descriptor is available,
+		 * in which case Allocate(1) must be used to refill the reserve.
+		 */
+		DescriptorAllocation TryAllocateSingle();
+
 		/**
 		* Return a descriptor back to the heap.
 		* @param frameNumber Stale descriptors are not freed directly, but put
@@ -81,6 +116,8 @@ namespace DDM
 
 		/**
 		 * Returned the stale descriptors back to the descriptor heap.
+		 * Single descriptors beyond the high watermark of the single descriptor stack
+		 * are returned to the free list, so they can be merged into larger blocks again.
 		 */
 		void ReleaseStaleDescriptors(uint64_t frameNumber);
 
@@ -89,46 +126,47 @@ namespace DDM
 		// Compute the offset of the descriptor handle from the start of the heap.
 		uint32_t ComputeOffset(D3D12_CPU_DESCRIPTOR_HANDLE handle);
 
-		// Adds a new block to the free list.
-		void AddNewBlock(uint32_t offset, uint32_t numDescriptors);
-
 		// Free a block of descriptors.
 		// This will also merge free blocks in the free list to form larger blocks
 		// that can be reused.
 		void FreeBlock(uint32_t offset, uint32_t numDescriptors);
 
+		// Move a batch of descriptors from the free list to the single descriptor stack.
+		// The allocation mutex must be held.
+		void RefillSingleDescriptors();
+
+		// Check whether the free list together with the single descriptors beyond one batch
+		// holds enough descriptors for the request. A merge can only succeed if it does.
+		// The allocation mutex must be held.
+		bool CanMergeSingleDescriptors(uint32_t numDescriptors) const;
+
+		// Move descriptors from the single descriptor stack back to the free list
+		// until at most numToKeep are left. The allocation mutex must be held.
+		// @return True if any descriptors were moved.
+		bool ReturnSingleDescriptors(uint32_t numToKeep);
+
+		// Lock-free push/pop on the single descriptor free stack.
+		void PushFreeSingleDescriptor(uint32_t offset);
+		bool PopFreeSingleDescriptor(uint32_t& offset);
+
+		// Lock-free push on the stale single descriptor list.
+		void PushStaleSingleDescriptor(uint32_t offset, uint64_t frameNumber);
+
+		// Add this page to the stale page list, unless it is already on it.
+		void QueueStaleRelease();
+
+		// Cache the largest free block of the free list.
+		// The allocation mutex must be held.
+		void UpdateLargestFreeBlock();
+
 	private:
 		// The offset (in descriptors) within the descriptor heap.
 		using OffsetType = uint32_t;
 		// The number of descriptors that are available.
 		using SizeType = uint32_t;
 
-		struct FreeBlockInfo;
-		// A map that lists the free blocks by the offset within the descriptor heap.
-		using FreeListByOffset = std::map<OffsetType, FreeBlockInfo>;
-
-		// A map that lists the free blocks by size.
-		// Needs to be a multimap since multiple blocks can have the same size.
-		using FreeListBySize = std::multimap<SizeType, FreeListByOffset::iterator>;
-
-		struct FreeBlockInfo
-		{
-			FreeBlockInfo(SizeType size)
-				: Size(size)
-			{}
-
-			SizeType Size;
-			FreeListBySize::iterator FreeListBySizeIt;
-		};
-
 		struct StaleDescriptorInfo
 		{
-			StaleDescriptorInfo(OffsetType offset, SizeType size, uint64_t frame)
-				: Offset(offset)
-				, Size(size)
-				, FrameNumber(frame)
-			{}
-
 			// The offset within the descriptor heap.
 			OffsetType Offset;
 			// The number of descriptors
@@ -139,18 +177,80 @@ namespace DDM
 
 		// Stale descriptors are queued for release until the frame that they were freed
 		// has completed.
-		using StaleDescriptorQueue = std::queue<StaleDescriptorInfo>;
+		// Every stale entry holds at least one descriptor, so a ring buffer with one
+		// entry per descriptor in the heap can never overflow and never reallocates.
+		struct StaleDescriptorQueue
+		{
+			explicit StaleDescriptorQueue(uint32_t capacity)
+				: Entries(std::make_unique<StaleDescriptorInfo[]>(capacity))
+				, Capacity(capacity)
+				, Front(0)
+				, Count(0)
+			{}
 
-		FreeListByOffset m_FreeListByOffset;
-		FreeListBySize m_FreeListBySize;
+			bool Empty() const { return Count == 0; }
+			StaleDescriptorInfo& FrontEntry() { return Entries[Front]; }
+
+			void Push(const StaleDescriptorInfo& info)
+			{
+				assert(Count < Capacity);
+				Entries[(Front + Count) % Capacity] = info;
+				++Count;
+			}
+
+			void Pop()
+			{
+				Front = (Front + 1) % Capacity;
+				--Count;
+			}
+
+			std::unique_ptr<StaleDescriptorInfo[]> Entries;
+			uint32_t Capacity;
+			uint32_t Front;
+			uint32_t Count;
+		};
+
+		// Two-level segregated fit free list of the descriptors in the heap.
+		TLSFBlockAllocator m_FreeList;
 		StaleDescriptorQueue m_StaleDescriptors;
 
+		// The number of descriptors that are moved to the single descriptor stack
+		// when it runs empty.
+		static constexpr uint32_t SingleDescriptorBatchSize = 32;
+		// Released single descriptors are returned to the free list once the single
+		// descriptor stack holds more than this, leaving one batch on the stack.
+		static constexpr uint32_t SingleDescriptorHighWatermark = 2 * SingleDescriptorBatchSize;
+
+		// Single descriptors are kept out of the free list in two intrusive lists
+		// that are linked through m_SingleDescriptorNext (a descriptor is in at most
+		// one of them at a time):
+		//   * The free stack (Treiber stack). The head packs a 32-bit ABA tag in the
+		//     upper bits and the offset of the top descriptor in the lower bits.
+		//   * The stale list. Freed single descriptors are pushed here with the frame
+		//     number they were freed in. ReleaseStaleDescriptors takes the whole list
+		//     at once and moves the descriptors of completed frames to the free stack.
+		std::unique_ptr<std::atomic<uint32_t>[]> m_SingleDescriptorNext;
+		std::unique_ptr<uint64_t[]> m_SingleDescriptorFrameNumber;
+		std::atomic<uint64_t> m_SingleFreeHead;
+		std::atomic<uint32_t> m_SingleStaleHead;
+		// The number of descriptors on the single descriptor free stack.
+		std::atomic<uint32_t> m_NumFreeSingleDescriptors;
+
+		// The number of free descriptors (free list and single descriptor stack).
+		std::atomic<uint32_t> m_NumFreeHandles;
+		// The largest free block in the free list, readable without the lock.
+		std::atomic<uint32_t> m_LargestFreeBlock;
+
+		std::shared_ptr<StaleDescriptorPageList> m_StalePages;
+		uint32_t m_PageIndex;
+		// Set while the page is on the stale page list.
+		std::atomic<bool> m_IsQueuedForRelease;
+
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
 		D3D12_DESCRIPTOR_HEAP_TYPE m_HeapType;
 		CD3DX12_CPU_DESCRIPTOR_HANDLE m_BaseDescriptor;
 		uint32_t m_DescriptorHandleIncrementSize;
 		uint32_t m_NumDescriptorsInHeap;
-		uint32_t m_NumFreeHandles;
 
 		std::mutex m_AllocationMutex;
 };
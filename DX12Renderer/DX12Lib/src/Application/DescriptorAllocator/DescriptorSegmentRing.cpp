@@ -0,0 +1,92 @@
+// DescriptorSegmentRing.cpp
+
+// Header include
+#include "DescriptorSegmentRing.h"
+
+// Standard library includes
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+DDM::DescriptorSegmentRing::DescriptorSegmentRing(uint32_t numDescriptors, uint32_t segmentSize, std::shared_ptr<Fence> fence)
+    : m_NumDescriptors(numDescriptors)
+    , m_SegmentSize(segmentSize)
+    , m_pFence(fence)
+    , m_Ring(numDescriptors)
+{
+    assert(m_SegmentSize > 0 && m_SegmentSize <= m_NumDescriptors);
+}
+
+DDM::DescriptorSegmentRing::~DescriptorSegmentRing()
+{
+}
+
+DDM::DescriptorSegmentRing::Segment DDM::DescriptorSegmentRing::Allocate(uint32_t numDescriptors)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    uint32_t segmentSize = std::max(numDescriptors, m_SegmentSize);
+
+    ReleaseCompletedSegments();
+
+    uint64_t offset = m_Ring.Allocate(segmentSize);
+    while (offset == FenceRingAllocator::InvalidOffset)
+    {
+        // The ring never grows, wait for the oldest segment to be reusable instead.
+        uint64_t fenceValue = m_Ring.GetTailFenceValue();
+        if (!m_pFence || fenceValue == 0 || fenceValue == FenceRingAllocator::PendingFenceValue)
+        {
+            // The segments are still leased by command lists that are being recorded.
+            throw std::bad_alloc();
+        }
+
+        if (m_pFence->GetCompletedValue() < fenceValue)
+        {
+            // Other recording threads and the retirement thread of the queue keep using
+            // the ring while this thread waits on the GPU. The ring may have changed by
+            // the time the lock is taken again, so the allocation is simply retried.
+            lock.unlock();
+
+            m_pFence->WaitForValue(fenceValue);
+
+            lock.lock();
+        }
+
+        ReleaseCompletedSegments();
+        offset = m_Ring.Allocate(segmentSize);
+    }
+
+    Segment segment;
+    segment.Offset = static_cast<uint32_t>(offset);
+    segment.NumDescriptors = segmentSize;
+
+    return segment;
+}
+
+void DDM::DescriptorSegmentRing::Retire(const Segment& segment, uint64_t fenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Ring.Retire(segment.Offset, fenceValue);
+}
+
+void DDM::DescriptorSegmentRing::ReclaimCompletedSegments()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ReleaseCompletedSegments();
+}
+
+uint32_t DDM::DescriptorSegmentRing::GetNumUsedDescriptors() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    return static_cast<uint32_t>(m_Ring.GetUsedSize());
+}
+
+void DDM::DescriptorSegmentRing::ReleaseCompletedSegments()
+{
+    uint64_t completedFenceValue = m_pFence ? m_pFence->GetCompletedValue() : 0;
+
+    m_Ring.ReleaseCompletedBlocks(completedFenceValue);
+}
@@ -0,0 +1,97 @@
+// DescriptorSegmentRing.h
+
+/**
+ * The segment bookkeeping of a ShaderVisibleDescriptorRing.
+ *
+ * Segments are ranges of descriptor indices that are leased from a FenceRingAllocator
+ * and retired with the fence value of the submission that uses them. The segments of
+ * completed submissions are reclaimed on the next allocation, or when the retirement
+ * thread of the queue calls ReclaimCompletedSegments. If the ring is full, Allocate
+ * waits on the fence for the oldest retired segment, without holding the lock.
+ *
+ * This class only depends on the Fence interface, so it can be driven by a fence
+ * that is signaled on the CPU.
+ */
+
+#ifndef _DESCRIPTOR_SEGMENT_RING_
+#define _DESCRIPTOR_SEGMENT_RING_
+
+// File includes
+#include "Application/FenceRingAllocator.h"
+#include "Application/FenceTimeline.h"
+
+// Standard library includes
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace DDM
+{
+	class DescriptorSegmentRing final
+	{
+	public:
+		// A range of descriptor indices leased from the ring.
+		struct Segment
+		{
+			// The index of the first descriptor of the segment.
+			uint32_t Offset;
+			uint32_t NumDescriptors;
+		};
+
+		/**
+		 * @param numDescriptors The number of descriptors in the ring.
+		 * @param segmentSize The number of descriptors a segment holds at least.
+		 * @param fence The fence that is signaled by the command queue that uses
+		 * the ring. Can be nullptr, in which case only segments that are retired
+		 * with a fence value of 0 are reused.
+		 */
+		DescriptorSegmentRing(uint32_t numDescriptors, uint32_t segmentSize, std::shared_ptr<Fence> fence);
+
+		~DescriptorSegmentRing();
+
+		DescriptorSegmentRing(DescriptorSegmentRing& other) = delete;
+		DescriptorSegmentRing(DescriptorSegmentRing&& other) = delete;
+
+		DescriptorSegmentRing& operator=(DescriptorSegmentRing& other) = delete;
+		DescriptorSegmentRing& operator=(DescriptorSegmentRing&& other) = delete;
+
+		/**
+		 * Lease a segment of at least the segment size, or of numDescriptors if that is larger.
+		 * The segments of completed submissions are reclaimed first. If there is still no
+		 * room, this waits for the oldest retired segment to complete.
+		 * Throws std::bad_alloc if the ring is full of segments that have not been retired.
+		 */
+		Segment Allocate(uint32_t numDescriptors);
+
+		/**
+		 * Return a segment to the ring. The segment is reused once the fence
+		 * reaches the fence value.
+		 */
+		void Retire(const Segment& segment, uint64_t fenceValue);
+
+		// Reclaim the segments of which the fence value has completed, instead of on the next allocation.
+		void ReclaimCompletedSegments();
+
+		uint32_t GetNumDescriptors() const { return m_NumDescriptors; }
+
+		uint32_t GetSegmentSize() const { return m_SegmentSize; }
+
+		// Get the number of descriptors that are leased or waiting for their fence.
+		uint32_t GetNumUsedDescriptors() const;
+
+	private:
+		// The mutex has to be locked.
+		void ReleaseCompletedSegments();
+
+		uint32_t m_NumDescriptors;
+		uint32_t m_SegmentSize;
+
+		std::shared_ptr<Fence> m_pFence;
+
+		FenceRingAllocator m_Ring;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_DESCRIPTOR_SEGMENT_RING_
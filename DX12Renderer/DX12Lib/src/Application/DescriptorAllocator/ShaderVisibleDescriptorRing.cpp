@@ -0,0 +1,64 @@
+// ShaderVisibleDescriptorRing.cpp
+
+// Header include
+#include "ShaderVisibleDescriptorRing.h"
+
+// File includes
+#include "Application/Application.h"
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::ShaderVisibleDescriptorRing::ShaderVisibleDescriptorRing(D3D12_DESCRIPTOR_HEAP_TYPE heapType,
+    std::shared_ptr<Fence> fence, uint32_t numDescriptors, uint32_t segmentSize)
+    : m_HeapType(heapType)
+    , m_Segments(numDescriptors != 0 ? numDescriptors
+            : heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? DefaultNumSamplerDescriptors : DefaultNumResourceDescriptors,
+        segmentSize != 0 ? segmentSize
+            : heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? DefaultSamplerSegmentSize : DefaultResourceSegmentSize,
+        fence)
+{
+    assert((heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+        && "Only CBV/SRV/UAV and sampler heaps can be shader visible.");
+
+    auto device = Application::Get().GetDevice();
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = m_HeapType;
+    heapDesc.NumDescriptors = m_Segments.GetNumDescriptors();
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_d3d12DescriptorHeap)));
+
+    m_BaseCPUDescriptor = m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_BaseGPUDescriptor = m_d3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    m_DescriptorHandleIncrementSize = device->GetDescriptorHandleIncrementSize(m_HeapType);
+}
+
+DDM::ShaderVisibleDescriptorRing::~ShaderVisibleDescriptorRing()
+{
+}
+
+DDM::ShaderVisibleDescriptorRing::Segment DDM::ShaderVisibleDescriptorRing::Allocate(uint32_t numDescriptors)
+{
+    DescriptorSegmentRing::Segment leasedSegment = m_Segments.Allocate(numDescriptors);
+
+    Segment segment;
+    segment.Offset = leasedSegment.Offset;
+    segment.NumDescriptors = leasedSegment.NumDescriptors;
+    segment.CPU = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_BaseCPUDescriptor, segment.Offset, m_DescriptorHandleIncrementSize);
+    segment.GPU = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_BaseGPUDescriptor, segment.Offset, m_DescriptorHandleIncrementSize);
+
+    return segment;
+}
+
+void DDM::ShaderVisibleDescriptorRing::Retire(const Segment& segment, uint64_t fenceValue)
+{
+    m_Segments.Retire({ segment.Offset, segment.NumDescriptors }, fenceValue);
+}
+
+void DDM::ShaderVisibleDescriptorRing::ReclaimCompletedSegments()
+{
+    m_Segments.ReclaimCompletedSegments();
+}
@@ -0,0 +1,111 @@
+// ShaderVisibleDescriptorRing.h
+
+/**
+ * A single, large shader visible descriptor heap that is shared by all the command
+ * lists of a command queue.
+ *
+ * The heap is managed by a DescriptorSegmentRing. Command lists lease segments of the
+ * heap for their dynamic descriptors and retire them with the fence value of the
+ * submission that uses them, so a segment is reused as soon as that submission has
+ * completed on the GPU. Because every command list uses the same heap, running out
+ * of space in a segment only means leasing the next one: the heap that is bound to
+ * the command list does not change.
+ *
+ * The heap never grows. If it is full, Allocate waits for the oldest retired segment
+ * to complete, without holding the lock of the ring.
+ */
+
+#ifndef _SHADER_VISIBLE_DESCRIPTOR_RING_
+#define _SHADER_VISIBLE_DESCRIPTOR_RING_
+
+// File includes
+#include "DescriptorSegmentRing.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+
+namespace DDM
+{
+	class ShaderVisibleDescriptorRing final
+	{
+	public:
+		// A range of descriptors leased from the ring.
+		struct Segment
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE CPU;
+			D3D12_GPU_DESCRIPTOR_HANDLE GPU;
+			// The index of the first descriptor of the segment in the heap.
+			uint32_t Offset;
+			uint32_t NumDescriptors;
+		};
+
+		// The default size of the heap and of the segments for each shader visible heap type.
+		static constexpr uint32_t DefaultNumResourceDescriptors = 65536;
+		static constexpr uint32_t DefaultResourceSegmentSize = 1024;
+		// Sampler heaps are limited to 2048 descriptors.
+		static constexpr uint32_t DefaultNumSamplerDescriptors = 2048;
+		static constexpr uint32_t DefaultSamplerSegmentSize = 128;
+
+		/**
+		 * @param heapType D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV or D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER.
+		 * @param fence The fence that is signaled by the command queue that uses
+		 * the ring. Can be nullptr, in which case only segments that are retired
+		 * with a fence value of 0 are reused.
+		 * @param numDescriptors The number of descriptors in the heap, 0 for the default of the heap type.
+		 * @param segmentSize The number of descriptors a segment holds at least, 0 for the default of the heap type.
+		 */
+		ShaderVisibleDescriptorRing(D3D12_DESCRIPTOR_HEAP_TYPE heapType, std::shared_ptr<Fence> fence,
+			uint32_t numDescriptors = 0, uint32_t segmentSize = 0);
+
+		~ShaderVisibleDescriptorRing();
+
+		ShaderVisibleDescriptorRing(ShaderVisibleDescriptorRing& other) = delete;
+		ShaderVisibleDescriptorRing(ShaderVisibleDescriptorRing&& other) = delete;
+
+		ShaderVisibleDescriptorRing& operator=(ShaderVisibleDescriptorRing& other) = delete;
+		ShaderVisibleDescriptorRing& operator=(ShaderVisibleDescriptorRing&& other) = delete;
+
+		/**
+		 * Lease a segment of at least the segment size, or of numDescriptors if that is larger.
+		 * The segments of completed submissions are reclaimed first. If there is still no
+		 * room, this waits for the oldest retired segment to complete.
+		 * Throws std::bad_alloc if the heap is full of segments that have not been retired.
+		 */
+		Segment Allocate(uint32_t numDescriptors);
+
+		/**
+		 * Return a segment to the ring. The segment is reused once the fence
+		 * reaches the fence value.
+		 */
+		void Retire(const Segment& segment, uint64_t fenceValue);
+
+		// Reclaim the segments of which the fence value has completed, instead of on the next allocation.
+		void ReclaimCompletedSegments();
+
+		ID3D12DescriptorHeap* GetD3D12DescriptorHeap() const { return m_d3d12DescriptorHeap.Get(); }
+
+		D3D12_DESCRIPTOR_HEAP_TYPE GetHeapType() const { return m_HeapType; }
+
+		uint32_t GetNumDescriptors() const { return m_Segments.GetNumDescriptors(); }
+
+		uint32_t GetSegmentSize() const { return m_Segments.GetSegmentSize(); }
+
+		// Get the number of descriptors that are leased or waiting for their fence.
+		uint32_t GetNumUsedDescriptors() const { return m_Segments.GetNumUsedDescriptors(); }
+
+	private:
+		D3D12_DESCRIPTOR_HEAP_TYPE m_HeapType;
+		uint32_t m_DescriptorHandleIncrementSize;
+
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
+		D3D12_CPU_DESCRIPTOR_HANDLE m_BaseCPUDescriptor;
+		D3D12_GPU_DESCRIPTOR_HANDLE m_BaseGPUDescriptor;
+
+		DescriptorSegmentRing m_Segments;
+	};
+}
+
+#endif // !_SHADER_VISIBLE_DESCRIPTOR_RING_
@@ -0,0 +1,277 @@
+// TLSFBlockAllocator.cpp
+
+// Header include
+#include "TLSFBlockAllocator.h"
+
+// Standard library includes
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+DDM::TLSFBlockAllocator::TLSFBlockAllocator(SizeType numElements)
+    : m_Blocks(std::make_unique<BlockInfo[]>(numElements))
+    , m_NumElements(numElements)
+    , m_NumFree(0)
+    , m_FirstLevelBitMask(0)
+    , m_SecondLevelBitMask{ 0 }
+{
+    for (SizeType i = 0; i < m_NumElements; ++i)
+    {
+        m_Blocks[i] = BlockInfo{ 0, InvalidOffset, InvalidOffset, InvalidOffset };
+    }
+
+    for (uint32_t fl = 0; fl < FirstLevelCount; ++fl)
+    {
+        for (uint32_t sl = 0; sl < SecondLevelCount; ++sl)
+        {
+            m_FreeLists[fl][sl] = InvalidOffset;
+        }
+    }
+
+    if (m_NumElements > 0)
+    {
+        // The whole range starts out as a single free block.
+        InsertFreeBlock(0, m_NumElements);
+        m_NumFree = m_NumElements;
+    }
+}
+
+DDM::TLSFBlockAllocator::~TLSFBlockAllocator()
+{
+}
+
+DDM::TLSFBlockAllocator::OffsetType DDM::TLSFBlockAllocator::Allocate(SizeType size)
+{
+    assert(size > 0);
+
+    // Early out if there are less free elements than requested.
+    if (size > m_NumFree)
+    {
+        return InvalidOffset;
+    }
+
+    OffsetType offset = FindFreeBlock(size);
+    if (offset == InvalidOffset)
+    {
+        return InvalidOffset;
+    }
+
+    SizeType blockSize = m_Blocks[offset].Size;
+    RemoveFreeBlock(offset);
+
+    // Return the left-over part of the block to the free lists.
+    if (blockSize > size)
+    {
+        InsertFreeBlock(offset + size, blockSize - size);
+    }
+
+    m_NumFree -= size;
+
+    return offset;
+}
+
+void DDM::TLSFBlockAllocator::Free(OffsetType offset, SizeType size)
+{
+    assert(size > 0 && offset + size <= m_NumElements);
+    assert(m_Blocks[offset].Size == 0 && "Block is already free.");
+
+    // Add the number of free elements before merging modifies the size.
+    m_NumFree += size;
+
+    // Merge with the free block that ends directly before this block.
+    //
+    // PrevBlock.Offset           Offset
+    // |                          |
+    // |<-----PrevBlock.Size----->|<------Size-------->|
+    //
+    if (offset > 0)
+    {
+        OffsetType prevOffset = m_Blocks[offset - 1].FreeBlockStart;
+        if (prevOffset != InvalidOffset)
+        {
+            size += m_Blocks[prevOffset].Size;
+            offset = prevOffset;
+            RemoveFreeBlock(prevOffset);
+        }
+    }
+
+    // Merge with the free block that starts directly after this block.
+    //
+    // Offset               NextBlock.Offset
+    // |                    |
+    // |<------Size-------->|<-----NextBlock.Size----->|
+    //
+    OffsetType nextOffset = offset + size;
+    if (nextOffset < m_NumElements && m_Blocks[nextOffset].Size > 0)
+    {
+        size += m_Blocks[nextOffset].Size;
+        RemoveFreeBlock(nextOffset);
+    }
+
+    InsertFreeBlock(offset, size);
+}
+
+bool DDM::TLSFBlockAllocator::HasSpace(SizeType size) const
+{
+    return size <= m_NumFree && FindFreeBlock(size) != InvalidOffset;
+}
+
+DDM::TLSFBlockAllocator::SizeType DDM::TLSFBlockAllocator::GetLargestFreeBlock() const
+{
+    if (m_FirstLevelBitMask == 0)
+    {
+        return 0;
+    }
+
+    // The highest non-empty list contains the largest block.
+    uint32_t firstLevel = static_cast<uint32_t>(std::bit_width(m_FirstLevelBitMask)) - 1;
+    uint32_t secondLevel = static_cast<uint32_t>(std::bit_width(m_SecondLevelBitMask[firstLevel])) - 1;
+
+    SizeType largestBlock = 0;
+    for (OffsetType offset = m_FreeLists[firstLevel][secondLevel]; offset != InvalidOffset; offset = m_Blocks[offset].NextFree)
+    {
+        largestBlock = std::max(largestBlock, m_Blocks[offset].Size);
+    }
+
+    return largestBlock;
+}
+
+void DDM::TLSFBlockAllocator::MappingInsert(SizeType size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < SecondLevelCount)
+    {
+        // Small blocks are stored in exact-size lists.
+        firstLevel = 0;
+        secondLevel = size;
+    }
+    else
+    {
+        uint32_t mostSignificantBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        firstLevel = mostSignificantBit - SecondLevelLog2 + 1;
+        secondLevel = (size >> (mostSignificantBit - SecondLevelLog2)) - SecondLevelCount;
+    }
+}
+
+bool DDM::TLSFBlockAllocator::MappingSearch(SizeType size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    uint64_t roundedSize = size;
+    if (size >= SecondLevelCount)
+    {
+        // Round up to the next list boundary so that every block in the
+        // resulting list is guaranteed to be large enough.
+        uint32_t mostSignificantBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        roundedSize += (1ull << (mostSignificantBit - SecondLevelLog2)) - 1;
+
+        if (roundedSize > UINT32_MAX)
+        {
+            return false;
+        }
+    }
+
+    MappingInsert(static_cast<SizeType>(roundedSize), firstLevel, secondLevel);
+
+    return true;
+}
+
+DDM::TLSFBlockAllocator::OffsetType DDM::TLSFBlockAllocator::FindFreeBlock(SizeType size) const
+{
+    uint32_t firstLevel, secondLevel;
+    if (MappingSearch(size, firstLevel, secondLevel))
+    {
+        // Look for a non-empty list in the same first level first.
+        uint32_t secondLevelMap = m_SecondLevelBitMask[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0)
+        {
+            // Otherwise take the smallest non-empty list of a larger first level.
+            uint32_t firstLevelMap = (firstLevel + 1 < 32) ? (m_FirstLevelBitMask & (~0u << (firstLevel + 1))) : 0;
+            if (firstLevelMap != 0)
+            {
+                firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+                secondLevelMap = m_SecondLevelBitMask[firstLevel];
+            }
+        }
+
+        if (secondLevelMap != 0)
+        {
+            secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+            return m_FreeLists[firstLevel][secondLevel];
+        }
+    }
+
+    // The rounded search can miss a block in the list the requested size maps to
+    // (a block in that list may still be large enough). This only happens when the
+    // page is nearly full, so walk that single list before giving up.
+    MappingInsert(size, firstLevel, secondLevel);
+    for (OffsetType offset = m_FreeLists[firstLevel][secondLevel]; offset != InvalidOffset; offset = m_Blocks[offset].NextFree)
+    {
+        if (m_Blocks[offset].Size >= size)
+        {
+            return offset;
+        }
+    }
+
+    return InvalidOffset;
+}
+
+void DDM::TLSFBlockAllocator::InsertFreeBlock(OffsetType offset, SizeType size)
+{
+    uint32_t firstLevel, secondLevel;
+    MappingInsert(size, firstLevel, secondLevel);
+
+    OffsetType head = m_FreeLists[firstLevel][secondLevel];
+
+    BlockInfo& block = m_Blocks[offset];
+    block.Size = size;
+    block.PrevFree = InvalidOffset;
+    block.NextFree = head;
+
+    if (head != InvalidOffset)
+    {
+        m_Blocks[head].PrevFree = offset;
+    }
+
+    m_FreeLists[firstLevel][secondLevel] = offset;
+    m_FirstLevelBitMask |= (1u << firstLevel);
+    m_SecondLevelBitMask[firstLevel] |= (1u << secondLevel);
+
+    // Boundary tag so the block that follows can find this block when it is freed.
+    m_Blocks[offset + size - 1].FreeBlockStart = offset;
+}
+
+void DDM::TLSFBlockAllocator::RemoveFreeBlock(OffsetType offset)
+{
+    BlockInfo& block = m_Blocks[offset];
+
+    uint32_t firstLevel, secondLevel;
+    MappingInsert(block.Size, firstLevel, secondLevel);
+
+    if (block.PrevFree != InvalidOffset)
+    {
+        m_Blocks[block.PrevFree].NextFree = block.NextFree;
+    }
+    else
+    {
+        m_FreeLists[firstLevel][secondLevel] = block.NextFree;
+    }
+
+    if (block.NextFree != InvalidOffset)
+    {
+        m_Blocks[block.NextFree].PrevFree = block.PrevFree;
+    }
+
+    // Clear the bits if the list has become empty.
+    if (m_FreeLists[firstLevel][secondLevel] == InvalidOffset)
+    {
+        m_SecondLevelBitMask[firstLevel] &= ~(1u << secondLevel);
+        if (m_SecondLevelBitMask[firstLevel] == 0)
+        {
+            m_FirstLevelBitMask &= ~(1u << firstLevel);
+        }
+    }
+
+    m_Blocks[offset + block.Size - 1].FreeBlockStart = InvalidOffset;
+
+    block.Size = 0;
+    block.PrevFree = InvalidOffset;
+    block.NextFree = InvalidOffset;
+}
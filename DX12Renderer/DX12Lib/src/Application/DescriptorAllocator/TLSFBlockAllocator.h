@@ -0,0 +1,134 @@
+// TLSFBlockAllocator.h
+
+/**
+ * Two-level segregated fit (TLSF) block manager for a contiguous range of
+ * elements (for example the descriptors in a descriptor heap).
+ *
+ * Free blocks are kept in segregated free lists that are indexed by a first level
+ * (power of two) and a second level (linear subdivision of that power of two).
+ * Two bit masks record which lists are non-empty so a suitable block can be found
+ * with a couple of bit scans. Boundary tags stored at the first and last element
+ * of every free block allow neighbouring blocks to be merged without searching.
+ *
+ * Allocate, Free and the coalescing of free blocks run in constant time and no
+ * memory is allocated after construction.
+ * This class only manages offsets and does not depend on a D3D12 device.
+ */
+
+#ifndef _TLSF_BLOCK_ALLOCATOR_
+#define _TLSF_BLOCK_ALLOCATOR_
+
+// Standard library includes
+#include <cstdint>
+#include <memory>
+
+namespace DDM
+{
+	class TLSFBlockAllocator final
+	{
+	public:
+		// The offset (in elements) within the managed range.
+		using OffsetType = uint32_t;
+		// A number of elements.
+		using SizeType = uint32_t;
+
+		// Returned by Allocate if the request could not be satisfied.
+		static constexpr OffsetType InvalidOffset = UINT32_MAX;
+
+		/**
+		 * @param numElements The number of elements in the managed range.
+		 * The whole range starts out as a single free block.
+		 */
+		explicit TLSFBlockAllocator(SizeType numElements);
+
+		~TLSFBlockAllocator();
+
+		TLSFBlockAllocator(TLSFBlockAllocator& other) = delete;
+		TLSFBlockAllocator(TLSFBlockAllocator&& other) = delete;
+
+		TLSFBlockAllocator& operator=(TLSFBlockAllocator& other) = delete;
+		TLSFBlockAllocator& operator=(TLSFBlockAllocator&& other) = delete;
+
+		/**
+		 * Allocate a contiguous block of elements.
+		 *
+		 * @return The offset of the first element, or InvalidOffset if there is
+		 * no free block that is large enough.
+		 */
+		OffsetType Allocate(SizeType size);
+
+		/**
+		 * Return a block that was previously returned by Allocate.
+		 * The block is merged with the free blocks directly before and after it.
+		 */
+		void Free(OffsetType offset, SizeType size);
+
+		/**
+		 * Check to see if there is a contiguous free block that can hold
+		 * the requested number of elements.
+		 */
+		bool HasSpace(SizeType size) const;
+
+		/**
+		 * Get the size of the largest contiguous free block.
+		 * Only the list with the largest blocks has to be inspected.
+		 */
+		SizeType GetLargestFreeBlock() const;
+
+		// Get the total number of free elements.
+		SizeType GetNumFree() const { return m_NumFree; }
+
+		// Get the number of elements in the managed range.
+		SizeType GetCapacity() const { return m_NumElements; }
+
+	private:
+		// The number of second level lists per first level is 2^SecondLevelLog2.
+		static constexpr uint32_t SecondLevelLog2 = 4;
+		static constexpr uint32_t SecondLevelCount = 1u << SecondLevelLog2;
+		// Sizes below SecondLevelCount are all stored in the first list (exact fit),
+		// every other first level covers one power of two.
+		static constexpr uint32_t FirstLevelCount = 32 - SecondLevelLog2 + 1;
+
+		// Per element bookkeeping.
+		// Only the first and the last element of a free block hold valid data.
+		struct BlockInfo
+		{
+			// The size of the free block that starts at this element.
+			// Zero if no free block starts here.
+			SizeType Size;
+			// Links to the neighbouring blocks in the same segregated free list.
+			OffsetType PrevFree;
+			OffsetType NextFree;
+			// The first element of the free block that ends at this element.
+			// InvalidOffset if no free block ends here.
+			OffsetType FreeBlockStart;
+		};
+
+		// Compute the list that a block of the given size is stored in.
+		static void MappingInsert(SizeType size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+		// Compute the first list whose blocks are all large enough for the given size.
+		// Returns false if no such list exists.
+		static bool MappingSearch(SizeType size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+		// Find a free block that can hold the requested size.
+		OffsetType FindFreeBlock(SizeType size) const;
+
+		// Add a block to (or remove a block from) the segregated free lists.
+		void InsertFreeBlock(OffsetType offset, SizeType size);
+		void RemoveFreeBlock(OffsetType offset);
+
+		std::unique_ptr<BlockInfo[]> m_Blocks;
+		SizeType m_NumElements;
+		SizeType m_NumFree;
+
+		// Each bit represents a first level that has at least one non-empty list.
+		uint32_t m_FirstLevelBitMask;
+		// Each bit represents a non-empty second level list.
+		uint32_t m_SecondLevelBitMask[FirstLevelCount];
+		// The first block in each segregated free list.
+		OffsetType m_FreeLists[FirstLevelCount][SecondLevelCount];
+	};
+}
+
+#endif // !_TLSF_BLOCK_ALLOCATOR_
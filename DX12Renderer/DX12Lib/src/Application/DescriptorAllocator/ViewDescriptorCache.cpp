@@ -0,0 +1,314 @@
+// ViewDescriptorCache.cpp
+
+// Header include
+#include "ViewDescriptorCache.h"
+
+// File includes
+#include "Application/Application.h"
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    // The private data GUID of the views of a resource, {3D9F2B61-7C48-4A0E-A1D3-6E5B8C2F4A97}.
+    constexpr GUID ResourceViewsGuid = { 0x3d9f2b61, 0x7c48, 0x4a0e, { 0xa1, 0xd3, 0x6e, 0x5b, 0x8c, 0x2f, 0x4a, 0x97 } };
+
+    // The size of the union member that the view dimension selects. The other bytes of the
+    // union are not read by the device, so they may hold anything.
+    size_t GetUnionSize(D3D12_SRV_DIMENSION viewDimension)
+    {
+        switch (viewDimension)
+        {
+        case D3D12_SRV_DIMENSION_BUFFER:
+            return offsetof(D3D12_BUFFER_SRV, Flags) + sizeof(D3D12_BUFFER_SRV_FLAGS);
+        case D3D12_SRV_DIMENSION_TEXTURE1D:
+            return sizeof(D3D12_TEX1D_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE1DARRAY:
+            return sizeof(D3D12_TEX1D_ARRAY_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE2D:
+            return sizeof(D3D12_TEX2D_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:
+            return sizeof(D3D12_TEX2D_ARRAY_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE2DMS:
+            return sizeof(D3D12_TEX2DMS_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE2DMSARRAY:
+            return sizeof(D3D12_TEX2DMS_ARRAY_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURE3D:
+            return sizeof(D3D12_TEX3D_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURECUBE:
+            return sizeof(D3D12_TEXCUBE_SRV);
+        case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:
+            return sizeof(D3D12_TEXCUBE_ARRAY_SRV);
+        case D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE:
+            return sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_SRV);
+        default:
+            // Compare the whole union for dimensions that are not known here.
+            return sizeof(D3D12_SHADER_RESOURCE_VIEW_DESC) - offsetof(D3D12_SHADER_RESOURCE_VIEW_DESC, Buffer);
+        }
+    }
+
+    size_t GetUnionSize(D3D12_UAV_DIMENSION viewDimension)
+    {
+        switch (viewDimension)
+        {
+        case D3D12_UAV_DIMENSION_BUFFER:
+            // Leave out the padding after the flags.
+            return offsetof(D3D12_BUFFER_UAV, Flags) + sizeof(D3D12_BUFFER_UAV_FLAGS);
+        case D3D12_UAV_DIMENSION_TEXTURE1D:
+            return sizeof(D3D12_TEX1D_UAV);
+        case D3D12_UAV_DIMENSION_TEXTURE1DARRAY:
+            return sizeof(D3D12_TEX1D_ARRAY_UAV);
+        case D3D12_UAV_DIMENSION_TEXTURE2D:
+            return sizeof(D3D12_TEX2D_UAV);
+        case D3D12_UAV_DIMENSION_TEXTURE2DARRAY:
+            return sizeof(D3D12_TEX2D_ARRAY_UAV);
+        case D3D12_UAV_DIMENSION_TEXTURE3D:
+            return sizeof(D3D12_TEX3D_UAV);
+        default:
+            // Compare the whole union for dimensions that are not known here.
+            return sizeof(D3D12_UNORDERED_ACCESS_VIEW_DESC) - offsetof(D3D12_UNORDERED_ACCESS_VIEW_DESC, Buffer);
+        }
+    }
+}
+
+// A COM object, so the resource keeps it alive through SetPrivateDataInterface
+// and frees the views when the resource is destroyed.
+class DDM::ViewDescriptorCache::ResourceViews final : public IUnknown
+{
+public:
+    explicit ResourceViews(std::shared_ptr<std::atomic<size_t>> numEntries)
+        : m_NumEntries(std::move(numEntries))
+        , m_RefCount(1)
+    {}
+
+    ResourceViews(ResourceViews& other) = delete;
+    ResourceViews(ResourceViews&& other) = delete;
+
+    ResourceViews& operator=(ResourceViews& other) = delete;
+    ResourceViews& operator=(ResourceViews&& other) = delete;
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if (ppvObject == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        if (riid == __uuidof(IUnknown))
+        {
+            AddRef();
+            *ppvObject = static_cast<IUnknown*>(this);
+            return S_OK;
+        }
+
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return m_RefCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refCount = m_RefCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (refCount == 0)
+        {
+            delete this;
+        }
+
+        return refCount;
+    }
+
+    Entry& AddEntry()
+    {
+        m_NumEntries->fetch_add(1, std::memory_order_relaxed);
+        return Entries.emplace_back();
+    }
+
+    // A resource rarely has more than a couple of views, so they are searched linearly.
+    // Only access the entries while the mutex of the cache is held.
+    std::vector<Entry> Entries;
+
+private:
+    ~ResourceViews()
+    {
+        m_NumEntries->fetch_sub(Entries.size(), std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<std::atomic<size_t>> m_NumEntries;
+    std::atomic<ULONG> m_RefCount;
+};
+
+DDM::ViewDescriptorCache::ViewDescriptorCache()
+    : m_NumEntries(std::make_shared<std::atomic<size_t>>(0))
+    , m_NumHits(0)
+    , m_NumMisses(0)
+    , m_NumInvalidations(0)
+{
+}
+
+DDM::ViewDescriptorCache::~ViewDescriptorCache()
+{
+}
+
+std::shared_ptr<const DDM::DescriptorAllocation> DDM::ViewDescriptorCache::GetShaderResourceView(ID3D12Resource* resource,
+    const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc)
+{
+    // The header ends with Shader4ComponentMapping, the union that follows is 8 byte aligned.
+    ViewKey key = MakeKey(ViewType::ShaderResource, srvDesc,
+        offsetof(D3D12_SHADER_RESOURCE_VIEW_DESC, Shader4ComponentMapping) + sizeof(UINT),
+        offsetof(D3D12_SHADER_RESOURCE_VIEW_DESC, Buffer),
+        srvDesc ? GetUnionSize(srvDesc->ViewDimension) : 0);
+
+    return GetView(resource, key, [&](D3D12_CPU_DESCRIPTOR_HANDLE descriptor)
+        {
+            Application::Get().GetDevice()->CreateShaderResourceView(resource, srvDesc, descriptor);
+        });
+}
+
+std::shared_ptr<const DDM::DescriptorAllocation> DDM::ViewDescriptorCache::GetUnorderedAccessView(ID3D12Resource* resource,
+    const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc)
+{
+    ViewKey key = MakeKey(ViewType::UnorderedAccess, uavDesc,
+        offsetof(D3D12_UNORDERED_ACCESS_VIEW_DESC, ViewDimension) + sizeof(D3D12_UAV_DIMENSION),
+        offsetof(D3D12_UNORDERED_ACCESS_VIEW_DESC, Buffer),
+        uavDesc ? GetUnionSize(uavDesc->ViewDimension) : 0);
+
+    return GetView(resource, key, [&](D3D12_CPU_DESCRIPTOR_HANDLE descriptor)
+        {
+            Application::Get().GetDevice()->CreateUnorderedAccessView(resource, nullptr, uavDesc, descriptor);
+        });
+}
+
+std::shared_ptr<const DDM::DescriptorAllocation> DDM::ViewDescriptorCache::GetConstantBufferView(ID3D12Resource* resource,
+    const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDesc)
+{
+    // The description has no union, the padding after SizeInBytes is left out.
+    constexpr size_t cbvDescSize = offsetof(D3D12_CONSTANT_BUFFER_VIEW_DESC, SizeInBytes) + sizeof(UINT);
+    ViewKey key = MakeKey(ViewType::ConstantBuffer, &cbvDesc, cbvDescSize, cbvDescSize, 0);
+
+    return GetView(resource, key, [&](D3D12_CPU_DESCRIPTOR_HANDLE descriptor)
+        {
+            Application::Get().GetDevice()->CreateConstantBufferView(&cbvDesc, descriptor);
+        });
+}
+
+void DDM::ViewDescriptorCache::Invalidate(ID3D12Resource* resource)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    IUnknown* pUnknown = nullptr;
+    UINT dataSize = sizeof(pUnknown);
+    if (SUCCEEDED(resource->GetPrivateData(ResourceViewsGuid, &dataSize, &pUnknown)) && pUnknown != nullptr)
+    {
+        pUnknown->Release();
+
+        // Releases the views, unless they are still in use.
+        ThrowIfFailed(resource->SetPrivateDataInterface(ResourceViewsGuid, nullptr));
+        ++m_NumInvalidations;
+    }
+}
+
+DDM::ViewDescriptorCache::Statistics DDM::ViewDescriptorCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Statistics statistics = {};
+    statistics.Hits = m_NumHits;
+    statistics.Misses = m_NumMisses;
+    statistics.Invalidations = m_NumInvalidations;
+    statistics.NumEntries = m_NumEntries->load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+bool DDM::ViewDescriptorCache::ViewKey::operator==(const ViewKey& other) const
+{
+    return Hash == other.Hash && Type == other.Type && Size == other.Size
+        && std::memcmp(Bytes, other.Bytes, Size) == 0;
+}
+
+DDM::ViewDescriptorCache::ViewKey DDM::ViewDescriptorCache::MakeKey(ViewType type, const void* desc,
+    size_t headerSize, size_t unionOffset, size_t unionSize)
+{
+    ViewKey key;
+    key.Type = type;
+    key.Size = 0;
+
+    if (desc)
+    {
+        // Leave out the padding between the header and the union, and the bytes of the union
+        // that are not part of the active member. They are not initialized by every caller.
+        const uint8_t* pDesc = static_cast<const uint8_t*>(desc);
+        std::memcpy(key.Bytes, pDesc, headerSize);
+        std::memcpy(key.Bytes + headerSize, pDesc + unionOffset, unionSize);
+
+        key.Size = static_cast<uint32_t>(headerSize + unionSize);
+    }
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint64_t>(type);
+    for (uint32_t i = 0; i < key.Size; ++i)
+    {
+        hash = (hash ^ key.Bytes[i]) * 1099511628211ull;
+    }
+    key.Hash = hash;
+
+    return key;
+}
+
+template<typename CreateFunction>
+std::shared_ptr<const DDM::DescriptorAllocation> DDM::ViewDescriptorCache::GetView(ID3D12Resource* resource,
+    const ViewKey& key, CreateFunction&& create)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto resourceViews = GetResourceViews(resource);
+
+    for (const Entry& entry : resourceViews->Entries)
+    {
+        if (entry.Key == key)
+        {
+            ++m_NumHits;
+            return entry.View;
+        }
+    }
+
+    ++m_NumMisses;
+
+    auto view = std::make_shared<DescriptorAllocation>(
+        Application::Get().AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+
+    create(view->GetDescriptorHandle());
+
+    Entry& entry = resourceViews->AddEntry();
+    entry.Key = key;
+    entry.View = std::move(view);
+
+    return entry.View;
+}
+
+Microsoft::WRL::ComPtr<DDM::ViewDescriptorCache::ResourceViews> DDM::ViewDescriptorCache::GetResourceViews(ID3D12Resource* resource)
+{
+    Microsoft::WRL::ComPtr<ResourceViews> resourceViews;
+
+    // GetPrivateData adds a reference to the interface, which the COM pointer takes over.
+    IUnknown* pUnknown = nullptr;
+    UINT dataSize = sizeof(pUnknown);
+    if (SUCCEEDED(resource->GetPrivateData(ResourceViewsGuid, &dataSize, &pUnknown)) && pUnknown != nullptr)
+    {
+        resourceViews.Attach(static_cast<ResourceViews*>(pUnknown));
+    }
+    else
+    {
+        resourceViews.Attach(new ResourceViews(m_NumEntries));
+        ThrowIfFailed(resource->SetPrivateDataInterface(ResourceViewsGuid, resourceViews.Get()));
+    }
+
+    return resourceViews;
+}
@@ -0,0 +1,148 @@
+// ViewDescriptorCache.h
+
+/**
+ * Cache of the SRVs, UAVs and CBVs that were created for a resource.
+ *
+ * A view is looked up by the resource and a hash of the view description, so asking
+ * for the same view of the same resource twice returns the descriptor that was created
+ * the first time instead of allocating and creating a new one.
+ * The views of a resource are attached to the resource as private data, so they are
+ * freed together with the resource and a new resource at the same address starts
+ * without views. Users that hold on to a view keep its descriptor allocated.
+ *
+ * Lookups that hit the cache do not allocate memory.
+ * View descriptions are compared bytewise, over the header and the union member that
+ * the view dimension selects. Padding and the other bytes of the union are ignored.
+ */
+
+#ifndef _VIEW_DESCRIPTOR_CACHE_
+#define _VIEW_DESCRIPTOR_CACHE_
+
+// File includes
+#include "DescriptorAllocation.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DDM
+{
+	class ViewDescriptorCache final
+	{
+	public:
+		// Cache counters, for example for a debug overlay.
+		struct Statistics
+		{
+			uint64_t Hits;
+			uint64_t Misses;
+			// The number of resources of which the views were dropped from the cache.
+			uint64_t Invalidations;
+			// The number of views in the cache, over all the resources that are alive.
+			size_t NumEntries;
+		};
+
+		ViewDescriptorCache();
+
+		~ViewDescriptorCache();
+
+		ViewDescriptorCache(ViewDescriptorCache& other) = delete;
+		ViewDescriptorCache(ViewDescriptorCache&& other) = delete;
+
+		ViewDescriptorCache& operator=(ViewDescriptorCache& other) = delete;
+		ViewDescriptorCache& operator=(ViewDescriptorCache&& other) = delete;
+
+		/**
+		 * Get a SRV of the resource. The view is created if it is not in the cache.
+		 *
+		 * @param srvDesc The description of the view, or nullptr for the default view.
+		 */
+		std::shared_ptr<const DescriptorAllocation> GetShaderResourceView(ID3D12Resource* resource,
+			const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc = nullptr);
+
+		/**
+		 * Get a UAV of the resource. The view is created if it is not in the cache.
+		 *
+		 * @param uavDesc The description of the view, or nullptr for the default view.
+		 */
+		std::shared_ptr<const DescriptorAllocation> GetUnorderedAccessView(ID3D12Resource* resource,
+			const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc = nullptr);
+
+		/**
+		 * Get a CBV. The view is created if it is not in the cache.
+		 *
+		 * @param resource The resource that the constant buffer lives in.
+		 */
+		std::shared_ptr<const DescriptorAllocation> GetConstantBufferView(ID3D12Resource* resource,
+			const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDesc);
+
+		/**
+		 * Drop the views of a resource from the cache, before the resource is destroyed.
+		 * Views that are still in use stay valid, but are no longer returned by the cache.
+		 */
+		void Invalidate(ID3D12Resource* resource);
+
+		Statistics GetStatistics() const;
+
+	private:
+		enum class ViewType : uint32_t
+		{
+			ShaderResource,
+			UnorderedAccess,
+			ConstantBuffer
+		};
+
+		static constexpr size_t MaxViewDescSize = std::max({ sizeof(D3D12_SHADER_RESOURCE_VIEW_DESC),
+			sizeof(D3D12_UNORDERED_ACCESS_VIEW_DESC), sizeof(D3D12_CONSTANT_BUFFER_VIEW_DESC) });
+
+		// The normalized bytes of a view description, without the padding of the description
+		// and the unused bytes of its union.
+		struct ViewKey
+		{
+			ViewType Type;
+			// 0 for the default view of the resource.
+			uint32_t Size;
+			uint64_t Hash;
+			alignas(8) uint8_t Bytes[MaxViewDescSize];
+
+			bool operator==(const ViewKey& other) const;
+		};
+
+		// The views of a resource, attached to the resource as private data.
+		class ResourceViews;
+
+		struct Entry
+		{
+			ViewKey Key;
+			std::shared_ptr<const DescriptorAllocation> View;
+		};
+
+		// Copy the header of the description and unionSize bytes of the active union member into the key.
+		static ViewKey MakeKey(ViewType type, const void* desc, size_t headerSize, size_t unionOffset, size_t unionSize);
+
+		// Look up the view, or create it with the create function.
+		template<typename CreateFunction>
+		std::shared_ptr<const DescriptorAllocation> GetView(ID3D12Resource* resource, const ViewKey& key, CreateFunction&& create);
+
+		// Get the views that are attached to the resource, attach them if the resource has none.
+		// The mutex must be held.
+		Microsoft::WRL::ComPtr<ResourceViews> GetResourceViews(ID3D12Resource* resource);
+
+		// The number of views over all the resources, shared with the views of the
+		// resources, which can outlive the cache.
+		std::shared_ptr<std::atomic<size_t>> m_NumEntries;
+
+		uint64_t m_NumHits;
+		uint64_t m_NumMisses;
+		uint64_t m_NumInvalidations;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_VIEW_DESCRIPTOR_CACHE_
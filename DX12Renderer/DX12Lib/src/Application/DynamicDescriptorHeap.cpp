@@ -10,33 +10,60 @@
 #include "Includes/DXRHelpersIncludes.h"
 
 // Standare library includes
+#include <algorithm>
 #include <stdexcept>
 
 using namespace DDM;
 
-DynamicDescriptorHeap::DynamicDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptorsPerHeap)
+std::atomic<uint32_t> DynamicDescriptorHeap::ms_NumCopyCallsThisFrame = 0;
+std::atomic<uint32_t> DynamicDescriptorHeap::ms_NumCopyCallsLastFrame = 0;
+
+DynamicDescriptorHeap::DynamicDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heapType,
+    std::shared_ptr<ShaderVisibleDescriptorRing> descriptorRing, uint32_t numDescriptorsPerHeap)
     : m_DescriptorHeapType(heapType)
     , m_NumDescriptorsPerHeap(numDescriptorsPerHeap)
+    , m_DescriptorRing(descriptorRing)
     , m_DescriptorTableBitMask(0)
     , m_StaleDescriptorTableBitMask(0)
+    , m_InlineCBV{}
+    , m_InlineSRV{}
+    , m_InlineUAV{}
+    , m_StaleCBVBitMask(0)
+    , m_StaleSRVBitMask(0)
+    , m_StaleUAVBitMask(0)
     , m_CurrentCPUDescriptorHandle(D3D12_DEFAULT)
     , m_CurrentGPUDescriptorHandle(D3D12_DEFAULT)
     , m_NumFreeHandles(0)
+    , m_TableCacheEnabled(false)
+    , m_NumCommittedDescriptorHandles(0)
+    , m_TableCacheGeneration(1)
 {
     m_DescriptorHandleIncrementSize = Application::Get().GetDescriptorHandleIncrementSize(heapType);
 
     // Allocate space for staging CPU visible descriptors.
     m_DescriptorHandleCache = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_NumDescriptorsPerHeap);
+    m_CopyDescriptorHandles = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_NumDescriptorsPerHeap);
+
+    bool isShaderVisibleType = heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+    if (!m_DescriptorRing && isShaderVisibleType)
+    {
+        m_DescriptorRing = std::make_shared<ShaderVisibleDescriptorRing>(heapType, nullptr);
+    }
 }
 
 DynamicDescriptorHeap::~DynamicDescriptorHeap()
-{}
+{
+    Reset();
+}
 
 void DynamicDescriptorHeap::ParseRootSignature(const RootSignature& rootSignature)
 {
     // If the root signature changes, all descriptors must be (re)bound to the
     // command list.
     m_StaleDescriptorTableBitMask = 0;
+    m_StaleCBVBitMask = 0;
+    m_StaleSRVBitMask = 0;
+    m_StaleUAVBitMask = 0;
 
     const auto& rootSignatureDesc = rootSignature.GetRootSignatureDesc();
 
@@ -94,6 +121,30 @@ void DynamicDescriptorHeap::StageDescriptors(uint32_t rootParameterIndex, uint32
     m_StaleDescriptorTableBitMask |= (1 << rootParameterIndex);
 }
 
+void DynamicDescriptorHeap::StageInlineCBV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+    assert(rootParameterIndex < MaxDescriptorTables);
+
+    m_InlineCBV[rootParameterIndex] = bufferLocation;
+    m_StaleCBVBitMask |= (1 << rootParameterIndex);
+}
+
+void DynamicDescriptorHeap::StageInlineSRV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+    assert(rootParameterIndex < MaxDescriptorTables);
+
+    m_InlineSRV[rootParameterIndex] = bufferLocation;
+    m_StaleSRVBitMask |= (1 << rootParameterIndex);
+}
+
+void DynamicDescriptorHeap::StageInlineUAV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+    assert(rootParameterIndex < MaxDescriptorTables);
+
+    m_InlineUAV[rootParameterIndex] = bufferLocation;
+    m_StaleUAVBitMask |= (1 << rootParameterIndex);
+}
+
 uint32_t DynamicDescriptorHeap::ComputeStaleDescriptorCount() const
 {
     uint32_t numStaleDescriptors = 0;
@@ -109,39 +160,161 @@ uint32_t DynamicDescriptorHeap::ComputeStaleDescriptorCount() const
     return numStaleDescriptors;
 }
 
-Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::RequestDescriptorHeap()
+void DynamicDescriptorHeap::SetTableCacheEnabled(bool enabled)
 {
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-    if (!m_AvailableDescriptorHeaps.empty())
+    if (enabled && !m_TableCache)
     {
-        descriptorHeap = m_AvailableDescriptorHeaps.front();
-        m_AvailableDescriptorHeaps.pop();
+        // Zero initialized, so every entry belongs to generation 0 and is invalid.
+        m_TableCache = std::make_unique<CommittedTable[]>(TableCacheSize);
+
+        // A segment is either the segment size of the ring, or large enough for all the staged descriptors.
+        m_NumCommittedDescriptorHandles = std::max(m_NumDescriptorsPerHeap, m_DescriptorRing ? m_DescriptorRing->GetSegmentSize() : 0);
+        m_CommittedDescriptorHandles = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_NumCommittedDescriptorHandles);
     }
-    else
+
+    // Tables that were committed while the cache was disabled were not recorded,
+    // start over with a fresh generation.
+    ++m_TableCacheGeneration;
+    m_TableCacheEnabled = enabled;
+}
+
+uint64_t DynamicDescriptorHeap::HashDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors)
+{
+    // FNV-1a over the handles instead of their bytes, the handles are pointer sized.
+    uint64_t hash = 14695981039346656037ull ^ numDescriptors;
+    for (uint32_t i = 0; i < numDescriptors; ++i)
     {
-        descriptorHeap = CreateDescriptorHeap();
-        m_DescriptorHeapPool.push(descriptorHeap);
+        hash = (hash ^ static_cast<uint64_t>(descriptors[i].ptr)) * 1099511628211ull;
     }
 
-    return descriptorHeap;
+    return hash;
 }
 
-Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::CreateDescriptorHeap()
+bool DynamicDescriptorHeap::FindCommittedTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors,
+    uint64_t hash, D3D12_GPU_DESCRIPTOR_HANDLE& gpuDescriptor) const
 {
-    auto device = Application::Get().GetDevice();
+    for (uint32_t probe = 0; probe < TableCacheProbeCount; ++probe)
+    {
+        const CommittedTable& table = m_TableCache[(hash + probe) & (TableCacheSize - 1)];
+
+        if (table.Generation != m_TableCacheGeneration || table.Hash != hash || table.NumDescriptors != numDescriptors)
+        {
+            continue;
+        }
+
+        // Compare the handles themselves, the hash alone could collide.
+        const D3D12_CPU_DESCRIPTOR_HANDLE* committedDescriptors = m_CommittedDescriptorHandles.get() + table.HeapOffset;
+        bool isEqual = true;
+        for (uint32_t i = 0; i < numDescriptors && isEqual; ++i)
+        {
+            isEqual = committedDescriptors[i].ptr == descriptors[i].ptr;
+        }
+
+        if (isEqual)
+        {
+            gpuDescriptor = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_Segments.back().GPU, table.HeapOffset, m_DescriptorHandleIncrementSize);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DynamicDescriptorHeap::AddCommittedTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors,
+    uint64_t hash, uint32_t heapOffset)
+{
+    assert(heapOffset + numDescriptors <= m_NumCommittedDescriptorHandles);
+    std::copy(descriptors, descriptors + numDescriptors, m_CommittedDescriptorHandles.get() + heapOffset);
+
+    // Take the first entry of an older generation, or evict the first entry that was probed.
+    CommittedTable* pTable = &m_TableCache[hash & (TableCacheSize - 1)];
+    for (uint32_t probe = 0; probe < TableCacheProbeCount; ++probe)
+    {
+        CommittedTable& table = m_TableCache[(hash + probe) & (TableCacheSize - 1)];
+        if (table.Generation != m_TableCacheGeneration)
+        {
+            pTable = &table;
+            break;
+        }
+    }
+
+    pTable->Hash = hash;
+    pTable->HeapOffset = heapOffset;
+    pTable->NumDescriptors = numDescriptors;
+    pTable->Generation = m_TableCacheGeneration;
+}
+
+void DynamicDescriptorHeap::BindDescriptorHeap(CommandList& commandList)
+{
+    assert(m_DescriptorRing && "Only CBV/SRV/UAV and sampler descriptors can be committed.");
+
+    ID3D12DescriptorHeap* descriptorHeap = m_DescriptorRing->GetD3D12DescriptorHeap();
+    if (commandList.GetDescriptorHeap(m_DescriptorHeapType) != descriptorHeap)
+    {
+        commandList.SetDescriptorHeap(m_DescriptorHeapType, descriptorHeap);
+
+        // When updating the descriptor heap on the command list, all descriptor
+        // tables must be (re)bound (not just the stale descriptor tables).
+        m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+    }
+}
+
+void DynamicDescriptorHeap::LeaseSegment(uint32_t numDescriptors)
+{
+    // The rest of the current segment stays leased until the command list is retired,
+    // the tables that were copied to it may still be bound.
+    m_Segments.push_back(m_DescriptorRing->Allocate(numDescriptors));
+
+    const ShaderVisibleDescriptorRing::Segment& segment = m_Segments.back();
+    m_CurrentCPUDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(segment.CPU);
+    m_CurrentGPUDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(segment.GPU);
+    m_NumFreeHandles = segment.NumDescriptors;
 
-    D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
-    descriptorHeapDesc.Type = m_DescriptorHeapType;
-    descriptorHeapDesc.NumDescriptors = m_NumDescriptorsPerHeap;
-    descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    // The tables committed to the previous segment are not tracked by the table cache.
+    ++m_TableCacheGeneration;
+}
+
+struct DynamicDescriptorHeap::GraphicsBindingPoint
+{
+    static constexpr auto SetDescriptorTable = &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable;
+    static constexpr auto SetConstantBufferView = &ID3D12GraphicsCommandList::SetGraphicsRootConstantBufferView;
+    static constexpr auto SetShaderResourceView = &ID3D12GraphicsCommandList::SetGraphicsRootShaderResourceView;
+    static constexpr auto SetUnorderedAccessView = &ID3D12GraphicsCommandList::SetGraphicsRootUnorderedAccessView;
+};
 
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-    ThrowIfFailed(device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&descriptorHeap)));
+struct DynamicDescriptorHeap::ComputeBindingPoint
+{
+    static constexpr auto SetDescriptorTable = &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable;
+    static constexpr auto SetConstantBufferView = &ID3D12GraphicsCommandList::SetComputeRootConstantBufferView;
+    static constexpr auto SetShaderResourceView = &ID3D12GraphicsCommandList::SetComputeRootShaderResourceView;
+    static constexpr auto SetUnorderedAccessView = &ID3D12GraphicsCommandList::SetComputeRootUnorderedAccessView;
+};
+
+template<typename BindingPoint>
+void DynamicDescriptorHeap::CommitStagedDescriptors(CommandList& commandList)
+{
+    // Binding the heap of the ring, if another heap was bound, makes all the tables stale.
+    if (m_DescriptorTableBitMask != 0)
+    {
+        BindDescriptorHeap(commandList);
+    }
 
-    return descriptorHeap;
+    if ((m_StaleDescriptorTableBitMask | m_StaleCBVBitMask | m_StaleSRVBitMask | m_StaleUAVBitMask) == 0)
+    {
+        return;
+    }
+
+    auto d3d12GraphicsCommandList = commandList.GetGraphicsCommandList().Get();
+    assert(d3d12GraphicsCommandList != nullptr);
+
+    CommitDescriptorTables<BindingPoint::SetDescriptorTable>(d3d12GraphicsCommandList);
+    CommitInlineDescriptors<BindingPoint::SetConstantBufferView>(d3d12GraphicsCommandList, m_InlineCBV, m_StaleCBVBitMask);
+    CommitInlineDescriptors<BindingPoint::SetShaderResourceView>(d3d12GraphicsCommandList, m_InlineSRV, m_StaleSRVBitMask);
+    CommitInlineDescriptors<BindingPoint::SetUnorderedAccessView>(d3d12GraphicsCommandList, m_InlineUAV, m_StaleUAVBitMask);
 }
 
-void DynamicDescriptorHeap::CommitStagedDescriptors(CommandList& commandList, std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc)
+template<void (ID3D12GraphicsCommandList::*SetDescriptorTable)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE)>
+void DynamicDescriptorHeap::CommitDescriptorTables(ID3D12GraphicsCommandList* d3d12GraphicsCommandList)
 {
     // Compute the number of descriptors that need to be copied 
     uint32_t numDescriptorsToCommit = ComputeStaleDescriptorCount();
@@ -149,24 +322,20 @@ void DynamicDescriptorHeap::CommitStagedDescriptors(CommandList& commandList, st
     if (numDescriptorsToCommit > 0)
     {
         auto device = Application::Get().GetDevice();
-        auto d3d12GraphicsCommandList = commandList.GetGraphicsCommandList().Get();
-        assert(d3d12GraphicsCommandList != nullptr);
 
-        if (!m_CurrentDescriptorHeap || m_NumFreeHandles < numDescriptorsToCommit)
+        // The current handles are NULL (D3D12_DEFAULT) until the first segment is leased.
+        // A new segment is in the same heap, so the tables that are still bound stay valid.
+        if (m_CurrentCPUDescriptorHandle.ptr == 0 || m_NumFreeHandles < numDescriptorsToCommit)
         {
-            m_CurrentDescriptorHeap = RequestDescriptorHeap();
-            m_CurrentCPUDescriptorHandle = m_CurrentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-            m_CurrentGPUDescriptorHandle = m_CurrentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-            m_NumFreeHandles = m_NumDescriptorsPerHeap;
-
-            commandList.SetDescriptorHeap(m_DescriptorHeapType, m_CurrentDescriptorHeap.Get());
-
-            // When updating the descriptor heap on the command list, all descriptor
-            // tables must be (re)recopied to the new descriptor heap (not just
-            // the stale descriptor tables).
-            m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+            LeaseSegment(numDescriptorsToCommit);
         }
 
+        // Gather the handles of all the stale tables, so they are copied to one
+        // contiguous range of the GPU visible heap with a single call.
+        D3D12_GPU_DESCRIPTOR_HANDLE tableDescriptors[MaxDescriptorTables];
+        uint32_t copiedTableBitMask = 0;
+        UINT numDescriptorsToCopy = 0;
+
         DWORD rootIndex;
         // Scan from LSB to MSB for a bit set in staleDescriptorsBitMask
         while (_BitScanForward(&rootIndex, m_StaleDescriptorTableBitMask))
@@ -174,64 +343,94 @@ void DynamicDescriptorHeap::CommitStagedDescriptors(CommandList& commandList, st
             UINT numSrcDescriptors = m_DescriptorTableCache[rootIndex].NumDescriptors;
             D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorHandles = m_DescriptorTableCache[rootIndex].BaseDescriptor;
 
-            D3D12_CPU_DESCRIPTOR_HANDLE pDestDescriptorRangeStarts[] =
-            {
-                m_CurrentCPUDescriptorHandle
-            };
-            UINT pDestDescriptorRangeSizes[] =
+            // Flip the stale bit so the descriptor table is not recopied again unless it is updated with a new descriptor.
+            m_StaleDescriptorTableBitMask ^= (1 << rootIndex);
+
+            // Bind the earlier copy of the table if the same descriptors were already committed to this heap.
+            if (m_TableCacheEnabled)
             {
-                numSrcDescriptors
-            };
+                uint64_t tableHash = HashDescriptorTable(pSrcDescriptorHandles, numSrcDescriptors);
+
+                if (FindCommittedTable(pSrcDescriptorHandles, numSrcDescriptors, tableHash, tableDescriptors[rootIndex]))
+                {
+                    (d3d12GraphicsCommandList->*SetDescriptorTable)(rootIndex, tableDescriptors[rootIndex]);
+                    continue;
+                }
+
+                AddCommittedTable(pSrcDescriptorHandles, numSrcDescriptors, tableHash,
+                    m_Segments.back().NumDescriptors - m_NumFreeHandles + numDescriptorsToCopy);
+            }
+
+            std::copy(pSrcDescriptorHandles, pSrcDescriptorHandles + numSrcDescriptors, m_CopyDescriptorHandles.get() + numDescriptorsToCopy);
+
+            tableDescriptors[rootIndex] = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_CurrentGPUDescriptorHandle, numDescriptorsToCopy, m_DescriptorHandleIncrementSize);
+            copiedTableBitMask |= (1 << rootIndex);
+
+            numDescriptorsToCopy += numSrcDescriptors;
+        }
+
+        if (numDescriptorsToCopy > 0)
+        {
+            assert(m_CurrentCPUDescriptorHandle.ptr != 0 && numDescriptorsToCopy <= m_NumFreeHandles);
 
             // Copy the staged CPU visible descriptors to the GPU visible descriptor heap.
-            device->CopyDescriptors(1, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
-                numSrcDescriptors, pSrcDescriptorHandles, nullptr, m_DescriptorHeapType);
+            device->CopyDescriptors(1, &m_CurrentCPUDescriptorHandle, &numDescriptorsToCopy,
+                numDescriptorsToCopy, m_CopyDescriptorHandles.get(), nullptr, m_DescriptorHeapType);
+            ++ms_NumCopyCallsThisFrame;
 
             // Set the descriptors on the command list using the passed-in setter function.
-            setFunc(d3d12GraphicsCommandList, rootIndex, m_CurrentGPUDescriptorHandle);
+            while (_BitScanForward(&rootIndex, copiedTableBitMask))
+            {
+                (d3d12GraphicsCommandList->*SetDescriptorTable)(rootIndex, tableDescriptors[rootIndex]);
+                copiedTableBitMask ^= (1 << rootIndex);
+            }
 
             // Offset current CPU and GPU descriptor handles.
-            m_CurrentCPUDescriptorHandle.Offset(numSrcDescriptors, m_DescriptorHandleIncrementSize);
-            m_CurrentGPUDescriptorHandle.Offset(numSrcDescriptors, m_DescriptorHandleIncrementSize);
-            m_NumFreeHandles -= numSrcDescriptors;
-
-            // Flip the stale bit so the descriptor table is not recopied again unless it is updated with a new descriptor.
-            m_StaleDescriptorTableBitMask ^= (1 << rootIndex);
+            m_CurrentCPUDescriptorHandle.Offset(numDescriptorsToCopy, m_DescriptorHandleIncrementSize);
+            m_CurrentGPUDescriptorHandle.Offset(numDescriptorsToCopy, m_DescriptorHandleIncrementSize);
+            m_NumFreeHandles -= numDescriptorsToCopy;
         }
     }
 }
 
+template<void (ID3D12GraphicsCommandList::*SetRootDescriptor)(UINT, D3D12_GPU_VIRTUAL_ADDRESS)>
+void DynamicDescriptorHeap::CommitInlineDescriptors(ID3D12GraphicsCommandList* d3d12GraphicsCommandList,
+    const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, uint32_t& staleBitMask)
+{
+    DWORD rootIndex;
+    while (_BitScanForward(&rootIndex, staleBitMask))
+    {
+        (d3d12GraphicsCommandList->*SetRootDescriptor)(rootIndex, bufferLocations[rootIndex]);
+
+        // Flip the stale bit so the inline descriptor is not set again unless it is staged again.
+        staleBitMask ^= (1 << rootIndex);
+    }
+}
+
 void DynamicDescriptorHeap::CommitStagedDescriptorsForDraw(CommandList& commandList)
 {
-    CommitStagedDescriptors(commandList, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable);
+    CommitStagedDescriptors<GraphicsBindingPoint>(commandList);
 }
 
 void DynamicDescriptorHeap::CommitStagedDescriptorsForDispatch(CommandList& commandList)
 {
-    CommitStagedDescriptors(commandList, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable);
+    CommitStagedDescriptors<ComputeBindingPoint>(commandList);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::CopyDescriptor(CommandList& comandList, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptor)
 {
-    if (!m_CurrentDescriptorHeap || m_NumFreeHandles < 1)
-    {
-        m_CurrentDescriptorHeap = RequestDescriptorHeap();
-        m_CurrentCPUDescriptorHandle = m_CurrentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-        m_CurrentGPUDescriptorHandle = m_CurrentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-        m_NumFreeHandles = m_NumDescriptorsPerHeap;
+    BindDescriptorHeap(comandList);
 
-        comandList.SetDescriptorHeap(m_DescriptorHeapType, m_CurrentDescriptorHeap.Get());
-
-        // When updating the descriptor heap on the command list, all descriptor
-        // tables must be (re)recopied to the new descriptor heap (not just
-        // the stale descriptor tables).
-        m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+    if (m_CurrentCPUDescriptorHandle.ptr == 0 || m_NumFreeHandles < 1)
+    {
+        LeaseSegment(1);
     }
 
     auto device = Application::Get().GetDevice();
 
     D3D12_GPU_DESCRIPTOR_HANDLE hGPU = m_CurrentGPUDescriptorHandle;
     device->CopyDescriptorsSimple(1, m_CurrentCPUDescriptorHandle, cpuDescriptor, m_DescriptorHeapType);
+    ++ms_NumCopyCallsThisFrame;
 
     m_CurrentCPUDescriptorHandle.Offset(1, m_DescriptorHandleIncrementSize);
     m_CurrentGPUDescriptorHandle.Offset(1, m_DescriptorHandleIncrementSize);
@@ -240,15 +439,33 @@ D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::CopyDescriptor(CommandList& c
     return hGPU;
 }
 
-void DynamicDescriptorHeap::Reset()
+void DynamicDescriptorHeap::Retire(uint64_t fenceValue)
 {
-    m_AvailableDescriptorHeaps = m_DescriptorHeapPool;
-    m_CurrentDescriptorHeap.Reset();
+    for (const auto& segment : m_Segments)
+    {
+        m_DescriptorRing->Retire(segment, fenceValue);
+    }
+
+    m_Segments.clear();
+
     m_CurrentCPUDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
     m_CurrentGPUDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
     m_NumFreeHandles = 0;
+
+    // The segments are reused, forget the tables that were committed to them.
+    ++m_TableCacheGeneration;
+}
+
+void DynamicDescriptorHeap::Reset()
+{
+    // Fence value 0 has always completed, the segments can be reused straight away.
+    Retire(0);
+
     m_DescriptorTableBitMask = 0;
     m_StaleDescriptorTableBitMask = 0;
+    m_StaleCBVBitMask = 0;
+    m_StaleSRVBitMask = 0;
+    m_StaleUAVBitMask = 0;
 
     // Reset the table cache
     for (int i = 0; i < MaxDescriptorTables; ++i)
@@ -256,3 +473,13 @@ void DynamicDescriptorHeap::Reset()
         m_DescriptorTableCache[i].Reset();
     }
 }
+
+uint32_t DynamicDescriptorHeap::GetNumCopyCallsLastFrame()
+{
+    return ms_NumCopyCallsLastFrame;
+}
+
+void DynamicDescriptorHeap::EndFrame()
+{
+    ms_NumCopyCallsLastFrame = ms_NumCopyCallsThisFrame.exchange(0);
+}
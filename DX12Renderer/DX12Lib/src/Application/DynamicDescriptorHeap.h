@@ -32,31 +32,42 @@
   *  @brief The DynamicDescriptorHeap is a GPU visible descriptor heap that allows for
   *  staging of CPU visible descriptors that need to be uploaded before a Draw
   *  or Dispatch command is executed.
+  *  The GPU visible descriptors are leased in segments from a ShaderVisibleDescriptorRing
+  *  that is shared by all the command lists of a command queue.
   *  The DynamicDescriptorHeap class is based on the one provided by the MiniEngine:
   *  https://github.com/Microsoft/DirectX-Graphics-Samples
   */
 
   // File includes
+#include "DescriptorAllocator/ShaderVisibleDescriptorRing.h"
 #include "Includes/DirectXIncludes.h"
 
 // Standard libary includes
 #include <wrl.h>
+#include <atomic>
 #include <cstdint>
 #include <memory>
-#include <queue>
-#include <functional>
+#include <vector>
 
 namespace DDM
 {
     // Class forward declarations
     class CommandList;
     class RootSignature;
+    class ShaderVisibleDescriptorRing;
 
     class DynamicDescriptorHeap
     {
     public:
+        /**
+         * @param descriptorRing The shader visible heap that is shared by the command lists
+         * of the command queue. If nullptr, a ring of its own is created for the shader
+         * visible heap types. Its segments are only reused after Reset.
+         * @param numDescriptorsPerHeap The maximum number of descriptors that can be staged.
+         */
         DynamicDescriptorHeap(
             D3D12_DESCRIPTOR_HEAP_TYPE heapType,
+            std::shared_ptr<ShaderVisibleDescriptorRing> descriptorRing = nullptr,
             uint32_t numDescriptorsPerHeap = 1024);
 
         virtual ~DynamicDescriptorHeap();
@@ -64,22 +75,27 @@ namespace DDM
         /**
          * Stages a contiguous range of CPU visible descriptors.
          * Descriptors are not copied to the GPU visible descriptor heap until
-         * the CommitStagedDescriptors function is called.
+         * the staged descriptors are committed.
          */
         void StageDescriptors(uint32_t rootParameterIndex, uint32_t offset, uint32_t numDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptors);
 
+        /**
+         * Stage an inline CBV, SRV or UAV at a root parameter index that is a root descriptor.
+         * Inline descriptors are set on the command list when the staged descriptors are
+         * committed, without copying any descriptors to the GPU visible descriptor heap.
+         * Only the CBV/SRV/UAV dynamic descriptor heap is used for inline descriptors.
+         */
+        void StageInlineCBV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+        void StageInlineSRV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+        void StageInlineUAV(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+
         /**
          * Copy all of the staged descriptors to the GPU visible descriptor heap and
-         * bind the descriptor heap and the descriptor tables to the command list.
-         * The passed-in function object is used to set the GPU visible descriptors
-         * on the command list. Two possible functions are:
-         *   * Before a draw    : ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable
-         *   * Before a dispatch: ID3D12GraphicsCommandList::SetComputeRootDescriptorTable
-         *
-         * Since the DynamicDescriptorHeap can't know which function will be used, it must
-         * be passed as an argument to the function.
+         * bind the descriptor heap, the descriptor tables and the inline descriptors
+         * to the command list.
+         *   * Before a draw    : CommitStagedDescriptorsForDraw sets the graphics root arguments
+         *   * Before a dispatch: CommitStagedDescriptorsForDispatch sets the compute root arguments
          */
-        void CommitStagedDescriptors(CommandList& commandList, std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc);
         void CommitStagedDescriptorsForDraw(CommandList& commandList);
         void CommitStagedDescriptorsForDispatch(CommandList& commandList);
 
@@ -107,6 +123,22 @@ namespace DDM
          */
         void ParseRootSignature(const RootSignature& rootSignature);
 
+        /**
+         * Enable or disable the reuse of committed descriptor tables.
+         * When enabled, a stale descriptor table of which the staged CPU handles are
+         * identical to a table that was already committed to the current segment
+         * is bound from that earlier copy instead of being copied again.
+         * This assumes that the CPU descriptors are not rewritten while the command
+         * list is being recorded, which is why it is disabled by default.
+         */
+        void SetTableCacheEnabled(bool enabled);
+
+        /**
+         * Return the segments that were leased by the command list to the descriptor ring.
+         * They are reused once the command queue fence reaches the fence value.
+         */
+        void Retire(uint64_t fenceValue);
+
         /**
          * Reset used descriptors. This should only be done if any descriptors
          * that are being referenced by a command list has finished executing on the
@@ -114,18 +146,64 @@ namespace DDM
          */
         void Reset();
 
+        /**
+         * Get the number of ID3D12Device::CopyDescriptors(Simple) calls that were made
+         * by all the dynamic descriptor heaps during the last frame.
+         */
+        static uint32_t GetNumCopyCallsLastFrame();
+
+        // Called once per frame by the application to update the copy call counter.
+        static void EndFrame();
+
     protected:
 
     private:
-        // Request a descriptor heap if one is available.
-        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> RequestDescriptorHeap();
-        // Create a new descriptor heap of no descriptor heap is available.
-        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap();
+        /**
+         * Bind the heap of the descriptor ring to the command list if another heap is bound.
+         * All the descriptor tables are marked stale in that case, since the tables that
+         * were bound before do not point into the heap of the ring.
+         */
+        void BindDescriptorHeap(CommandList& commandList);
+
+        // Lease a segment that has room for at least the number of descriptors.
+        void LeaseSegment(uint32_t numDescriptors);
+
+        // The root argument setters of the graphics and compute binding points.
+        struct GraphicsBindingPoint;
+        struct ComputeBindingPoint;
+
+        /**
+         * Commit the staged descriptors to one of the binding points. The setters are
+         * resolved at compile time, so the draw and dispatch paths do not go through
+         * a type-erased function object.
+         */
+        template<typename BindingPoint>
+        void CommitStagedDescriptors(CommandList& commandList);
+
+        // Copy the stale descriptor tables to the GPU visible heap and set them on the command list.
+        template<void (ID3D12GraphicsCommandList::*SetDescriptorTable)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE)>
+        void CommitDescriptorTables(ID3D12GraphicsCommandList* d3d12GraphicsCommandList);
+
+        // Set the stale inline descriptors of one kind on the command list.
+        template<void (ID3D12GraphicsCommandList::*SetRootDescriptor)(UINT, D3D12_GPU_VIRTUAL_ADDRESS)>
+        static void CommitInlineDescriptors(ID3D12GraphicsCommandList* d3d12GraphicsCommandList,
+            const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, uint32_t& staleBitMask);
 
         // Compute the number of stale descriptors that need to be copied
         // to GPU visible descriptor heap.
         uint32_t ComputeStaleDescriptorCount() const;
 
+        // Hash the CPU handles of a descriptor table.
+        static uint64_t HashDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors);
+
+        // Look for a committed copy of the descriptor table in the current segment.
+        bool FindCommittedTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors,
+            uint64_t hash, D3D12_GPU_DESCRIPTOR_HANDLE& gpuDescriptor) const;
+
+        // Remember the descriptor table that was copied to the offset in the current segment.
+        void AddCommittedTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors,
+            uint64_t hash, uint32_t heapOffset);
+
         /**
          * The maximum number of descriptor tables per root signature.
          * A 32-bit mask is used to keep track of the root parameter indices that
@@ -162,10 +240,11 @@ namespace DDM
         //   * D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
         //   * D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER
         // This parameter also determines the type of GPU visible descriptor heap to 
-        // create.
+        // lease from.
         D3D12_DESCRIPTOR_HEAP_TYPE m_DescriptorHeapType;
 
-        // The number of descriptors to allocate in new GPU visible descriptor heaps.
+        // The maximum number of descriptors that can be staged.
+        // A commit never needs a segment that is larger than this.
         uint32_t m_NumDescriptorsPerHeap;
 
         // The increment size of a descriptor.
@@ -185,17 +264,63 @@ namespace DDM
         // descriptors were copied.
         uint32_t m_StaleDescriptorTableBitMask;
 
-        using DescriptorHeapPool = std::queue< Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> >;
+        // The buffer locations of the inline descriptors, per root parameter index.
+        D3D12_GPU_VIRTUAL_ADDRESS m_InlineCBV[MaxDescriptorTables];
+        D3D12_GPU_VIRTUAL_ADDRESS m_InlineSRV[MaxDescriptorTables];
+        D3D12_GPU_VIRTUAL_ADDRESS m_InlineUAV[MaxDescriptorTables];
 
-        DescriptorHeapPool m_DescriptorHeapPool;
-        DescriptorHeapPool m_AvailableDescriptorHeaps;
+        // Each bit set in the bit masks represents an inline descriptor
+        // that has been staged since the last commit.
+        uint32_t m_StaleCBVBitMask;
+        uint32_t m_StaleSRVBitMask;
+        uint32_t m_StaleUAVBitMask;
+
+        // The shader visible heap that the segments are leased from.
+        std::shared_ptr<ShaderVisibleDescriptorRing> m_DescriptorRing;
+
+        // The segments that are in use by the command list. The last one is the current segment.
+        std::vector<ShaderVisibleDescriptorRing::Segment> m_Segments;
 
-        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_CurrentDescriptorHeap;
         CD3DX12_GPU_DESCRIPTOR_HANDLE m_CurrentGPUDescriptorHandle;
         CD3DX12_CPU_DESCRIPTOR_HANDLE m_CurrentCPUDescriptorHandle;
 
+        // The number of free descriptors in the current segment.
         uint32_t m_NumFreeHandles;
 
+        /**
+         * The number of entries in the committed table cache, must be a power of two.
+         * A table is looked up in at most TableCacheProbeCount consecutive entries.
+         */
+        static const uint32_t TableCacheSize = 256;
+        static const uint32_t TableCacheProbeCount = 4;
+
+        // A descriptor table that was committed to the current segment.
+        struct CommittedTable
+        {
+            uint64_t Hash;
+            // The offset of the table in the segment.
+            uint32_t HeapOffset;
+            uint32_t NumDescriptors;
+            // Entries of an older generation belong to a previous segment.
+            uint32_t Generation;
+        };
+
+        bool m_TableCacheEnabled;
+        std::unique_ptr<CommittedTable[]> m_TableCache;
+        // The CPU handle that was copied to each descriptor of the current segment.
+        // Used to verify a cache hit.
+        std::unique_ptr<D3D12_CPU_DESCRIPTOR_HANDLE[]> m_CommittedDescriptorHandles;
+        uint32_t m_NumCommittedDescriptorHandles;
+        // Incremented whenever a new segment is leased or the segments are retired,
+        // which invalidates all the cached tables at once.
+        uint32_t m_TableCacheGeneration;
+
+        // The staged CPU handles of all the tables that are copied by a commit, gathered
+        // so they can be copied to the GPU visible heap with a single call.
+        std::unique_ptr<D3D12_CPU_DESCRIPTOR_HANDLE[]> m_CopyDescriptorHandles;
+
+        static std::atomic<uint32_t> ms_NumCopyCallsThisFrame;
+        static std::atomic<uint32_t> ms_NumCopyCallsLastFrame;
     };
 }
 
@@ -0,0 +1,95 @@
+// FenceRingAllocator.cpp
+
+// Header include
+#include "FenceRingAllocator.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::FenceRingAllocator::FenceRingAllocator(uint64_t capacity)
+    : m_Capacity(capacity)
+    , m_Head(0)
+    , m_UsedSize(0)
+{
+}
+
+DDM::FenceRingAllocator::~FenceRingAllocator()
+{
+}
+
+uint64_t DDM::FenceRingAllocator::Allocate(uint64_t size)
+{
+    assert(size > 0);
+
+    if (size > m_Capacity)
+    {
+        return InvalidOffset;
+    }
+
+    // Start at the beginning again when the ring is empty,
+    // this avoids skipping space at the end for no reason.
+    if (m_Blocks.empty())
+    {
+        m_Head = 0;
+    }
+
+    uint64_t offset = m_Head;
+    uint64_t blockSize = size;
+
+    // The block does not fit before the end of the ring,
+    // skip the remaining space and start at the beginning.
+    if (offset + size > m_Capacity)
+    {
+        blockSize += m_Capacity - offset;
+        offset = 0;
+    }
+
+    if (m_UsedSize + blockSize > m_Capacity)
+    {
+        return InvalidOffset;
+    }
+
+    m_Blocks.push_back({ offset, blockSize, PendingFenceValue });
+
+    m_Head = (offset + size) % m_Capacity;
+    m_UsedSize += blockSize;
+
+    return offset;
+}
+
+void DDM::FenceRingAllocator::Retire(uint64_t offset, uint64_t fenceValue)
+{
+    // Blocks are usually retired shortly after they were allocated,
+    // so search from the head of the ring.
+    for (auto iter = m_Blocks.rbegin(); iter != m_Blocks.rend(); ++iter)
+    {
+        if (iter->Offset == offset && iter->FenceValue == PendingFenceValue)
+        {
+            iter->FenceValue = fenceValue;
+            return;
+        }
+    }
+
+    assert(false && "Block was not allocated from this ring.");
+}
+
+void DDM::FenceRingAllocator::ReleaseCompletedBlocks(uint64_t completedFenceValue)
+{
+    while (!m_Blocks.empty())
+    {
+        const BlockInfo& block = m_Blocks.front();
+
+        if (block.FenceValue == PendingFenceValue || block.FenceValue > completedFenceValue)
+        {
+            break;
+        }
+
+        m_UsedSize -= block.Size;
+        m_Blocks.pop_front();
+    }
+}
+
+uint64_t DDM::FenceRingAllocator::GetTailFenceValue() const
+{
+    return m_Blocks.empty() ? 0 : m_Blocks.front().FenceValue;
+}
@@ -0,0 +1,106 @@
+// FenceRingAllocator.h
+
+/**
+ * Ring allocator of which the blocks are reclaimed when a fence value completes.
+ *
+ * Blocks are handed out in order from the head of the ring. Once the GPU work that
+ * uses a block has been submitted, the block is retired with the fence value of
+ * that submission. Blocks are reclaimed from the tail of the ring as soon as the
+ * completed fence value reaches the value they were retired with, so a block that
+ * has not been retired yet keeps the blocks after it alive.
+ *
+ * This class only manages offsets and does not depend on a D3D12 device, the
+ * completed fence value is passed in by the caller.
+ */
+
+#ifndef _FENCE_RING_ALLOCATOR_
+#define _FENCE_RING_ALLOCATOR_
+
+// Standard library includes
+#include <cstdint>
+#include <deque>
+
+namespace DDM
+{
+	class FenceRingAllocator final
+	{
+	public:
+		// Returned by Allocate if the request could not be satisfied.
+		static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+		/**
+		 * @param capacity The size of the ring.
+		 */
+		explicit FenceRingAllocator(uint64_t capacity);
+
+		~FenceRingAllocator();
+
+		FenceRingAllocator(FenceRingAllocator& other) = delete;
+		FenceRingAllocator(FenceRingAllocator&& other) = delete;
+
+		FenceRingAllocator& operator=(FenceRingAllocator& other) = delete;
+		FenceRingAllocator& operator=(FenceRingAllocator&& other) = delete;
+
+		/**
+		 * Allocate a contiguous block from the head of the ring.
+		 * A block never wraps around the end of the ring, the space at the end
+		 * is skipped instead.
+		 *
+		 * @return The offset of the block, or InvalidOffset if the ring is full.
+		 */
+		uint64_t Allocate(uint64_t size);
+
+		/**
+		 * Mark a block as used by the submission that signals the fence value.
+		 * The block is reclaimed once that fence value has completed.
+		 * Retire with a fence value of 0 to reclaim the block without waiting.
+		 */
+		void Retire(uint64_t offset, uint64_t fenceValue);
+
+		/**
+		 * Reclaim the retired blocks at the tail of the ring of which the fence value
+		 * is less than or equal to the completed fence value.
+		 */
+		void ReleaseCompletedBlocks(uint64_t completedFenceValue);
+
+		// Get the size of the ring.
+		uint64_t GetCapacity() const { return m_Capacity; }
+
+		// Get the number of bytes that are in use, including skipped space.
+		uint64_t GetUsedSize() const { return m_UsedSize; }
+
+		// Check to see if no blocks are in use.
+		bool IsEmpty() const { return m_Blocks.empty(); }
+
+		/**
+		 * Get the fence value that has to complete before the oldest block is reclaimed.
+		 * Returns 0 if the ring is empty, and PendingFenceValue if the oldest block
+		 * has not been retired yet.
+		 */
+		uint64_t GetTailFenceValue() const;
+
+		// The fence value of a block that has not been retired yet.
+		static constexpr uint64_t PendingFenceValue = UINT64_MAX;
+
+	private:
+		struct BlockInfo
+		{
+			// The offset that was returned by Allocate.
+			uint64_t Offset;
+			// The size of the block, including the space that was skipped
+			// at the end of the ring to allocate it.
+			uint64_t Size;
+			// The fence value that has to complete before the block can be reused.
+			uint64_t FenceValue;
+		};
+
+		// Blocks in allocation order. The front is the tail of the ring.
+		std::deque<BlockInfo> m_Blocks;
+
+		uint64_t m_Capacity;
+		uint64_t m_Head;
+		uint64_t m_UsedSize;
+	};
+}
+
+#endif // !_FENCE_RING_ALLOCATOR_
@@ -0,0 +1,113 @@
+// FenceTimeline.cpp
+
+// Header include
+#include "FenceTimeline.h"
+
+// Standard library includes
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+DDM::FenceTimeline::FenceTimeline(std::shared_ptr<Fence> fence)
+    : m_pFence(fence)
+    , m_CompletedValue(0)
+{
+    assert(m_pFence && "A fence timeline needs a fence.");
+
+    m_CompletedValue = m_pFence->GetCompletedValue();
+}
+
+DDM::FenceTimeline::~FenceTimeline()
+{
+}
+
+bool DDM::FenceTimeline::IsComplete(uint64_t value)
+{
+    if (m_CompletedValue >= value)
+    {
+        return true;
+    }
+
+    return GetCompletedValue() >= value;
+}
+
+uint64_t DDM::FenceTimeline::GetCompletedValue()
+{
+    uint64_t completedValue = m_pFence->GetCompletedValue();
+
+    // Another thread may have seen a later value already.
+    uint64_t cachedValue = m_CompletedValue.load();
+    while (cachedValue < completedValue && !m_CompletedValue.compare_exchange_weak(cachedValue, completedValue))
+    {
+    }
+
+    return std::max(cachedValue, completedValue);
+}
+
+uint64_t DDM::FenceTimeline::Poll()
+{
+    uint64_t completedValue = GetCompletedValue();
+
+    RunCompletedCallbacks(completedValue);
+
+    return completedValue;
+}
+
+void DDM::FenceTimeline::WaitForValue(uint64_t value)
+{
+    if (IsComplete(value))
+    {
+        return;
+    }
+
+    m_pFence->WaitForValue(value);
+
+    GetCompletedValue();
+}
+
+void DDM::FenceTimeline::AddCompletionCallback(uint64_t value, CompletionCallback callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // Poll raises the cached value in GetCompletedValue before RunCompletedCallbacks takes the lock.
+        // A poll that takes the lock after this one finds the callback. A poll that took it before
+        // has raised the cached value before this check, so the callback is run right away below.
+        if (m_CompletedValue < value)
+        {
+            m_Callbacks.emplace(value, std::move(callback));
+            return;
+        }
+    }
+
+    callback();
+}
+
+size_t DDM::FenceTimeline::GetNumPendingCallbacks() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    return m_Callbacks.size();
+}
+
+void DDM::FenceTimeline::RunCompletedCallbacks(uint64_t completedValue)
+{
+    std::vector<CompletionCallback> callbacks;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto end = m_Callbacks.upper_bound(completedValue);
+        for (auto iter = m_Callbacks.begin(); iter != end; ++iter)
+        {
+            callbacks.push_back(std::move(iter->second));
+        }
+        m_Callbacks.erase(m_Callbacks.begin(), end);
+    }
+
+    // The callbacks are run without holding the lock, so they can add callbacks of their own.
+    for (auto& callback : callbacks)
+    {
+        callback();
+    }
+}
@@ -0,0 +1,118 @@
+// FenceTimeline.h
+
+/**
+ * Timeline of the values a fence is signaled with.
+ *
+ * Waits for a specific fence value instead of the last one that was signaled, so work
+ * from older submissions can be waited on while newer submissions keep the GPU busy.
+ * Callbacks can be registered to run once the fence passes a value, which is used to
+ * free or recycle objects that the GPU is still using. Only Poll runs the callbacks,
+ * so the owner decides which thread does that work.
+ *
+ * The completed value is cached. Checking a value that the cache has already passed
+ * does not query the fence, the cache is only refreshed when it is behind.
+ *
+ * The timeline only depends on the Fence interface, so it can be driven by a fence
+ * that is signaled on the CPU.
+ */
+
+#ifndef _FENCE_TIMELINE_
+#define _FENCE_TIMELINE_
+
+// Standard library includes
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DDM
+{
+	// The fence a timeline queries and waits on.
+	class Fence
+	{
+	public:
+		Fence() = default;
+
+		virtual ~Fence() = default;
+
+		Fence(Fence& other) = delete;
+		Fence(Fence&& other) = delete;
+
+		Fence& operator=(Fence& other) = delete;
+		Fence& operator=(Fence&& other) = delete;
+
+		// Get the last value the fence reached.
+		virtual uint64_t GetCompletedValue() = 0;
+
+		// Block the calling thread until the fence reaches the value.
+		virtual void WaitForValue(uint64_t value) = 0;
+	};
+
+	class FenceTimeline final
+	{
+	public:
+		using CompletionCallback = std::function<void()>;
+
+		explicit FenceTimeline(std::shared_ptr<Fence> fence);
+
+		~FenceTimeline();
+
+		FenceTimeline(FenceTimeline& other) = delete;
+		FenceTimeline(FenceTimeline&& other) = delete;
+
+		FenceTimeline& operator=(FenceTimeline& other) = delete;
+		FenceTimeline& operator=(FenceTimeline&& other) = delete;
+
+		/**
+		 * Check if the fence has reached the value. The fence is only
+		 * queried if the cached completed value has not reached it yet.
+		 */
+		bool IsComplete(uint64_t value);
+
+		// Query the fence and update the cached completed value, without running callbacks.
+		uint64_t GetCompletedValue();
+
+		// Get the cached completed value, without querying the fence.
+		uint64_t GetCachedCompletedValue() const { return m_CompletedValue; }
+
+		/**
+		 * Query the fence, update the cached completed value and run the callbacks
+		 * of the values that have completed.
+		 *
+		 * @return The completed value.
+		 */
+		uint64_t Poll();
+
+		// Block until the fence reaches the value. Callbacks are left to the next poll.
+		void WaitForValue(uint64_t value);
+
+		/**
+		 * Run the callback once the fence reaches the value. If the cached completed
+		 * value already has, the callback is run right away.
+		 * Callbacks are run on the thread that polls, in the order of their values.
+		 */
+		void AddCompletionCallback(uint64_t value, CompletionCallback callback);
+
+		// Get the number of callbacks that are waiting for their value.
+		size_t GetNumPendingCallbacks() const;
+
+		std::shared_ptr<Fence> GetFence() const { return m_pFence; }
+
+	private:
+		// Run the callbacks of which the value is less than or equal to the completed value.
+		void RunCompletedCallbacks(uint64_t completedValue);
+
+		std::shared_ptr<Fence> m_pFence;
+
+		std::atomic<uint64_t> m_CompletedValue;
+
+		// Callbacks ordered by the value they wait for.
+		std::multimap<uint64_t, CompletionCallback> m_Callbacks;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_FENCE_TIMELINE_
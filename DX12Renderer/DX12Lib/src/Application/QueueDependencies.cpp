@@ -0,0 +1,37 @@
+// QueueDependencies.cpp
+
+// Header include
+#include "QueueDependencies.h"
+
+// File includes
+#include "FenceTimeline.h"
+
+bool DDM::QueueDependencies::AddDependency(FenceTimeline& otherTimeline, uint64_t fenceValue)
+{
+    // The other queue is already done.
+    if (otherTimeline.IsComplete(fenceValue))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    uint64_t& waitedFenceValue = m_WaitedFenceValues[&otherTimeline];
+    if (waitedFenceValue >= fenceValue)
+    {
+        return false;
+    }
+
+    waitedFenceValue = fenceValue;
+
+    return true;
+}
+
+uint64_t DDM::QueueDependencies::GetWaitedFenceValue(const FenceTimeline& otherTimeline) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    const auto iter = m_WaitedFenceValues.find(&otherTimeline);
+
+    return iter != m_WaitedFenceValues.end() ? iter->second : 0;
+}
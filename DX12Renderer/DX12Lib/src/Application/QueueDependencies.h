@@ -0,0 +1,57 @@
+// QueueDependencies.h
+
+/**
+ * Keeps track of the fence values of other queues that a command queue has waited on.
+ *
+ * A GPU side wait on another queue is only needed if the other queue has not reached
+ * the fence value yet, and if the queue has not waited on that value, or a later one,
+ * before. Commands are executed in order on a queue, so an earlier wait still holds.
+ *
+ * The other queues are represented by their fence timelines, so the dependencies can be
+ * resolved against timelines of fences that are signaled on the CPU.
+ */
+
+#ifndef _QUEUE_DEPENDENCIES_
+#define _QUEUE_DEPENDENCIES_
+
+// Standard library includes
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace DDM
+{
+	class FenceTimeline;
+
+	class QueueDependencies final
+	{
+	public:
+		QueueDependencies() = default;
+
+		~QueueDependencies() = default;
+
+		QueueDependencies(QueueDependencies& other) = delete;
+		QueueDependencies(QueueDependencies&& other) = delete;
+
+		QueueDependencies& operator=(QueueDependencies& other) = delete;
+		QueueDependencies& operator=(QueueDependencies&& other) = delete;
+
+		/**
+		 * Add a dependency on the fence value of another queue.
+		 *
+		 * @return True if the queue has to wait on the GPU for the other queue to reach the
+		 * fence value, in which case the wait is recorded.
+		 */
+		bool AddDependency(FenceTimeline& otherTimeline, uint64_t fenceValue);
+
+		// Get the last fence value of the other queue that was waited on, 0 if none.
+		uint64_t GetWaitedFenceValue(const FenceTimeline& otherTimeline) const;
+
+	private:
+		std::unordered_map<const FenceTimeline*, uint64_t> m_WaitedFenceValues;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_QUEUE_DEPENDENCIES_
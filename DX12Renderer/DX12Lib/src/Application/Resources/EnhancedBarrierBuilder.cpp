@@ -0,0 +1,258 @@
+// EnhancedBarrierBuilder.cpp
+
+// Header include
+#include "EnhancedBarrierBuilder.h"
+
+// Standard library includes
+#include <cassert>
+
+namespace
+{
+    // The scopes of every legacy state bit.
+    struct StateScopes
+    {
+        D3D12_RESOURCE_STATES State;
+        D3D12_BARRIER_LAYOUT Layout;
+        D3D12_BARRIER_SYNC Sync;
+        D3D12_BARRIER_ACCESS Access;
+    };
+
+    const StateScopes ResourceStateScopes[] =
+    {
+        { D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_BARRIER_LAYOUT_GENERIC_READ,
+            D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_VERTEX_BUFFER | D3D12_BARRIER_ACCESS_CONSTANT_BUFFER },
+        { D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_BARRIER_LAYOUT_GENERIC_READ,
+            D3D12_BARRIER_SYNC_INDEX_INPUT, D3D12_BARRIER_ACCESS_INDEX_BUFFER },
+        { D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_BARRIER_LAYOUT_RENDER_TARGET,
+            D3D12_BARRIER_SYNC_RENDER_TARGET, D3D12_BARRIER_ACCESS_RENDER_TARGET },
+        { D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS,
+            D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_CLEAR_UNORDERED_ACCESS_VIEW, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS },
+        { D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE,
+            D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE },
+        { D3D12_RESOURCE_STATE_DEPTH_READ, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ,
+            D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ },
+        { D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_BARRIER_LAYOUT_SHADER_RESOURCE,
+            D3D12_BARRIER_SYNC_NON_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE },
+        { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_BARRIER_LAYOUT_SHADER_RESOURCE,
+            D3D12_BARRIER_SYNC_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE },
+        { D3D12_RESOURCE_STATE_STREAM_OUT, D3D12_BARRIER_LAYOUT_COMMON,
+            D3D12_BARRIER_SYNC_VERTEX_SHADING, D3D12_BARRIER_ACCESS_STREAM_OUTPUT },
+        { D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_BARRIER_LAYOUT_GENERIC_READ,
+            D3D12_BARRIER_SYNC_EXECUTE_INDIRECT, D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT },
+        { D3D12_RESOURCE_STATE_COPY_DEST, D3D12_BARRIER_LAYOUT_COPY_DEST,
+            D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST },
+        { D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_BARRIER_LAYOUT_COPY_SOURCE,
+            D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE },
+        { D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_BARRIER_LAYOUT_RESOLVE_DEST,
+            D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_DEST },
+        { D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_BARRIER_LAYOUT_RESOLVE_SOURCE,
+            D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_SOURCE },
+        { D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_LAYOUT_UNDEFINED,
+            D3D12_BARRIER_SYNC_RAYTRACING | D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE
+                | D3D12_BARRIER_SYNC_COPY_RAYTRACING_ACCELERATION_STRUCTURE,
+            D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE },
+        { D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE, D3D12_BARRIER_LAYOUT_SHADING_RATE_SOURCE,
+            D3D12_BARRIER_SYNC_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADING_RATE_SOURCE },
+    };
+}
+
+DDM::EnhancedBarrierBuilder::BarrierState DDM::EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATES state, bool isTexture)
+{
+    BarrierState barrierState;
+    barrierState.Layout = isTexture ? D3D12_BARRIER_LAYOUT_COMMON : D3D12_BARRIER_LAYOUT_UNDEFINED;
+
+    // The common (and present) state can be used by any stage of the queue.
+    if (state == D3D12_RESOURCE_STATE_COMMON)
+    {
+        barrierState.Sync = D3D12_BARRIER_SYNC_ALL;
+        barrierState.Access = D3D12_BARRIER_ACCESS_COMMON;
+        return barrierState;
+    }
+
+    barrierState.Sync = D3D12_BARRIER_SYNC_NONE;
+    barrierState.Access = D3D12_BARRIER_ACCESS_COMMON;
+
+    uint32_t numLayouts = 0;
+    D3D12_BARRIER_LAYOUT layout = D3D12_BARRIER_LAYOUT_COMMON;
+    for (const auto& scopes : ResourceStateScopes)
+    {
+        if ((state & scopes.State) == scopes.State)
+        {
+            barrierState.Sync |= scopes.Sync;
+            barrierState.Access |= scopes.Access;
+
+            if (numLayouts == 0 || layout != scopes.Layout)
+            {
+                layout = scopes.Layout;
+                ++numLayouts;
+            }
+        }
+    }
+
+    assert(barrierState.Sync != D3D12_BARRIER_SYNC_NONE && "The resource state has no enhanced barrier equivalent.");
+
+    if (isTexture)
+    {
+        // Only read states are combined. Depth reads need the depth read layout, which
+        // also allows reading the texture in shaders, every other read fits the generic read layout.
+        if (numLayouts > 1)
+        {
+            layout = (state & D3D12_RESOURCE_STATE_DEPTH_READ) ? D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ
+                : D3D12_BARRIER_LAYOUT_GENERIC_READ;
+        }
+
+        barrierState.Layout = layout;
+    }
+
+    return barrierState;
+}
+
+D3D12_BARRIER_SUBRESOURCE_RANGE DDM::EnhancedBarrierBuilder::GetSubresourceRange(UINT subresource)
+{
+    // With 0 mip levels, the first member is a subresource index, 0xffffffff selects all of them.
+    D3D12_BARRIER_SUBRESOURCE_RANGE range = {};
+    range.IndexOrFirstMipLevel = subresource;
+    range.NumMipLevels = 0;
+
+    return range;
+}
+
+void DDM::EnhancedBarrierBuilder::AddBarrier(const D3D12_RESOURCE_BARRIER& barrier)
+{
+    bool isTexture = false;
+    bool isCommonLayout = false;
+    if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+    {
+        D3D12_RESOURCE_DESC desc = barrier.Transition.pResource->GetDesc();
+        isTexture = desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER;
+        isCommonLayout = (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS) != 0;
+    }
+
+    AddBarrier(barrier, isTexture, isCommonLayout);
+}
+
+void DDM::EnhancedBarrierBuilder::AddBarrier(const D3D12_RESOURCE_BARRIER& barrier, bool isTexture, bool isCommonLayout)
+{
+    switch (barrier.Type)
+    {
+    case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+    {
+        const D3D12_RESOURCE_TRANSITION_BARRIER& transition = barrier.Transition;
+
+        BarrierState stateBefore = GetBarrierState(transition.StateBefore, isTexture);
+        BarrierState stateAfter = GetBarrierState(transition.StateAfter, isTexture);
+
+        // The halves of a split barrier are joined by the split sync scope.
+        D3D12_BARRIER_SYNC syncBefore = (barrier.Flags & D3D12_RESOURCE_BARRIER_FLAG_END_ONLY) ? D3D12_BARRIER_SYNC_SPLIT : stateBefore.Sync;
+        D3D12_BARRIER_SYNC syncAfter = (barrier.Flags & D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY) ? D3D12_BARRIER_SYNC_SPLIT : stateAfter.Sync;
+
+        if (isTexture)
+        {
+            D3D12_TEXTURE_BARRIER textureBarrier = {};
+            textureBarrier.SyncBefore = syncBefore;
+            textureBarrier.SyncAfter = syncAfter;
+            textureBarrier.AccessBefore = stateBefore.Access;
+            textureBarrier.AccessAfter = stateAfter.Access;
+            textureBarrier.LayoutBefore = isCommonLayout ? D3D12_BARRIER_LAYOUT_COMMON : stateBefore.Layout;
+            textureBarrier.LayoutAfter = isCommonLayout ? D3D12_BARRIER_LAYOUT_COMMON : stateAfter.Layout;
+            textureBarrier.pResource = transition.pResource;
+            textureBarrier.Subresources = GetSubresourceRange(transition.Subresource);
+            textureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+
+            m_TextureBarriers.push_back(textureBarrier);
+        }
+        else
+        {
+            D3D12_BUFFER_BARRIER bufferBarrier = {};
+            bufferBarrier.SyncBefore = syncBefore;
+            bufferBarrier.SyncAfter = syncAfter;
+            bufferBarrier.AccessBefore = stateBefore.Access;
+            bufferBarrier.AccessAfter = stateAfter.Access;
+            bufferBarrier.pResource = transition.pResource;
+            // Buffer barriers always cover the whole buffer.
+            bufferBarrier.Offset = 0;
+            bufferBarrier.Size = UINT64_MAX;
+
+            m_BufferBarriers.push_back(bufferBarrier);
+        }
+    }
+    break;
+    case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+    {
+        // Wait for the writes of every stage that can write to a UAV, including acceleration
+        // structure builds, before they are read or written again.
+        D3D12_GLOBAL_BARRIER globalBarrier = {};
+        globalBarrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
+        globalBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
+        globalBarrier.AccessBefore = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE;
+        globalBarrier.AccessAfter = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ
+            | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE;
+
+        m_GlobalBarriers.push_back(globalBarrier);
+    }
+    break;
+    case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+    {
+        // A full flush, like the legacy aliasing barrier. Textures that are aliased still
+        // have to be initialized by the caller.
+        D3D12_GLOBAL_BARRIER globalBarrier = {};
+        globalBarrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
+        globalBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
+        globalBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COMMON;
+        globalBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
+
+        m_GlobalBarriers.push_back(globalBarrier);
+    }
+    break;
+    }
+}
+
+uint32_t DDM::EnhancedBarrierBuilder::Flush(ID3D12GraphicsCommandList7* commandList)
+{
+    D3D12_BARRIER_GROUP barrierGroups[3];
+    UINT32 numBarrierGroups = 0;
+    uint32_t numBarriers = 0;
+
+    if (!m_GlobalBarriers.empty())
+    {
+        D3D12_BARRIER_GROUP& barrierGroup = barrierGroups[numBarrierGroups++];
+        barrierGroup.Type = D3D12_BARRIER_TYPE_GLOBAL;
+        barrierGroup.NumBarriers = static_cast<UINT32>(m_GlobalBarriers.size());
+        barrierGroup.pGlobalBarriers = m_GlobalBarriers.data();
+        numBarriers += barrierGroup.NumBarriers;
+    }
+
+    if (!m_TextureBarriers.empty())
+    {
+        D3D12_BARRIER_GROUP& barrierGroup = barrierGroups[numBarrierGroups++];
+        barrierGroup.Type = D3D12_BARRIER_TYPE_TEXTURE;
+        barrierGroup.NumBarriers = static_cast<UINT32>(m_TextureBarriers.size());
+        barrierGroup.pTextureBarriers = m_TextureBarriers.data();
+        numBarriers += barrierGroup.NumBarriers;
+    }
+
+    if (!m_BufferBarriers.empty())
+    {
+        D3D12_BARRIER_GROUP& barrierGroup = barrierGroups[numBarrierGroups++];
+        barrierGroup.Type = D3D12_BARRIER_TYPE_BUFFER;
+        barrierGroup.NumBarriers = static_cast<UINT32>(m_BufferBarriers.size());
+        barrierGroup.pBufferBarriers = m_BufferBarriers.data();
+        numBarriers += barrierGroup.NumBarriers;
+    }
+
+    if (numBarrierGroups > 0)
+    {
+        commandList->Barrier(numBarrierGroups, barrierGroups);
+    }
+
+    Clear();
+
+    return numBarriers;
+}
+
+void DDM::EnhancedBarrierBuilder::Clear()
+{
+    m_GlobalBarriers.clear();
+    m_TextureBarriers.clear();
+    m_BufferBarriers.clear();
+}
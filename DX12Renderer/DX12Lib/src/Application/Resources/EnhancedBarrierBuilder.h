@@ -0,0 +1,97 @@
+// EnhancedBarrierBuilder.h
+
+/**
+ * Translates legacy resource barriers into enhanced barriers (ID3D12GraphicsCommandList7::Barrier).
+ *
+ * The resource state tracker keeps tracking D3D12_RESOURCE_STATES, each state is mapped
+ * onto the layout, sync and access scopes it implies. Transitions of textures become
+ * texture barriers, transitions of buffers become buffer barriers, which have no layout.
+ * UAV and aliasing barriers become global barriers.
+ *
+ * Enhanced barriers only wait for the stages that used the resource before the barrier,
+ * instead of the full pipeline flush that a legacy transition implies.
+ *
+ * The translation does not use the device, so it can be checked on the CPU.
+ */
+
+#ifndef _ENHANCED_BARRIER_BUILDER_
+#define _ENHANCED_BARRIER_BUILDER_
+
+// File includes
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <cstdint>
+#include <vector>
+
+namespace DDM
+{
+	class EnhancedBarrierBuilder final
+	{
+	public:
+		// The enhanced barrier scopes of a legacy resource state.
+		struct BarrierState
+		{
+			D3D12_BARRIER_LAYOUT Layout;
+			D3D12_BARRIER_SYNC Sync;
+			D3D12_BARRIER_ACCESS Access;
+		};
+
+		EnhancedBarrierBuilder() = default;
+
+		~EnhancedBarrierBuilder() = default;
+
+		EnhancedBarrierBuilder(EnhancedBarrierBuilder& other) = delete;
+		EnhancedBarrierBuilder(EnhancedBarrierBuilder&& other) = delete;
+
+		EnhancedBarrierBuilder& operator=(EnhancedBarrierBuilder& other) = delete;
+		EnhancedBarrierBuilder& operator=(EnhancedBarrierBuilder&& other) = delete;
+
+		/**
+		 * Get the layout, sync and access scopes of a legacy resource state.
+		 * States that combine several read states get the union of their scopes.
+		 *
+		 * @param isTexture Buffers have no layout, their layout is D3D12_BARRIER_LAYOUT_UNDEFINED.
+		 */
+		static BarrierState GetBarrierState(D3D12_RESOURCE_STATES state, bool isTexture);
+
+		// Get the subresource range of a legacy subresource index, or of all subresources.
+		static D3D12_BARRIER_SUBRESOURCE_RANGE GetSubresourceRange(UINT subresource);
+
+		/**
+		 * Translate a legacy barrier. The resource of a transition is asked whether it is
+		 * a texture or a buffer, and whether it allows simultaneous access.
+		 */
+		void AddBarrier(const D3D12_RESOURCE_BARRIER& barrier);
+
+		/**
+		 * Translate a legacy barrier of which it is known whether its resource is a texture.
+		 *
+		 * @param isCommonLayout The texture stays in the common layout. Textures that allow simultaneous
+		 * access are promoted to their states without a barrier, so they never leave the common layout.
+		 */
+		void AddBarrier(const D3D12_RESOURCE_BARRIER& barrier, bool isTexture, bool isCommonLayout = false);
+
+		/**
+		 * Record the translated barriers to the command list in a single Barrier call, and clear them.
+		 *
+		 * @return The number of barriers that were recorded.
+		 */
+		uint32_t Flush(ID3D12GraphicsCommandList7* commandList);
+
+		void Clear();
+
+		const std::vector<D3D12_GLOBAL_BARRIER>& GetGlobalBarriers() const { return m_GlobalBarriers; }
+		const std::vector<D3D12_TEXTURE_BARRIER>& GetTextureBarriers() const { return m_TextureBarriers; }
+		const std::vector<D3D12_BUFFER_BARRIER>& GetBufferBarriers() const { return m_BufferBarriers; }
+
+	private:
+		// The barriers are kept between flushes, so recording barriers does not allocate
+		// once the arrays have grown.
+		std::vector<D3D12_GLOBAL_BARRIER> m_GlobalBarriers;
+		std::vector<D3D12_TEXTURE_BARRIER> m_TextureBarriers;
+		std::vector<D3D12_BUFFER_BARRIER> m_BufferBarriers;
+	};
+}
+
+#endif // !_ENHANCED_BARRIER_BUILDER_
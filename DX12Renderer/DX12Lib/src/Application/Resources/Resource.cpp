@@ -7,6 +7,8 @@
 #include "Includes/DXRHelpersIncludes.h"
 #include "Application/Application.h"
 #include "ResourceStateTracker.h"
+#include "Application/DescriptorAllocator/BindlessDescriptorHeap.h"
+#include "Application/DescriptorAllocator/ViewDescriptorCache.h"
 
 DDM::Resource::Resource(const std::wstring& name)
     : m_ResourceName(name)
@@ -52,6 +54,7 @@ DDM::Resource::Resource(const DDM::Resource& copy)
     , m_FormatSupport(copy.m_FormatSupport)
     , m_ResourceName(copy.m_ResourceName)
     , m_d3d12ClearValue(std::make_unique<D3D12_CLEAR_VALUE>(*copy.m_d3d12ClearValue))
+    , m_BindlessShaderResourceView(copy.m_BindlessShaderResourceView)
 {}
 
 DDM::Resource::Resource(DDM::Resource&& copy)
@@ -59,6 +62,7 @@ DDM::Resource::Resource(DDM::Resource&& copy)
     , m_FormatSupport(copy.m_FormatSupport)
     , m_ResourceName(std::move(copy.m_ResourceName))
     , m_d3d12ClearValue(std::move(copy.m_d3d12ClearValue))
+    , m_BindlessShaderResourceView(std::move(copy.m_BindlessShaderResourceView))
 {}
 
 DDM::Resource& DDM::Resource::operator=(const DDM::Resource& other)
@@ -68,6 +72,7 @@ DDM::Resource& DDM::Resource::operator=(const DDM::Resource& other)
         m_d3d12Resource = other.m_d3d12Resource;
         m_FormatSupport = other.m_FormatSupport;
         m_ResourceName = other.m_ResourceName;
+        m_BindlessShaderResourceView = other.m_BindlessShaderResourceView;
         if (other.m_d3d12ClearValue)
         {
             m_d3d12ClearValue = std::make_unique<D3D12_CLEAR_VALUE>(*other.m_d3d12ClearValue);
@@ -85,6 +90,7 @@ DDM::Resource& DDM::Resource::operator=(DDM::Resource&& other) noexcept
         m_FormatSupport = other.m_FormatSupport;
         m_ResourceName = std::move(other.m_ResourceName);
         m_d3d12ClearValue = std::move(other.m_d3d12ClearValue);
+        m_BindlessShaderResourceView = std::move(other.m_BindlessShaderResourceView);
 
         other.Reset();
     }
@@ -99,7 +105,15 @@ DDM::Resource::~Resource()
 
 void DDM::Resource::SetD3D12Resource(Microsoft::WRL::ComPtr<ID3D12Resource> d3d12Resource, const D3D12_CLEAR_VALUE* clearValue)
 {
+    // The cached views describe the previous resource.
+    if (m_d3d12Resource && m_d3d12Resource != d3d12Resource)
+    {
+        Application::Get().GetViewDescriptorCache()->Invalidate(m_d3d12Resource.Get());
+    }
+
     m_d3d12Resource = d3d12Resource;
+    // The view describes the previous resource. It is recreated with the views of the new resource.
+    m_BindlessShaderResourceView.reset();
     if (m_d3d12ClearValue)
     {
         m_d3d12ClearValue = std::make_unique<D3D12_CLEAR_VALUE>(*clearValue);
@@ -127,6 +141,46 @@ void DDM::Resource::Reset()
     m_FormatSupport = {};
     m_d3d12ClearValue.reset();
     m_ResourceName.clear();
+    m_BindlessShaderResourceView.reset();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::Resource::GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc) const
+{
+    assert(m_d3d12Resource && "The resource has no views.");
+
+    // The cache keeps the view alive together with the resource.
+    auto view = Application::Get().GetViewDescriptorCache()->GetShaderResourceView(m_d3d12Resource.Get(), srvDesc);
+    return view->GetDescriptorHandle();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DDM::Resource::GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc) const
+{
+    assert(m_d3d12Resource && "The resource has no views.");
+
+    auto view = Application::Get().GetViewDescriptorCache()->GetUnorderedAccessView(m_d3d12Resource.Get(), uavDesc);
+    return view->GetDescriptorHandle();
+}
+
+uint32_t DDM::Resource::GetBindlessShaderResourceIndex() const
+{
+    return m_BindlessShaderResourceView ? m_BindlessShaderResourceView->GetIndex() : UINT32_MAX;
+}
+
+void DDM::Resource::CreateBindlessShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc)
+{
+    auto bindlessDescriptorHeap = Application::Get().GetBindlessDescriptorHeap();
+    if (!bindlessDescriptorHeap || !m_d3d12Resource)
+    {
+        return;
+    }
+
+    // Always use a new descriptor, GPU work that is in flight may still read the previous one.
+    auto descriptor = std::make_shared<BindlessDescriptor>(bindlessDescriptorHeap->Allocate());
+
+    auto device = Application::Get().GetDevice();
+    device->CreateShaderResourceView(m_d3d12Resource.Get(), srvDesc, descriptor->GetCPUDescriptorHandle());
+
+    m_BindlessShaderResourceView = std::move(descriptor);
 }
 
 bool DDM::Resource::CheckFormatSupport(D3D12_FORMAT_SUPPORT1 formatSupport) const
@@ -41,6 +41,8 @@
 
 namespace DDM
 {
+    class BindlessDescriptor;
+
     class Resource
     {
     public:
@@ -90,19 +92,30 @@ namespace DDM
 
         /**
          * Get the SRV for a resource.
+         * The view is created once and kept in the view descriptor cache, the handle
+         * stays valid while the resource is alive.
          *
          * @param srvDesc The description of the SRV to return. The default is nullptr
          * which returns the default SRV for the resource (the SRV that is created when no
          * description is provided.
          */
-        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc = nullptr) const = 0;
+        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc = nullptr) const;
 
         /**
          * Get the UAV for a (sub)resource.
+         * The view is created once and kept in the view descriptor cache, the handle
+         * stays valid while the resource is alive.
          *
          * @param uavDesc The description of the UAV to return.
          */
-        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc = nullptr) const = 0;
+        virtual D3D12_CPU_DESCRIPTOR_HANDLE GetUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC* uavDesc = nullptr) const;
+
+        /**
+         * Get the index of the SRV in the bindless descriptor heap, for use with
+         * ResourceDescriptorHeap[] in shaders.
+         * Returns UINT32_MAX if bindless descriptors are not enabled or the resource has no view.
+         */
+        uint32_t GetBindlessShaderResourceIndex() const;
 
         /**
          * Set the name of the resource. Useful for debugging purposes.
@@ -125,12 +138,23 @@ namespace DDM
 
 
     protected:
+        /**
+         * Write a SRV of the resource into the bindless descriptor heap.
+         * Does nothing if bindless descriptors are not enabled.
+         * The view keeps its index until the resource is replaced or reset, copies
+         * of the resource share the view.
+         */
+        void CreateBindlessShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc);
+
         // The underlying D3D12 resource.
         Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
         D3D12_FEATURE_DATA_FORMAT_SUPPORT m_FormatSupport;
         std::unique_ptr<D3D12_CLEAR_VALUE> m_d3d12ClearValue;
         std::wstring m_ResourceName;
 
+        // The SRV in the bindless descriptor heap, freed with the last copy of the resource.
+        std::shared_ptr<BindlessDescriptor> m_BindlessShaderResourceView;
+
     private:
         // Check the format support and populate the m_FormatSupport structure.
         void CheckFeatureSupport();
@@ -4,17 +4,113 @@
 #include "ResourceStateTracker.h"
 
 // File includes
+#include "Application/Application.h"
 #include "Application/CommandList.h"
+#include "Includes/DXRHelpersIncludes.h"
 #include "Resource.h"
 
+// Standard library includes
+#include <atomic>
+#include <cassert>
+#include <mutex>
+
 using namespace DDM;
 
 // Static definitions.
-std::mutex ResourceStateTracker::ms_GlobalMutex;
-bool ResourceStateTracker::ms_IsLocked = false;
-ResourceStateTracker::ResourceStateMap ResourceStateTracker::ms_GlobalResourceState;
+std::atomic<ResourceStateTracker::BarrierBackend> ResourceStateTracker::ms_BarrierBackend = ResourceStateTracker::BarrierBackend::Legacy;
+std::atomic<uint32_t> ResourceStateTracker::ms_NumElidedBarriersThisFrame = 0;
+std::atomic<uint32_t> ResourceStateTracker::ms_NumElidedBarriersLastFrame = 0;
+
+namespace
+{
+    // The private data GUID of the global resource state, {5C1A54D2-6C3B-4E4F-9E0D-8B8A1C0F7D31}.
+    constexpr GUID GlobalResourceStateGuid = { 0x5c1a54d2, 0x6c3b, 0x4e4f, { 0x9e, 0x0d, 0x8b, 0x8a, 0x1c, 0x0f, 0x7d, 0x31 } };
+
+    // The states in which a resource can only be read, and that can be combined with each other.
+    constexpr D3D12_RESOURCE_STATES ReadOnlyResourceStates = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+        | D3D12_RESOURCE_STATE_INDEX_BUFFER | D3D12_RESOURCE_STATE_DEPTH_READ
+        | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+        | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE
+        | D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+}
+
+// A COM object, so the resource keeps it alive through SetPrivateDataInterface
+// and releases it when the resource is destroyed.
+class ResourceStateTracker::GlobalResourceState final : public IUnknown
+{
+public:
+    explicit GlobalResourceState(D3D12_RESOURCE_STATES state)
+        : State(state)
+        , m_RefCount(1)
+    {}
+
+    GlobalResourceState(GlobalResourceState& other) = delete;
+    GlobalResourceState(GlobalResourceState&& other) = delete;
+
+    GlobalResourceState& operator=(GlobalResourceState& other) = delete;
+    GlobalResourceState& operator=(GlobalResourceState&& other) = delete;
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if (ppvObject == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        if (riid == __uuidof(IUnknown))
+        {
+            AddRef();
+            *ppvObject = static_cast<IUnknown*>(this);
+            return S_OK;
+        }
+
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return m_RefCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refCount = m_RefCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (refCount == 0)
+        {
+            delete this;
+        }
+
+        return refCount;
+    }
+
+    // The lock is only held for a couple of lookups, contention is rare and short.
+    void Lock()
+    {
+        while (m_Lock.test_and_set(std::memory_order_acquire))
+        {
+            m_Lock.wait(true, std::memory_order_relaxed);
+        }
+    }
+
+    void Unlock()
+    {
+        m_Lock.clear(std::memory_order_release);
+        m_Lock.notify_one();
+    }
+
+    // Only access the state while the lock is held.
+    ResourceState State;
+
+private:
+    ~GlobalResourceState() = default;
+
+    std::atomic<ULONG> m_RefCount;
+    std::atomic_flag m_Lock;
+};
 
-ResourceStateTracker::ResourceStateTracker()
+ResourceStateTracker::ResourceStateTracker(D3D12_COMMAND_LIST_TYPE commandListType)
+    : m_CommandListType(commandListType)
 {}
 
 ResourceStateTracker::~ResourceStateTracker()
@@ -25,51 +121,87 @@ void ResourceStateTracker::ResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier
     if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
     {
         const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
+        D3D12_RESOURCE_STATES stateAfter = transitionBarrier.StateAfter;
+
+        assert(!FindSplitResourceBarrier(transitionBarrier.pResource, transitionBarrier.Subresource)
+            && "The split transition of the resource has to be ended first.");
 
         // First check if there is already a known "final" state for the given resource.
         // If there is, the resource has been used on the command list before and
         // already has a known state within the command list execution.
-        const auto iter = m_FinalResourceState.find(transitionBarrier.pResource);
+        auto iter = m_FinalResourceState.find(transitionBarrier.pResource);
         if (iter != m_FinalResourceState.end())
         {
             auto& resourceState = iter->second;
             // If the known final state of the resource is different...
             if (transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                !resourceState.SubresourceState.empty())
+                !resourceState.SubresourceState.IsEmpty())
             {
                 // First transition all of the subresources if they are different than the StateAfter.
-                for (auto subresourceState : resourceState.SubresourceState)
-                {
-                    if (transitionBarrier.StateAfter != subresourceState.second)
+                resourceState.SubresourceState.ForEach([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState)
                     {
-                        D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                        newBarrier.Transition.Subresource = subresourceState.first;
-                        newBarrier.Transition.StateBefore = subresourceState.second;
-                        m_ResourceBarriers.push_back(newBarrier);
-                    }
-                }
+                        if (transitionBarrier.StateAfter != subresourceState)
+                        {
+                            D3D12_RESOURCE_BARRIER newBarrier = barrier;
+                            newBarrier.Transition.Subresource = subresource;
+                            newBarrier.Transition.StateBefore = subresourceState;
+                            m_ResourceBarriers.push_back(newBarrier);
+                        }
+                    });
+
+                resourceState.IsPromoted = false;
             }
             else
             {
                 auto finalState = resourceState.GetSubresourceState(transitionBarrier.Subresource);
-                if (transitionBarrier.StateAfter != finalState)
+                // Promotion is only tracked for the resource as a whole.
+                bool isPromotable = resourceState.IsStateless ||
+                    (transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && resourceState.SubresourceState.IsEmpty());
+
+                if (isPromotable && finalState == D3D12_RESOURCE_STATE_COMMON && CanPromoteFromCommonState(stateAfter, resourceState.IsStateless))
+                {
+                    // The runtime promotes the resource when it is accessed.
+                    resourceState.IsPromoted = true;
+                    ++ms_NumElidedBarriersThisFrame;
+                }
+                else if (isPromotable && resourceState.IsPromoted && IsReadOnlyState(finalState) && IsReadOnlyState(stateAfter)
+                    && CanPromoteFromCommonState(finalState | stateAfter, resourceState.IsStateless))
                 {
-                    // Push a new transition barrier with the correct before state.
-                    D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                    newBarrier.Transition.StateBefore = finalState;
-                    m_ResourceBarriers.push_back(newBarrier);
+                    // A resource that was promoted to a read state is promoted to further read states.
+                    stateAfter = finalState | stateAfter;
+                    ++ms_NumElidedBarriersThisFrame;
+                }
+                else
+                {
+                    stateAfter = CombineReadStates(finalState, stateAfter);
+                    if (stateAfter != finalState)
+                    {
+                        // Push a new transition barrier with the correct before state.
+                        D3D12_RESOURCE_BARRIER newBarrier = barrier;
+                        newBarrier.Transition.StateBefore = finalState;
+                        newBarrier.Transition.StateAfter = stateAfter;
+                        m_ResourceBarriers.push_back(newBarrier);
+
+                        resourceState.IsPromoted = false;
+                    }
                 }
             }
+
+            resourceState.IsPendingState = false;
         }
         else // In this case, the resource is being used on the command list for the first time. 
         {
             // Add a pending barrier. The pending barriers will be resolved
             // before the command list is executed on the command queue.
             m_PendingResourceBarriers.push_back(barrier);
+
+            iter = m_FinalResourceState.emplace(transitionBarrier.pResource, ResourceState()).first;
+            iter->second.IsStateless = IsStatelessResource(transitionBarrier.pResource);
+            iter->second.IsPendingState = true;
         }
 
         // Push the final known state (possibly replacing the previously known state for the subresource).
-        m_FinalResourceState[transitionBarrier.pResource].SetSubresourceState(transitionBarrier.Subresource, transitionBarrier.StateAfter);
+        iter->second.SetSubresourceState(transitionBarrier.Subresource, stateAfter);
     }
     else
     {
@@ -91,6 +223,125 @@ void ResourceStateTracker::TransitionResource(const Resource& resource, D3D12_RE
     TransitionResource(resource.GetD3D12Resource().Get(), stateAfter, subResource);
 }
 
+void ResourceStateTracker::BeginTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource)
+{
+    if (resource == nullptr)
+    {
+        return;
+    }
+
+    assert(!FindSplitResourceBarrier(resource, subResource) && "The resource is already being transitioned.");
+
+    // Resources that are used for the first time are transitioned by the pending barriers,
+    // which are executed in another command list.
+    const auto iter = m_FinalResourceState.find(resource);
+    if (iter == m_FinalResourceState.end())
+    {
+        return;
+    }
+
+    // Subresources in different states would need one split transition each, those are
+    // transitioned when the transition is ended instead.
+    const auto& resourceState = iter->second;
+    if (subResource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !resourceState.SubresourceState.IsEmpty())
+    {
+        return;
+    }
+
+    D3D12_RESOURCE_STATES stateBefore = resourceState.GetSubresourceState(subResource);
+    stateAfter = CombineReadStates(stateBefore, stateAfter);
+    if (stateAfter == stateBefore)
+    {
+        return;
+    }
+
+    // Transitions from the common state may be done by implicit promotion, which is decided
+    // when the transition is ended.
+    if (stateBefore == D3D12_RESOURCE_STATE_COMMON && CanPromoteFromCommonState(stateAfter, resourceState.IsStateless))
+    {
+        return;
+    }
+
+    m_ResourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, stateAfter, subResource,
+        D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+    m_SplitResourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, stateAfter, subResource,
+        D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+}
+
+void ResourceStateTracker::EndTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource)
+{
+    D3D12_RESOURCE_BARRIER* splitBarrier = FindSplitResourceBarrier(resource, subResource);
+    if (splitBarrier == nullptr)
+    {
+        TransitionResource(resource, stateAfter, subResource);
+        return;
+    }
+
+    assert((splitBarrier->Transition.StateAfter & stateAfter) == stateAfter
+        && "The transition has to be ended with the state it was begun with.");
+
+    m_ResourceBarriers.push_back(*splitBarrier);
+
+    auto& resourceState = m_FinalResourceState[resource];
+    resourceState.SetSubresourceState(subResource, splitBarrier->Transition.StateAfter);
+    resourceState.IsPromoted = false;
+    resourceState.IsPendingState = false;
+
+    *splitBarrier = m_SplitResourceBarriers.back();
+    m_SplitResourceBarriers.pop_back();
+}
+
+void ResourceStateTracker::HandoffResource(ID3D12Resource* resource, D3D12_COMMAND_LIST_TYPE destinationType)
+{
+    if (resource == nullptr)
+    {
+        return;
+    }
+
+    // If the states of the resource at the end of the command list are known and
+    // supported by the destination queue, it can pick up the resource from there.
+    const auto iter = m_FinalResourceState.find(resource);
+    if (iter != m_FinalResourceState.end())
+    {
+        const auto& resourceState = iter->second;
+
+        // The state of the resource applies to the subresources that have no state of their own.
+        bool isSupported = IsStateSupported(resourceState.State, destinationType);
+        resourceState.SubresourceState.ForEach([&](UINT, D3D12_RESOURCE_STATES subresourceState)
+            {
+                isSupported = isSupported && IsStateSupported(subresourceState, destinationType);
+            });
+
+        // Stateless resources, and resources used on a copy queue, decay to the common state anyway.
+        if (isSupported || resourceState.IsStateless || m_CommandListType == D3D12_COMMAND_LIST_TYPE_COPY)
+        {
+            return;
+        }
+    }
+
+    // Every queue type supports the common state.
+    ResourceBarrier(CD3DX12_RESOURCE_BARRIER::Transition(resource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON));
+}
+
+bool ResourceStateTracker::IsStateSupported(D3D12_RESOURCE_STATES state, D3D12_COMMAND_LIST_TYPE commandListType)
+{
+    constexpr D3D12_RESOURCE_STATES copyStates = D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+    constexpr D3D12_RESOURCE_STATES computeStates = copyStates | D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+        | D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+        | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE;
+
+    switch (commandListType)
+    {
+    case D3D12_COMMAND_LIST_TYPE_COPY:
+        return (state & ~copyStates) == 0;
+    case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+        return (state & ~computeStates) == 0;
+    default:
+        return true;
+    }
+}
+
 void ResourceStateTracker::UAVBarrier(const Resource* resource)
 {
     ID3D12Resource* pResource = resource != nullptr ? resource->GetD3D12Resource().Get() : nullptr;
@@ -108,19 +359,17 @@ void ResourceStateTracker::AliasBarrier(const Resource* resourceBefore, const Re
 
 void ResourceStateTracker::FlushResourceBarriers(CommandList& commandList)
 {
-    UINT numBarriers = static_cast<UINT>(m_ResourceBarriers.size());
-    if (numBarriers > 0)
+    CoalesceResourceBarriers(m_ResourceBarriers);
+
+    if (!m_ResourceBarriers.empty())
     {
-        auto d3d12CommandList = commandList.GetGraphicsCommandList();
-        d3d12CommandList->ResourceBarrier(numBarriers, m_ResourceBarriers.data());
+        RecordResourceBarriers(commandList, m_ResourceBarriers);
         m_ResourceBarriers.clear();
     }
 }
 
 uint32_t ResourceStateTracker::FlushPendingResourceBarriers(CommandList& commandList)
 {
-    assert(ms_IsLocked);
-
     // Resolve the pending resource barriers by checking the global state of the 
     // (sub)resources. Add barriers if the pending state and the global state do
     //  not match.
@@ -134,38 +383,60 @@ uint32_t ResourceStateTracker::FlushPendingResourceBarriers(CommandList& command
         {
             auto pendingTransition = pendingBarrier.Transition;
 
-            const auto& iter = ms_GlobalResourceState.find(pendingTransition.pResource);
-            if (iter != ms_GlobalResourceState.end())
+            auto globalResourceState = GetGlobalResourceState(pendingTransition.pResource, false);
+            if (globalResourceState)
             {
+                globalResourceState->Lock();
+
                 // If all subresources are being transitioned, and there are multiple
                 // subresources of the resource that are in a different state...
-                auto& resourceState = iter->second;
+                const auto& resourceState = globalResourceState->State;
                 if (pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                    !resourceState.SubresourceState.empty())
+                    !resourceState.SubresourceState.IsEmpty())
                 {
                     // Transition all subresources
-                    for (auto subresourceState : resourceState.SubresourceState)
-                    {
-                        if (pendingTransition.StateAfter != subresourceState.second)
+                    resourceState.SubresourceState.ForEach([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState)
                         {
-                            D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
-                            newBarrier.Transition.Subresource = subresourceState.first;
-                            newBarrier.Transition.StateBefore = subresourceState.second;
-                            resourceBarriers.push_back(newBarrier);
-                        }
-                    }
+                            if (pendingTransition.StateAfter != subresourceState)
+                            {
+                                assert(IsStateSupported(subresourceState, m_CommandListType)
+                                    && "The resource has to be handed off by the queue that used it last.");
+
+                                D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
+                                newBarrier.Transition.Subresource = subresource;
+                                newBarrier.Transition.StateBefore = subresourceState;
+                                resourceBarriers.push_back(newBarrier);
+                            }
+                        });
                 }
                 else
                 {
                     // No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
-                    auto globalState = (iter->second).GetSubresourceState(pendingTransition.Subresource);
-                    if (pendingTransition.StateAfter != globalState)
+                    auto globalState = resourceState.GetSubresourceState(pendingTransition.Subresource);
+
+                    auto& finalState = m_FinalResourceState[pendingTransition.pResource];
+                    bool isPromotable = finalState.IsStateless || pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+                    if (isPromotable && globalState == D3D12_RESOURCE_STATE_COMMON && pendingTransition.StateAfter != globalState
+                        && CanPromoteFromCommonState(pendingTransition.StateAfter, finalState.IsStateless))
+                    {
+                        // The runtime promotes the resource when the command list first accesses it.
+                        // If the command list did not transition it any further, it may decay after execution.
+                        finalState.IsPromoted = finalState.IsPendingState;
+                        ++ms_NumElidedBarriersThisFrame;
+                    }
+                    else if (pendingTransition.StateAfter != globalState)
                     {
+                        assert(IsStateSupported(globalState, m_CommandListType)
+                            && "The resource has to be handed off by the queue that used it last.");
+
                         // Fix-up the before state based on current global state of the resource.
                         pendingBarrier.Transition.StateBefore = globalState;
                         resourceBarriers.push_back(pendingBarrier);
                     }
                 }
+
+                globalResourceState->Unlock();
             }
         }
     }
@@ -173,8 +444,7 @@ uint32_t ResourceStateTracker::FlushPendingResourceBarriers(CommandList& command
     UINT numBarriers = static_cast<UINT>(resourceBarriers.size());
     if (numBarriers > 0)
     {
-        auto d3d12CommandList = commandList.GetGraphicsCommandList();
-        d3d12CommandList->ResourceBarrier(numBarriers, resourceBarriers.data());
+        RecordResourceBarriers(commandList, resourceBarriers);
     }
 
     m_PendingResourceBarriers.clear();
@@ -182,45 +452,245 @@ uint32_t ResourceStateTracker::FlushPendingResourceBarriers(CommandList& command
     return numBarriers;
 }
 
-void ResourceStateTracker::CommitFinalResourceStates()
+void ResourceStateTracker::CommitFinalResourceStates(std::unordered_set<ID3D12Resource*>& decayingResources)
 {
-    assert(ms_IsLocked);
+    assert(m_SplitResourceBarriers.empty() && "A split transition was begun but never ended.");
 
-    // Commit final resource states to the global resource state array (map).
+    // Commit final resource states to the global state of the resources.
     for (const auto& resourceState : m_FinalResourceState)
     {
-        ms_GlobalResourceState[resourceState.first] = resourceState.second;
+        auto globalResourceState = GetGlobalResourceState(resourceState.first, true);
+
+        const ResourceState& finalState = resourceState.second;
+
+        globalResourceState->Lock();
+        globalResourceState->State = finalState;
+        globalResourceState->Unlock();
+
+        // Resources that were used on a copy queue, stateless resources, and resources that
+        // were promoted to a read state decay to the common state when the execution completes.
+        bool decays = m_CommandListType == D3D12_COMMAND_LIST_TYPE_COPY || finalState.IsStateless
+            || (finalState.IsPromoted && finalState.SubresourceState.IsEmpty() && IsReadOnlyState(finalState.State));
+
+        if (decays)
+        {
+            decayingResources.insert(resourceState.first);
+        }
+        else
+        {
+            decayingResources.erase(resourceState.first);
+        }
     }
 
     m_FinalResourceState.clear();
 }
 
+void ResourceStateTracker::DecayResourceStates(const std::unordered_set<ID3D12Resource*>& decayingResources)
+{
+    for (ID3D12Resource* resource : decayingResources)
+    {
+        auto globalResourceState = GetGlobalResourceState(resource, false);
+        if (globalResourceState)
+        {
+            // Set in place, so the subresource states of the global state keep their memory.
+            globalResourceState->Lock();
+            globalResourceState->State.SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_STATE_COMMON);
+            globalResourceState->Unlock();
+        }
+    }
+}
+
 void ResourceStateTracker::Reset()
 {
     // Reset the pending, current, and final resource states.
     m_PendingResourceBarriers.clear();
     m_ResourceBarriers.clear();
+    m_SplitResourceBarriers.clear();
     m_FinalResourceState.clear();
 }
 
-void ResourceStateTracker::Lock()
+D3D12_RESOURCE_BARRIER* ResourceStateTracker::FindSplitResourceBarrier(ID3D12Resource* resource, UINT subResource)
+{
+    for (auto& splitBarrier : m_SplitResourceBarriers)
+    {
+        if (splitBarrier.Transition.pResource == resource
+            && (splitBarrier.Transition.Subresource == subResource
+                || splitBarrier.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+                || subResource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES))
+        {
+            return &splitBarrier;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ResourceStateTracker::SetBarrierBackend(BarrierBackend backend)
+{
+    if (backend == BarrierBackend::Enhanced)
+    {
+        D3D12_FEATURE_DATA_D3D12_OPTIONS12 options12 = {};
+        if (FAILED(Application::Get().GetDevice()->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS12,
+            &options12, sizeof(options12))) || !options12.EnhancedBarriersSupported)
+        {
+            return false;
+        }
+    }
+
+    ms_BarrierBackend = backend;
+    return true;
+}
+
+ResourceStateTracker::BarrierBackend ResourceStateTracker::GetBarrierBackend()
+{
+    return ms_BarrierBackend;
+}
+
+uint32_t ResourceStateTracker::GetNumElidedBarriersLastFrame()
+{
+    return ms_NumElidedBarriersLastFrame;
+}
+
+void ResourceStateTracker::EndFrame()
+{
+    ms_NumElidedBarriersLastFrame = ms_NumElidedBarriersThisFrame.exchange(0);
+}
+
+bool ResourceStateTracker::CanPromoteFromCommonState(D3D12_RESOURCE_STATES state, bool isStateless)
+{
+    if (state == D3D12_RESOURCE_STATE_COMMON)
+    {
+        return false;
+    }
+
+    if (isStateless)
+    {
+        return true;
+    }
+
+    // The transitions from the common state are recorded, so they start in the common layout.
+    if (ms_BarrierBackend == BarrierBackend::Enhanced)
+    {
+        return false;
+    }
+
+    constexpr D3D12_RESOURCE_STATES promotableTextureStates = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+        | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_COPY_SOURCE | D3D12_RESOURCE_STATE_COPY_DEST;
+
+    // Copy destination is a write state, it can not be combined with others.
+    return (state & ~promotableTextureStates) == 0
+        && (state == D3D12_RESOURCE_STATE_COPY_DEST || (state & D3D12_RESOURCE_STATE_COPY_DEST) == 0);
+}
+
+bool ResourceStateTracker::IsStatelessResource(ID3D12Resource* resource)
 {
-    ms_GlobalMutex.lock();
-    ms_IsLocked = true;
+    D3D12_RESOURCE_DESC desc = resource->GetDesc();
+
+    return desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER
+        || (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS) != 0;
 }
 
-void ResourceStateTracker::Unlock()
+bool ResourceStateTracker::IsReadOnlyState(D3D12_RESOURCE_STATES state)
 {
-    ms_GlobalMutex.unlock();
-    ms_IsLocked = false;
+    return state != D3D12_RESOURCE_STATE_COMMON && (state & ~ReadOnlyResourceStates) == 0;
+}
+
+void ResourceStateTracker::RecordResourceBarriers(CommandList& commandList, const ResourceBarriers& barriers)
+{
+    auto d3d12CommandList7 = commandList.GetGraphicsCommandList7();
+    if (ms_BarrierBackend == BarrierBackend::Enhanced && d3d12CommandList7)
+    {
+        for (const auto& barrier : barriers)
+        {
+            m_EnhancedBarrierBuilder.AddBarrier(barrier);
+        }
+
+        m_EnhancedBarrierBuilder.Flush(d3d12CommandList7.Get());
+    }
+    else
+    {
+        auto d3d12CommandList = commandList.GetGraphicsCommandList();
+        d3d12CommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    }
+}
+
+void ResourceStateTracker::CoalesceResourceBarriers(ResourceBarriers& barriers)
+{
+    // No commands are recorded between the barriers of a single flush, so the intermediate
+    // states of a chain of transitions are never used. A->B followed by B->C becomes A->C.
+    size_t numBarriers = 0;
+    for (size_t i = 0; i < barriers.size(); ++i)
+    {
+        const D3D12_RESOURCE_BARRIER barrier = barriers[i];
+
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE)
+        {
+            bool isMerged = false;
+
+            // Look for the last transition of the resource. UAV and aliasing barriers are
+            // not moved across, and neither are transitions of other subresources of the
+            // resource or split transitions.
+            for (size_t j = numBarriers; j-- > 0;)
+            {
+                D3D12_RESOURCE_BARRIER& previousBarrier = barriers[j];
+                if (previousBarrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+                {
+                    break;
+                }
+
+                if (previousBarrier.Transition.pResource != barrier.Transition.pResource)
+                {
+                    continue;
+                }
+
+                if (previousBarrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE
+                    && previousBarrier.Transition.Subresource == barrier.Transition.Subresource
+                    && previousBarrier.Transition.StateAfter == barrier.Transition.StateBefore)
+                {
+                    previousBarrier.Transition.StateAfter = barrier.Transition.StateAfter;
+                    isMerged = true;
+                }
+                break;
+            }
+
+            if (isMerged)
+            {
+                continue;
+            }
+        }
+
+        barriers[numBarriers++] = barrier;
+    }
+    barriers.resize(numBarriers);
+
+    // Drop the chains that end in the state they started from.
+    std::erase_if(barriers, [](const D3D12_RESOURCE_BARRIER& barrier)
+        {
+            return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE
+                && barrier.Transition.StateBefore == barrier.Transition.StateAfter;
+        });
+}
+
+D3D12_RESOURCE_STATES ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+    // The common state is 0, it is not a read state that others can be added to.
+    if (IsReadOnlyState(stateBefore) && IsReadOnlyState(stateAfter))
+    {
+        return stateBefore | stateAfter;
+    }
+
+    return stateAfter;
 }
 
 void ResourceStateTracker::AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
 {
     if (resource != nullptr)
     {
-        std::lock_guard<std::mutex> lock(ms_GlobalMutex);
-        ms_GlobalResourceState[resource].SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+        auto globalResourceState = GetGlobalResourceState(resource, true);
+
+        globalResourceState->Lock();
+        globalResourceState->State.SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+        globalResourceState->Unlock();
     }
 }
 
@@ -228,7 +698,39 @@ void ResourceStateTracker::RemoveGlobalResourceState(ID3D12Resource* resource)
 {
     if (resource != nullptr)
     {
-        std::lock_guard<std::mutex> lock(ms_GlobalMutex);
-        ms_GlobalResourceState.erase(resource);
+        ThrowIfFailed(resource->SetPrivateDataInterface(GlobalResourceStateGuid, nullptr));
     }
 }
+
+Microsoft::WRL::ComPtr<ResourceStateTracker::GlobalResourceState> ResourceStateTracker::GetGlobalResourceState(ID3D12Resource* resource, bool create)
+{
+    Microsoft::WRL::ComPtr<GlobalResourceState> globalResourceState;
+
+    // GetPrivateData adds a reference to the interface, which the COM pointer takes over.
+    IUnknown* pUnknown = nullptr;
+    UINT dataSize = sizeof(pUnknown);
+    if (SUCCEEDED(resource->GetPrivateData(GlobalResourceStateGuid, &dataSize, &pUnknown)) && pUnknown != nullptr)
+    {
+        globalResourceState.Attach(static_cast<GlobalResourceState*>(pUnknown));
+    }
+    else if (create)
+    {
+        // Only resources that are used before their state is known get here, so the mutex
+        // is rarely taken. It keeps two threads from attaching a state to the same resource.
+        static std::mutex createMutex;
+        std::lock_guard<std::mutex> lock(createMutex);
+
+        dataSize = sizeof(pUnknown);
+        if (SUCCEEDED(resource->GetPrivateData(GlobalResourceStateGuid, &dataSize, &pUnknown)) && pUnknown != nullptr)
+        {
+            globalResourceState.Attach(static_cast<GlobalResourceState*>(pUnknown));
+        }
+        else
+        {
+            globalResourceState.Attach(new GlobalResourceState(D3D12_RESOURCE_STATE_COMMON));
+            ThrowIfFailed(resource->SetPrivateDataInterface(GlobalResourceStateGuid, globalResourceState.Get()));
+        }
+    }
+
+    return globalResourceState;
+}
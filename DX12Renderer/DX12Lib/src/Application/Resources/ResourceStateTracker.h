@@ -49,11 +49,15 @@
 
   // File includes
 #include "Includes/DirectXIncludes.h"
+#include "EnhancedBarrierBuilder.h"
 
 // Standard library includes
-#include <mutex>
-#include <map>
+#include <wrl.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace DDM
@@ -64,7 +68,21 @@ namespace DDM
     class ResourceStateTracker
     {
     public:
-        ResourceStateTracker();
+        // How barriers are recorded to the command list.
+        enum class BarrierBackend
+        {
+            // ID3D12GraphicsCommandList::ResourceBarrier with D3D12_RESOURCE_BARRIER.
+            Legacy,
+            // ID3D12GraphicsCommandList7::Barrier, with the tracked states mapped
+            // onto layout, sync and access scopes.
+            Enhanced
+        };
+
+        /**
+         * @param commandListType The type of the command list that the barriers are recorded to.
+         * The implicit state promotion and decay rules depend on the type of queue.
+         */
+        explicit ResourceStateTracker(D3D12_COMMAND_LIST_TYPE commandListType = D3D12_COMMAND_LIST_TYPE_DIRECT);
         virtual ~ResourceStateTracker();
 
         /**
@@ -85,6 +103,33 @@ namespace DDM
         void TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
         void TransitionResource(const Resource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
 
+        /**
+         * Begin a split transition of a resource. The GPU can perform the transition while
+         * the commands that are recorded until EndTransitionResource run.
+         * The resource may not be used or transitioned until the transition is ended.
+         *
+         * Only resources with a known state in the command list can be split. For others
+         * this does nothing, and EndTransitionResource transitions the resource as usual.
+         */
+        void BeginTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+        /**
+         * End a split transition that was begun with BeginTransitionResource, or transition
+         * the resource if no split transition was begun.
+         */
+        void EndTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+        /**
+         * Prepare a resource to be used by a queue of another type after this command list.
+         * Compute and copy queues can not transition resources out of graphics states, so
+         * if the resource is left in a state the destination queue does not support, it is
+         * transitioned to the common state, which every queue supports.
+         * The destination queue still has to wait for the fence value of this command list.
+         *
+         * @param destinationType The type of the queue that uses the resource next.
+         */
+        void HandoffResource(ID3D12Resource* resource, D3D12_COMMAND_LIST_TYPE destinationType);
+
         /**
          * Push a UAV resource barrier for the given resource.
          *
@@ -114,14 +159,31 @@ namespace DDM
         /**
          * Flush any (non-pending) resource barriers that have been pushed to the resource state
          * tracker.
+         * Chains of transitions of the same (sub)resource are collapsed into a single
+         * transition first, and transitions that end in the state they started from are dropped.
          */
         void FlushResourceBarriers(CommandList& commandList);
 
         /**
-         * Commit final resource states to the global resource state map.
+         * Commit final resource states to the global state of the resources.
          * This must be called when the command list is closed.
+         *
+         * The runtime does not decay resources between the command lists of one
+         * ExecuteCommandLists call, so the states are committed as they are, and the
+         * command lists that follow in the same call resolve their pending barriers
+         * against them.
+         *
+         * @param decayingResources The resources that decay to the common state once the
+         * call has executed. Resources this command list leaves in a state that does not
+         * decay are removed from it, so a later command list overrides an earlier one.
+         */
+        void CommitFinalResourceStates(std::unordered_set<ID3D12Resource*>& decayingResources);
+
+        /**
+         * Decay the global states of the resources to the common state. Called after the
+         * ExecuteCommandLists call of which the command lists committed the resources.
          */
-        void CommitFinalResourceStates();
+        static void DecayResourceStates(const std::unordered_set<ID3D12Resource*>& decayingResources);
 
         /**
          * Reset state tracking. This must be done when the command list is reset.
@@ -129,37 +191,76 @@ namespace DDM
         void Reset();
 
         /**
-         * The global state must be locked before flushing pending resource barriers
-         * and committing the final resource state to the global resource state.
-         * This ensures consistency of the global resource state between command list
-         * executions.
+         * Set the global state of a resource.
+         * This should be done when the resource is created for the first time.
+         *
+         * The global state is attached to the ID3D12Resource itself, so there is no global
+         * lock: command lists only synchronize on the resources they use. Resolving the pending
+         * barriers and committing the final states of the command lists that are executed
+         * on the same queue has to happen in submission order, which the command queue
+         * guarantees.
          */
-        static void Lock();
+        static void AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
 
         /**
-         * Unlocks the global resource state after the final states have been committed
-         * to the global resource state array.
+         * Detach the global state from a resource.
+         * The global state is released together with the resource, so this is only needed
+         * if the resource keeps being used by something that does not track its state.
          */
-        static void Unlock();
+        static void RemoveGlobalResourceState(ID3D12Resource* resource);
 
         /**
-         * Add a resource with a given state to the global resource state array (map).
-         * This should be done when the resource is created for the first time.
+         * Select how barriers are recorded by all command lists. The enhanced backend is
+         * only selected if the device supports enhanced barriers. Command lists that
+         * do not support ID3D12GraphicsCommandList7 keep using legacy barriers.
+         * Has to be called while no command lists are being recorded.
+         *
+         * @return true if the backend was selected.
          */
-        static void AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+        static bool SetBarrierBackend(BarrierBackend backend);
+
+        static BarrierBackend GetBarrierBackend();
 
         /**
-         * Remove a resource from the global resource state array (map).
-         * This should only be done when the resource is destroyed.
+         * Get the number of transitions that were not recorded during the last frame,
+         * because the runtime performs them through implicit state promotion.
          */
-        static void RemoveGlobalResourceState(ID3D12Resource* resource);
+        static uint32_t GetNumElidedBarriersLastFrame();
 
-    protected:
+        // Called once per frame by the application to update the elided barrier counter.
+        static void EndFrame();
+
+        /**
+         * Check if the runtime implicitly promotes a resource from the common state to the state
+         * when it is first accessed.
+         *
+         * @param isStateless The resource is a buffer, or a texture that allows simultaneous access.
+         * Those can be promoted to any state, other textures only to shader resource and copy states.
+         * With the enhanced barrier backend other textures are never promoted, a texture that is used
+         * without a barrier stays in the common layout, which the tracked state would not reflect.
+         */
+        static bool CanPromoteFromCommonState(D3D12_RESOURCE_STATES state, bool isStateless);
+
+        // Check if command lists of the type can transition a resource from or to the state.
+        static bool IsStateSupported(D3D12_RESOURCE_STATES state, D3D12_COMMAND_LIST_TYPE commandListType);
 
-    private:
         // An array (vector) of resource barriers.
         using ResourceBarriers = std::vector<D3D12_RESOURCE_BARRIER>;
 
+        // Check if a state only consists of read states.
+        static bool IsReadOnlyState(D3D12_RESOURCE_STATES state);
+
+        // Collapse the transitions of the barriers that follow each other.
+        static void CoalesceResourceBarriers(ResourceBarriers& barriers);
+
+        // Get the state to transition to, to use a (sub)resource that is in stateBefore in stateAfter.
+        // Resources that are only read from can be in multiple read states at once, so read
+        // states are added to each other. This avoids transitions between read states.
+        static D3D12_RESOURCE_STATES CombineReadStates(D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+
+    protected:
+
+    private:
         // Pending resource transitions are committed before a command list
         // is executed on the command queue. This guarantees that resources will
         // be in the expected state at the beginning of a command list.
@@ -168,6 +269,160 @@ namespace DDM
         // Resource barriers that need to be committed to the command list.
         ResourceBarriers m_ResourceBarriers;
 
+        // The END_ONLY halves of the split transitions that have been begun.
+        ResourceBarriers m_SplitResourceBarriers;
+
+        // Get the split transition of the resource that has been begun, or nullptr.
+        D3D12_RESOURCE_BARRIER* FindSplitResourceBarrier(ID3D12Resource* resource, UINT subResource);
+
+        // Record the barriers to the command list with the selected backend.
+        void RecordResourceBarriers(CommandList& commandList, const ResourceBarriers& barriers);
+
+        // The enhanced barriers that the barriers are translated into before they are recorded.
+        EnhancedBarrierBuilder m_EnhancedBarrierBuilder;
+
+        static std::atomic<BarrierBackend> ms_BarrierBackend;
+
+        static std::atomic<uint32_t> ms_NumElidedBarriersThisFrame;
+        static std::atomic<uint32_t> ms_NumElidedBarriersLastFrame;
+
+        D3D12_COMMAND_LIST_TYPE m_CommandListType;
+
+        // Check if the resource is a buffer, or a texture that allows simultaneous access.
+        // Those are promoted to any state, and decay to the common state after every execution.
+        static bool IsStatelessResource(ID3D12Resource* resource);
+
+        // The states of the subresources that were transitioned on their own.
+        // The first few are stored inline, which covers buffers and textures that only
+        // have a couple of mips transitioned. Once that is not enough, the states are
+        // stored in an array that is indexed by subresource. The array keeps its memory
+        // when it is cleared, so copying into a state that already has the room does
+        // not allocate.
+        class SubresourceStates
+        {
+        public:
+            // Call func(subresource, state) for every subresource that has a state.
+            template<typename Function>
+            void ForEach(Function&& func) const
+            {
+                if (m_IsDense)
+                {
+                    for (UINT subresource = 0; subresource < static_cast<UINT>(m_DenseStates.size()); ++subresource)
+                    {
+                        if (m_DenseStates[subresource] != UnknownState)
+                        {
+                            func(subresource, m_DenseStates[subresource]);
+                        }
+                    }
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < m_NumInlineStates; ++i)
+                    {
+                        func(m_InlineStates[i].Subresource, m_InlineStates[i].State);
+                    }
+                }
+            }
+
+            // Get the state of the subresource, or nullptr if it has none.
+            const D3D12_RESOURCE_STATES* Find(UINT subresource) const
+            {
+                if (m_IsDense)
+                {
+                    if (subresource < m_DenseStates.size() && m_DenseStates[subresource] != UnknownState)
+                    {
+                        return &m_DenseStates[subresource];
+                    }
+                    return nullptr;
+                }
+
+                for (uint32_t i = 0; i < m_NumInlineStates; ++i)
+                {
+                    if (m_InlineStates[i].Subresource == subresource)
+                    {
+                        return &m_InlineStates[i].State;
+                    }
+                }
+                return nullptr;
+            }
+
+            void Set(UINT subresource, D3D12_RESOURCE_STATES state)
+            {
+                if (!m_IsDense)
+                {
+                    for (uint32_t i = 0; i < m_NumInlineStates; ++i)
+                    {
+                        if (m_InlineStates[i].Subresource == subresource)
+                        {
+                            m_InlineStates[i].State = state;
+                            return;
+                        }
+                    }
+
+                    if (m_NumInlineStates < NumInlineStates)
+                    {
+                        m_InlineStates[m_NumInlineStates++] = { subresource, state };
+                        return;
+                    }
+
+                    MakeDense();
+                }
+
+                if (subresource >= m_DenseStates.size())
+                {
+                    m_DenseStates.resize(subresource + 1, UnknownState);
+                }
+                m_DenseStates[subresource] = state;
+            }
+
+            bool IsEmpty() const
+            {
+                return m_IsDense ? m_DenseStates.empty() : m_NumInlineStates == 0;
+            }
+
+            // Remove all states, but keep the memory of the array.
+            void Clear()
+            {
+                m_NumInlineStates = 0;
+                m_DenseStates.clear();
+                m_IsDense = false;
+            }
+
+        private:
+            static constexpr uint32_t NumInlineStates = 4;
+            // Marks the subresources in the array that have no state of their own.
+            static constexpr D3D12_RESOURCE_STATES UnknownState = static_cast<D3D12_RESOURCE_STATES>(0xFFFFFFFF);
+
+            struct InlineState
+            {
+                UINT Subresource;
+                D3D12_RESOURCE_STATES State;
+            };
+
+            void MakeDense()
+            {
+                UINT numSubresources = 0;
+                for (uint32_t i = 0; i < m_NumInlineStates; ++i)
+                {
+                    numSubresources = std::max(numSubresources, m_InlineStates[i].Subresource + 1);
+                }
+
+                m_DenseStates.assign(numSubresources, UnknownState);
+                for (uint32_t i = 0; i < m_NumInlineStates; ++i)
+                {
+                    m_DenseStates[m_InlineStates[i].Subresource] = m_InlineStates[i].State;
+                }
+
+                m_NumInlineStates = 0;
+                m_IsDense = true;
+            }
+
+            InlineState m_InlineStates[NumInlineStates] = {};
+            uint32_t m_NumInlineStates = 0;
+            bool m_IsDense = false;
+            std::vector<D3D12_RESOURCE_STATES> m_DenseStates;
+        };
+
         // Tracks the state of a particular resource and all of its subresources.
         struct ResourceState
         {
@@ -182,33 +437,38 @@ namespace DDM
                 if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
                 {
                     State = state;
-                    SubresourceState.clear();
+                    SubresourceState.Clear();
                 }
                 else
                 {
-                    SubresourceState[subresource] = state;
+                    SubresourceState.Set(subresource, state);
                 }
             }
 
             // Get the state of a (sub)resource within the resource.
-            // If the specified subresource is not found in the SubresourceState array (map)
-            // then the state of the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is
-            // returned.
+            // If the specified subresource has no state of its own, then the state of
+            // the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is returned.
             D3D12_RESOURCE_STATES GetSubresourceState(UINT subresource) const
             {
-                D3D12_RESOURCE_STATES state = State;
-                const auto iter = SubresourceState.find(subresource);
-                if (iter != SubresourceState.end())
-                {
-                    state = iter->second;
-                }
-                return state;
+                const D3D12_RESOURCE_STATES* subresourceState = SubresourceState.Find(subresource);
+                return subresourceState != nullptr ? *subresourceState : State;
             }
 
-            // If the SubresourceState array (map) is empty, then the State variable defines 
+            // If SubresourceState is empty, then the State variable defines 
             // the state of all of the subresources.
             D3D12_RESOURCE_STATES State;
-            std::map<UINT, D3D12_RESOURCE_STATES> SubresourceState;
+            SubresourceStates SubresourceState;
+
+            // The resource is a buffer, or a texture that allows simultaneous access.
+            bool IsStateless = false;
+
+            // The state was reached by implicit promotion from the common state in the command list.
+            // Resources that are promoted to read states decay to the common state after execution.
+            bool IsPromoted = false;
+
+            // The state is the one the pending barrier transitions to. If the runtime promotes the
+            // resource instead is only known once the pending barriers are resolved.
+            bool IsPendingState = false;
         };
 
         using ResourceStateMap = std::unordered_map<ID3D12Resource*, ResourceState>;
@@ -218,13 +478,17 @@ namespace DDM
         // command list is closed but before it is executed on the command queue.
         ResourceStateMap m_FinalResourceState;
 
-        // The global resource state array (map) stores the state of a resource
-        // between command list execution.
-        static ResourceStateMap ms_GlobalResourceState;
+        // The state of a resource between command list executions. It is stored as
+        // private data of the ID3D12Resource, and guarded by a lock of its own.
+        class GlobalResourceState;
 
-        // The mutex protects shared access to the GlobalResourceState map.
-        static std::mutex ms_GlobalMutex;
-        static bool ms_IsLocked;
+        /**
+         * Get the global state that is attached to the resource.
+         *
+         * @param create Attach a new global state in the common state if the resource has none.
+         * @return The global state, or nullptr if the resource has none and create is false.
+         */
+        static Microsoft::WRL::ComPtr<GlobalResourceState> GetGlobalResourceState(ID3D12Resource* resource, bool create);
     };
 }
 #endif // !_RESOURCE_STATE_TRACKER_
\ No newline at end of file
@@ -0,0 +1,79 @@
+// UploadBatchScheduler.cpp
+
+// Header include
+#include "UploadBatchScheduler.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::UploadBatchScheduler::UploadBatchScheduler(uint64_t maxBatchSize, uint32_t maxBatchUploads)
+    : m_ReleasedFenceValue(0)
+    , m_OpenBatchIndex(0)
+    , m_OpenBatchSize(0)
+    , m_NumOpenBatchUploads(0)
+    , m_MaxBatchSize(maxBatchSize)
+    , m_MaxBatchUploads(maxBatchUploads)
+{
+    assert(m_MaxBatchSize > 0 && m_MaxBatchUploads > 0);
+}
+
+DDM::UploadBatchScheduler::~UploadBatchScheduler()
+{
+}
+
+bool DDM::UploadBatchScheduler::MustSubmitBefore(uint64_t sizeInBytes) const
+{
+    return HasOpenBatch() && m_OpenBatchSize + sizeInBytes > m_MaxBatchSize;
+}
+
+uint64_t DDM::UploadBatchScheduler::AddUpload(uint64_t sizeInBytes)
+{
+    m_OpenBatchSize += sizeInBytes;
+    ++m_NumOpenBatchUploads;
+
+    return m_OpenBatchIndex;
+}
+
+bool DDM::UploadBatchScheduler::IsBatchFull() const
+{
+    return m_OpenBatchSize >= m_MaxBatchSize || m_NumOpenBatchUploads >= m_MaxBatchUploads;
+}
+
+uint64_t DDM::UploadBatchScheduler::SubmitBatch(uint64_t fenceValue)
+{
+    assert((m_SubmittedBatches.empty() || m_SubmittedBatches.back().FenceValue <= fenceValue)
+        && "Batches have to be submitted in order.");
+
+    m_SubmittedBatches.push_back({ m_OpenBatchIndex, fenceValue });
+
+    m_OpenBatchSize = 0;
+    m_NumOpenBatchUploads = 0;
+
+    return m_OpenBatchIndex++;
+}
+
+uint64_t DDM::UploadBatchScheduler::GetFenceValue(uint64_t batchIndex) const
+{
+    if (batchIndex == InvalidBatchIndex || !IsSubmitted(batchIndex))
+    {
+        return 0;
+    }
+
+    // The batch has been released, its fence value has completed.
+    if (m_SubmittedBatches.empty() || batchIndex < m_SubmittedBatches.front().BatchIndex)
+    {
+        return m_ReleasedFenceValue;
+    }
+
+    // Every submitted batch has an entry, so the entries are indexed by their batch index.
+    return m_SubmittedBatches[batchIndex - m_SubmittedBatches.front().BatchIndex].FenceValue;
+}
+
+void DDM::UploadBatchScheduler::ReleaseCompletedBatches(uint64_t completedFenceValue)
+{
+    while (!m_SubmittedBatches.empty() && m_SubmittedBatches.front().FenceValue <= completedFenceValue)
+    {
+        m_ReleasedFenceValue = m_SubmittedBatches.front().FenceValue;
+        m_SubmittedBatches.pop_front();
+    }
+}
@@ -0,0 +1,113 @@
+// UploadBatchScheduler.h
+
+/**
+ * Groups uploads into batches that are submitted to the copy queue together.
+ *
+ * Uploads are added to the open batch until it holds the maximum number of bytes or
+ * uploads, then the batch is submitted and a new one is opened. Every upload gets the
+ * index of its batch, which is mapped to the fence value of the submission once the
+ * batch has been submitted. Batches are submitted in order, so their fence values
+ * increase with their index.
+ *
+ * This class does not depend on a D3D12 device, the fence values are passed in by the caller.
+ */
+
+#ifndef _UPLOAD_BATCH_SCHEDULER_
+#define _UPLOAD_BATCH_SCHEDULER_
+
+// Standard library includes
+#include <cstdint>
+#include <deque>
+
+namespace DDM
+{
+	class UploadBatchScheduler final
+	{
+	public:
+		// The default limits of a batch.
+		static constexpr uint64_t DefaultMaxBatchSize = 32ull * 1024 * 1024;
+		static constexpr uint32_t DefaultMaxBatchUploads = 256;
+
+		// The batch index of nothing to upload. It counts as submitted, with a fence value that has completed.
+		static constexpr uint64_t InvalidBatchIndex = UINT64_MAX;
+
+		/**
+		 * @param maxBatchSize The number of bytes after which a batch is submitted.
+		 * @param maxBatchUploads The number of uploads after which a batch is submitted.
+		 */
+		explicit UploadBatchScheduler(uint64_t maxBatchSize = DefaultMaxBatchSize, uint32_t maxBatchUploads = DefaultMaxBatchUploads);
+
+		~UploadBatchScheduler();
+
+		UploadBatchScheduler(UploadBatchScheduler& other) = delete;
+		UploadBatchScheduler(UploadBatchScheduler&& other) = delete;
+
+		UploadBatchScheduler& operator=(UploadBatchScheduler& other) = delete;
+		UploadBatchScheduler& operator=(UploadBatchScheduler&& other) = delete;
+
+		/**
+		 * Check if the open batch has to be submitted before an upload of the size is added,
+		 * because the upload does not fit in it. An upload that is larger than the maximum
+		 * batch size gets a batch of its own.
+		 */
+		bool MustSubmitBefore(uint64_t sizeInBytes) const;
+
+		/**
+		 * Add an upload to the open batch.
+		 *
+		 * @return The index of the batch of the upload.
+		 */
+		uint64_t AddUpload(uint64_t sizeInBytes);
+
+		// Check if the open batch has reached one of its limits and should be submitted.
+		bool IsBatchFull() const;
+
+		// Check to see if uploads have been added to the open batch.
+		bool HasOpenBatch() const { return m_NumOpenBatchUploads > 0; }
+
+		/**
+		 * Close the open batch, it is submitted with the fence value.
+		 *
+		 * @return The index of the batch.
+		 */
+		uint64_t SubmitBatch(uint64_t fenceValue);
+
+		// Check if a batch has been submitted.
+		bool IsSubmitted(uint64_t batchIndex) const { return batchIndex == InvalidBatchIndex || batchIndex < m_OpenBatchIndex; }
+
+		/**
+		 * Get the fence value a batch was submitted with.
+		 * Returns 0 if the batch has not been submitted yet, or if it is the invalid batch.
+		 */
+		uint64_t GetFenceValue(uint64_t batchIndex) const;
+
+		// Forget the batches of which the fence value has completed.
+		void ReleaseCompletedBatches(uint64_t completedFenceValue);
+
+		uint64_t GetOpenBatchIndex() const { return m_OpenBatchIndex; }
+		uint64_t GetOpenBatchSize() const { return m_OpenBatchSize; }
+		uint32_t GetNumOpenBatchUploads() const { return m_NumOpenBatchUploads; }
+
+	private:
+		struct SubmittedBatch
+		{
+			uint64_t BatchIndex;
+			uint64_t FenceValue;
+		};
+
+		// Batches that were submitted and have not completed, in submission order.
+		std::deque<SubmittedBatch> m_SubmittedBatches;
+
+		// The highest fence value of the batches that were released.
+		uint64_t m_ReleasedFenceValue;
+
+		uint64_t m_OpenBatchIndex;
+		uint64_t m_OpenBatchSize;
+		uint32_t m_NumOpenBatchUploads;
+
+		uint64_t m_MaxBatchSize;
+		uint32_t m_MaxBatchUploads;
+	};
+}
+
+#endif // !_UPLOAD_BATCH_SCHEDULER_
@@ -14,88 +14,68 @@
 #include <math.h>
 
 
-UploadBuffer::UploadBuffer(size_t pageSize)
-	:m_PageSize(pageSize)
+UploadBuffer::UploadBuffer(size_t pageSize, std::shared_ptr<DDM::UploadRingBuffer> uploadRing)
+	:m_UploadRing(uploadRing),
+	m_PageSize(pageSize)
 {
+    if (!m_UploadRing)
+    {
+        m_UploadRing = std::make_shared<DDM::UploadRingBuffer>(nullptr);
+    }
+}
+
+UploadBuffer::~UploadBuffer()
+{
+    Reset();
 }
 
 UploadBuffer::Allocation UploadBuffer::Allocate(size_t sizeInBytes, size_t alignment)
 {
     if (sizeInBytes > m_PageSize)
     {
-        throw std::bad_alloc();
+        // The start of a dedicated heap satisfies any alignment a page could.
+        m_DedicatedPages.emplace_back(m_UploadRing->AllocateDedicated(sizeInBytes));
+
+        return m_DedicatedPages.back().Allocate(sizeInBytes, alignment);
     }
 
     // If there is no current page, or the requested allocation exceeds the
-    // remaining space in the current page, request a new page.
-    if (!m_CurrentPage || !m_CurrentPage->HasSpace(sizeInBytes, alignment))
+    // remaining space in the current page, lease a new page from the ring.
+    if (m_Pages.empty() || !m_Pages.back().HasSpace(sizeInBytes, alignment))
     {
-        m_CurrentPage = RequestPage();
+        m_Pages.emplace_back(m_UploadRing->Allocate(m_PageSize));
     }
 
-    return m_CurrentPage->Allocate(sizeInBytes, alignment);
+    return m_Pages.back().Allocate(sizeInBytes, alignment);
 }
 
-void UploadBuffer::Reset()
+void UploadBuffer::Retire(uint64_t fenceValue)
 {
-    m_CurrentPage = nullptr;
-    // Reset all available pages.
-    m_AvailablePages = m_PagePool;
-
-    for (auto page : m_AvailablePages)
+    for (const auto& page : m_Pages)
     {
-        // Reset the page for new allocations.
-        page->Reset();
+        m_UploadRing->Retire(page.GetBlock(), fenceValue);
     }
-}
 
-std::shared_ptr<UploadBuffer::Page> UploadBuffer::RequestPage()
-{
-	std::shared_ptr<Page> page;
+    m_Pages.clear();
 
-    if (!m_AvailablePages.empty())
-    {
-        page = m_AvailablePages.front();
-        m_AvailablePages.pop_front();
-    }
-    else
+    for (const auto& page : m_DedicatedPages)
     {
-        page = std::make_shared<Page>(m_PageSize);
-        m_PagePool.push_back(page);
+        m_UploadRing->Retire(page.GetBlock(), fenceValue);
     }
 
-    return page;
+    m_DedicatedPages.clear();
 }
 
-UploadBuffer::Page::Page(size_t sizeInBytes)
-    : m_PageSize(sizeInBytes)
-    , m_Offset(0)
-    , m_CPUPtr(nullptr)
-    , m_GPUPtr(D3D12_GPU_VIRTUAL_ADDRESS(0))
+void UploadBuffer::Reset()
 {
-    auto device = DDM::Application::Get().GetDevice();
-
-    auto properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    auto desc = CD3DX12_RESOURCE_DESC::Buffer(m_PageSize);
-
-    ThrowIfFailed(device->CreateCommittedResource(
-        &properties,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_d3d12Resource)
-    ));
-
-    m_GPUPtr = m_d3d12Resource->GetGPUVirtualAddress();
-    m_d3d12Resource->Map(0, nullptr, &m_CPUPtr);
+    // Fence value 0 has always completed, the pages can be reused straight away.
+    Retire(0);
 }
 
-UploadBuffer::Page::~Page()
+UploadBuffer::Page::Page(const DDM::UploadRingBuffer::Block& block)
+    : m_Block(block)
+    , m_Offset(0)
 {
-    m_d3d12Resource->Unmap(0, nullptr);
-    m_CPUPtr = nullptr;
-    m_GPUPtr = D3D12_GPU_VIRTUAL_ADDRESS(0);
 }
 
 bool UploadBuffer::Page::HasSpace(size_t sizeInBytes, size_t alignment) const
@@ -103,7 +83,7 @@ bool UploadBuffer::Page::HasSpace(size_t sizeInBytes, size_t alignment) const
     size_t alignedSize =  Math::AlignUp(sizeInBytes, alignment);
     size_t alignedOffset = Math::AlignUp(m_Offset, alignment);
 
-    return alignedOffset + alignedSize <= m_PageSize;
+    return alignedOffset + alignedSize <= m_Block.Size;
 }
 
 UploadBuffer::Allocation UploadBuffer::Page::Allocate(size_t sizeInBytes, size_t alignment)
@@ -118,15 +98,12 @@ UploadBuffer::Allocation UploadBuffer::Page::Allocate(size_t sizeInBytes, size_t
     m_Offset = Math::AlignUp(m_Offset, alignment);
 
     Allocation allocation;
-    allocation.CPU = static_cast<uint8_t*>(m_CPUPtr) + m_Offset;
-    allocation.GPU = m_GPUPtr + m_Offset;
+    allocation.CPU = static_cast<uint8_t*>(m_Block.CPU) + m_Offset;
+    allocation.GPU = m_Block.GPU + m_Offset;
+    allocation.Resource = m_Block.Resource;
+    allocation.Offset = static_cast<size_t>(m_Block.Offset) + m_Offset;
 
     m_Offset += alignedSize;
 
     return allocation;
 }
-
-void UploadBuffer::Page::Reset()
-{
-    m_Offset = 0;
-}
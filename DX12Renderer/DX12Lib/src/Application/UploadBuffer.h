@@ -28,12 +28,13 @@
 #define UPLOAD_BUFFER
 
 #include "Helpers/Defines.h"
+#include "Application/UploadRingBuffer.h"
 
 #include <wrl.h>
 #include <d3d12.h>
 
 #include <memory>
-#include <deque>
+#include <vector>
 
 class UploadBuffer final
 {
@@ -43,27 +44,43 @@ public:
 	{
 		void* CPU;
 		D3D12_GPU_VIRTUAL_ADDRESS GPU;
+
+		// The upload heap and the offset of the allocation within it, to copy from.
+		ID3D12Resource* Resource;
+		size_t Offset;
 	};
 
 	/*
-	* @param pageSize The size to use to allocate new pages in GPU memory
+	* @param pageSize The size of the pages that are leased from the upload ring
+	* @param uploadRing The upload ring that is shared with the other command lists
+	* of the command queue. If nullptr, the upload buffer creates a ring of its own.
 	*/
-	explicit UploadBuffer(size_t pageSize = _2MB);
+	explicit UploadBuffer(size_t pageSize = _2MB, std::shared_ptr<DDM::UploadRingBuffer> uploadRing = nullptr);
+
+	~UploadBuffer();
 
 	/*
-	* The maximum size of an allocatoin is the size of a single page
+	* Allocations up to this size are made from pages, larger allocations
+	* get a dedicated upload heap
 	*/
 	size_t GetPageSize() const { return m_PageSize; }
 
 	/**
 	* Allocate memory in an Upload heap.
-	* An allocation must not exceed the size of a page.
-	* Use a memcpy or similar method to copy the
-	* buffer data to CPU pointer in the Allocation structure returned from
-	* this function.
+	* An allocation that exceeds the size of a page is served from a dedicated
+	* upload heap, taken from a size-bucketed pool of the upload ring.
+	* Use DDM::WriteCombined::Copy to copy the buffer data to the CPU pointer
+	* in the Allocation structure returned from this function, the upload heap
+	* is write-combined memory.
 	*/
 	Allocation Allocate(size_t sizeInBytes, size_t alignment);
 
+	/**
+	* Return all leased pages to the upload ring. The pages are reused once the
+	* command queue fence reaches the fence value of the submission that used them.
+	*/
+	void Retire(uint64_t fenceValue);
+
 	/**
 	* Release all allocated pages. This should only be done when the command list
 	* is finished executing on the CommandQueue.
@@ -71,12 +88,10 @@ public:
 	void Reset();
 
 private:
-	// A single page fo the allocator
+	// A single page leased from the upload ring
 	struct Page
 	{
-		Page(size_t sizeInBytes);
-
-		~Page();
+		explicit Page(const DDM::UploadRingBuffer::Block& block);
 
 		// Check to see if the page has room to satisfy the requested allocation
 		bool HasSpace(size_t sizeInBytes, size_t alignment) const;
@@ -87,33 +102,22 @@ private:
 		// remaining space in the page.
 		Allocation Allocate(size_t sizeInBytes, size_t alignment);
 
-		// Reset the page for reuse.
-		void Reset();
+		// The block of the upload ring that backs this page.
+		const DDM::UploadRingBuffer::Block& GetBlock() const { return m_Block; }
 
 	private:
-		Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
+		DDM::UploadRingBuffer::Block m_Block;
 
-		// Base pointer.
-		void* m_CPUPtr;
-		D3D12_GPU_VIRTUAL_ADDRESS m_GPUPtr;
-
-		// Allocated page size.
-		size_t m_PageSize;
 		// Current allocation offset in bytes.
 		size_t m_Offset;
 	};
 
-	// A pool of memory pages.
-	using PagePool = std::deque< std::shared_ptr<Page> >;
-
-	// Request a page from the pool of available pages
-	// or create a new page if there are no available pages.
-	std::shared_ptr<Page> RequestPage();
+	// The pages that were leased since the last retire. The last page is the current page.
+	std::vector<Page> m_Pages;
+	// The dedicated heaps of oversized allocations that were leased since the last retire.
+	std::vector<Page> m_DedicatedPages;
 
-	PagePool m_PagePool;
-	PagePool m_AvailablePages;
-	
-	std::shared_ptr<Page> m_CurrentPage;
+	std::shared_ptr<DDM::UploadRingBuffer> m_UploadRing;
 
 	// The size of each page of memory.
 	size_t m_PageSize;
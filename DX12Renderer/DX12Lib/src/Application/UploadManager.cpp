@@ -0,0 +1,139 @@
+// UploadManager.cpp
+
+// Header include
+#include "UploadManager.h"
+
+// File includes
+#include "CommandList.h"
+#include "CommandQueue.h"
+#include "Buffers/IndexBuffer.h"
+#include "Buffers/VertexBuffer.h"
+
+// Standard library includes
+#include <cassert>
+
+DDM::UploadManager::UploadManager(CommandQueue* copyQueue, uint64_t maxBatchSize, uint32_t maxBatchUploads)
+    : m_pCopyQueue(copyQueue)
+    , m_Scheduler(maxBatchSize, maxBatchUploads)
+{
+    assert(m_pCopyQueue && "The upload manager needs a copy queue.");
+}
+
+DDM::UploadManager::~UploadManager()
+{
+    Submit();
+}
+
+DDM::UploadManager::Ticket DDM::UploadManager::CopyBuffer(Buffer& buffer, size_t numElements, size_t elementSize,
+    const void* bufferData, D3D12_RESOURCE_FLAGS flags)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    size_t bufferSize = numElements * elementSize;
+
+    // A large upload gets a batch of its own instead of delaying the batch that is being filled.
+    if (m_Scheduler.MustSubmitBefore(bufferSize))
+    {
+        SubmitBatch();
+    }
+
+    if (!m_pCommandList)
+    {
+        m_pCommandList = m_pCopyQueue->GetCommandList();
+    }
+
+    m_pCommandList->CopyBuffer(buffer, numElements, elementSize, bufferData, flags);
+
+    Ticket ticket = { m_Scheduler.AddUpload(bufferSize) };
+
+    if (m_Scheduler.IsBatchFull())
+    {
+        SubmitBatch();
+    }
+
+    return ticket;
+}
+
+DDM::UploadManager::Ticket DDM::UploadManager::CopyVertexBuffer(VertexBuffer& vertexBuffer, size_t numVertices,
+    size_t vertexStride, const void* vertexBufferData)
+{
+    return CopyBuffer(vertexBuffer, numVertices, vertexStride, vertexBufferData);
+}
+
+DDM::UploadManager::Ticket DDM::UploadManager::CopyIndexBuffer(IndexBuffer& indexBuffer, size_t numIndicies,
+    DXGI_FORMAT indexFormat, const void* indexBufferData)
+{
+    size_t indexSizeInBytes = indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+    return CopyBuffer(indexBuffer, numIndicies, indexSizeInBytes, indexBufferData);
+}
+
+void DDM::UploadManager::Submit()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    SubmitBatch();
+}
+
+bool DDM::UploadManager::IsComplete(const Ticket& ticket)
+{
+    if (!ticket.IsValid())
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (!m_Scheduler.IsSubmitted(ticket.BatchIndex))
+    {
+        return false;
+    }
+
+    return m_pCopyQueue->IsFenceComplete(m_Scheduler.GetFenceValue(ticket.BatchIndex));
+}
+
+void DDM::UploadManager::Wait(CommandQueue& queue, const Ticket& ticket)
+{
+    if (!ticket.IsValid())
+    {
+        return;
+    }
+
+    queue.Wait(*m_pCopyQueue, GetFenceValue(ticket));
+}
+
+void DDM::UploadManager::WaitOnCPU(const Ticket& ticket)
+{
+    if (!ticket.IsValid())
+    {
+        return;
+    }
+
+    m_pCopyQueue->WaitForFenceValue(GetFenceValue(ticket));
+}
+
+void DDM::UploadManager::SubmitBatch()
+{
+    if (!m_pCommandList)
+    {
+        return;
+    }
+
+    uint64_t fenceValue = m_pCopyQueue->ExecuteCommandList(m_pCommandList);
+    m_pCommandList.reset();
+
+    m_Scheduler.SubmitBatch(fenceValue);
+    m_Scheduler.ReleaseCompletedBatches(m_pCopyQueue->GetCompletedFenceValue());
+}
+
+uint64_t DDM::UploadManager::GetFenceValue(const Ticket& ticket)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Waiting on the open batch submits it, otherwise the wait would never end.
+    if (!m_Scheduler.IsSubmitted(ticket.BatchIndex))
+    {
+        SubmitBatch();
+    }
+
+    return m_Scheduler.GetFenceValue(ticket.BatchIndex);
+}
@@ -0,0 +1,124 @@
+// UploadManager.h
+
+/**
+ * Uploads buffers on the copy queue, so loading assets overlaps rendering.
+ *
+ * The data is staged in the upload ring of the copy queue and the copies are recorded to
+ * a command list that is shared by many uploads. The list is submitted as a batch once it
+ * holds enough data or uploads, when a ticket of the batch is waited on, or when Submit
+ * is called, which the application does at the end of every frame.
+ *
+ * Every upload returns a ticket. Queues that use the buffer wait on the ticket on the GPU,
+ * the CPU only waits if it has to read the results.
+ */
+
+#ifndef _UPLOAD_MANAGER_
+#define _UPLOAD_MANAGER_
+
+// File includes
+#include "UploadBatchScheduler.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DDM
+{
+	class Buffer;
+	class CommandList;
+	class CommandQueue;
+	class IndexBuffer;
+	class VertexBuffer;
+
+	class UploadManager final
+	{
+	public:
+		// Identifies the batch an upload is submitted in.
+		// A default ticket has no upload, it is complete and waiting on it does nothing.
+		struct Ticket
+		{
+			uint64_t BatchIndex = UploadBatchScheduler::InvalidBatchIndex;
+
+			bool IsValid() const { return BatchIndex != UploadBatchScheduler::InvalidBatchIndex; }
+		};
+
+		/**
+		 * @param copyQueue The copy queue the batches are submitted to.
+		 * @param maxBatchSize The number of bytes after which a batch is submitted.
+		 * @param maxBatchUploads The number of uploads after which a batch is submitted.
+		 */
+		UploadManager(CommandQueue* copyQueue, uint64_t maxBatchSize = UploadBatchScheduler::DefaultMaxBatchSize,
+			uint32_t maxBatchUploads = UploadBatchScheduler::DefaultMaxBatchUploads);
+
+		~UploadManager();
+
+		UploadManager(UploadManager& other) = delete;
+		UploadManager(UploadManager&& other) = delete;
+
+		UploadManager& operator=(UploadManager& other) = delete;
+		UploadManager& operator=(UploadManager&& other) = delete;
+
+		/**
+		 * Create a buffer in GPU memory and upload the contents to it.
+		 * The buffer may not be used before the ticket has been waited on.
+		 */
+		Ticket CopyBuffer(Buffer& buffer, size_t numElements, size_t elementSize, const void* bufferData,
+			D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
+		Ticket CopyVertexBuffer(VertexBuffer& vertexBuffer, size_t numVertices, size_t vertexStride, const void* vertexBufferData);
+
+		template<typename T>
+		Ticket CopyVertexBuffer(VertexBuffer& vertexBuffer, const std::vector<T>& vertexBufferData)
+		{
+			return CopyVertexBuffer(vertexBuffer, vertexBufferData.size(), sizeof(T), vertexBufferData.data());
+		}
+
+		Ticket CopyIndexBuffer(IndexBuffer& indexBuffer, size_t numIndicies, DXGI_FORMAT indexFormat, const void* indexBufferData);
+
+		template<typename T>
+		Ticket CopyIndexBuffer(IndexBuffer& indexBuffer, const std::vector<T>& indexBufferData)
+		{
+			static_assert(sizeof(T) == 2 || sizeof(T) == 4);
+
+			DXGI_FORMAT indexFormat = (sizeof(T) == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+			return CopyIndexBuffer(indexBuffer, indexBufferData.size(), indexFormat, indexBufferData.data());
+		}
+
+		// Submit the uploads that have not been submitted yet.
+		void Submit();
+
+		// Check if the upload of the ticket has completed on the GPU.
+		bool IsComplete(const Ticket& ticket);
+
+		/**
+		 * Make the command lists that are executed on the queue after this call wait on the GPU
+		 * until the upload of the ticket has completed. The batch of the ticket is submitted if
+		 * it has not been yet.
+		 */
+		void Wait(CommandQueue& queue, const Ticket& ticket);
+
+		// Block the calling thread until the upload of the ticket has completed.
+		void WaitOnCPU(const Ticket& ticket);
+
+	private:
+		// Submit the open batch. The mutex has to be locked.
+		void SubmitBatch();
+
+		// Get the fence value of the batch of the ticket, submitting it if needed.
+		uint64_t GetFenceValue(const Ticket& ticket);
+
+		CommandQueue* m_pCopyQueue;
+
+		// The command list the copies of the open batch are recorded to.
+		std::shared_ptr<CommandList> m_pCommandList;
+
+		UploadBatchScheduler m_Scheduler;
+
+		std::mutex m_Mutex;
+	};
+}
+
+#endif // !_UPLOAD_MANAGER_
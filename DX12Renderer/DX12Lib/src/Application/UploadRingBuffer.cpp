@@ -0,0 +1,348 @@
+// UploadRingBuffer.cpp
+
+// Header include
+#include "UploadRingBuffer.h"
+
+// File includes
+#include "Application/Application.h"
+#include "Helpers/Helpers.h"
+#include "Includes/DXRHelpersIncludes.h"
+
+// Standard library includes
+#include <algorithm>
+#include <bit>
+
+DDM::UploadRingBuffer::UploadRingBuffer(Microsoft::WRL::ComPtr<ID3D12Fence> fence, size_t heapSize)
+    : m_d3d12Fence(fence)
+    , m_HeapSize(heapSize)
+    , m_FrameIndex(0)
+    , m_TrimFrameCount(DefaultTrimFrameCount)
+    , m_HeapsUsedThisFrame(0)
+    , m_BytesLeasedThisFrame(0)
+    , m_HeapsUsedLastFrame(0)
+    , m_BytesLeasedLastFrame(0)
+    , m_HighWaterMark(0)
+    , m_NumTrimmedHeaps(0)
+{
+}
+
+DDM::UploadRingBuffer::~UploadRingBuffer()
+{
+}
+
+DDM::UploadRingBuffer::Block DDM::UploadRingBuffer::Allocate(size_t sizeInBytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ReleaseCompletedBlocks();
+
+    // Keep every block aligned like the start of a resource, so alignment
+    // within a block is the same as alignment within the heap.
+    uint64_t alignedSize = Math::AlignUp<uint64_t>(sizeInBytes, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    for (uint32_t heapIndex : m_RingHeaps)
+    {
+        uint64_t offset = m_Heaps[heapIndex]->m_Ring.Allocate(alignedSize);
+        if (offset != FenceRingAllocator::InvalidOffset)
+        {
+            return MakeBlock(heapIndex, offset, sizeInBytes);
+        }
+    }
+
+    // All heaps are in flight, add another one.
+    uint32_t heapIndex = CreateHeap(std::max<uint64_t>(m_HeapSize, alignedSize));
+    m_RingHeaps.push_back(heapIndex);
+
+    uint64_t offset = m_Heaps[heapIndex]->m_Ring.Allocate(alignedSize);
+
+    return MakeBlock(heapIndex, offset, sizeInBytes);
+}
+
+DDM::UploadRingBuffer::Block DDM::UploadRingBuffer::AllocateDedicated(size_t sizeInBytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ReleaseCompletedBlocks();
+
+    uint64_t bucketSize = GetBucketSize(sizeInBytes);
+    auto& bucket = m_DedicatedHeaps[bucketSize];
+
+    // A dedicated heap is available once its only block has been reclaimed.
+    for (uint32_t heapIndex : bucket)
+    {
+        if (m_Heaps[heapIndex]->m_Ring.IsEmpty())
+        {
+            uint64_t offset = m_Heaps[heapIndex]->m_Ring.Allocate(bucketSize);
+            return MakeBlock(heapIndex, offset, bucketSize);
+        }
+    }
+
+    uint32_t heapIndex = CreateHeap(bucketSize);
+    bucket.push_back(heapIndex);
+
+    uint64_t offset = m_Heaps[heapIndex]->m_Ring.Allocate(bucketSize);
+
+    return MakeBlock(heapIndex, offset, bucketSize);
+}
+
+void DDM::UploadRingBuffer::Retire(const Block& block, uint64_t fenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Heaps[block.HeapIndex]->m_Ring.Retire(block.Offset, fenceValue);
+}
+
+void DDM::UploadRingBuffer::ReclaimCompletedBlocks()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ReleaseCompletedBlocks();
+}
+
+size_t DDM::UploadRingBuffer::GetCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    size_t capacity = 0;
+    for (const auto& heap : m_Heaps)
+    {
+        if (heap)
+        {
+            capacity += heap->m_Ring.GetCapacity();
+        }
+    }
+
+    return capacity;
+}
+
+size_t DDM::UploadRingBuffer::GetUsedSize() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    size_t usedSize = 0;
+    for (const auto& heap : m_Heaps)
+    {
+        if (heap)
+        {
+            usedSize += heap->m_Ring.GetUsedSize();
+        }
+    }
+
+    return usedSize;
+}
+
+void DDM::UploadRingBuffer::EndFrame()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_HeapsUsedLastFrame = m_HeapsUsedThisFrame;
+    m_BytesLeasedLastFrame = m_BytesLeasedThisFrame;
+    m_HighWaterMark = std::max(m_BytesLeasedThisFrame, m_HighWaterMark - m_HighWaterMark / HighWaterMarkDecay);
+
+    m_HeapsUsedThisFrame = 0;
+    m_BytesLeasedThisFrame = 0;
+
+    ReleaseCompletedBlocks();
+    TrimHeaps();
+
+    ++m_FrameIndex;
+}
+
+void DDM::UploadRingBuffer::SetTrimFrameCount(uint32_t frameCount)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_TrimFrameCount = frameCount;
+}
+
+DDM::UploadRingBuffer::Statistics DDM::UploadRingBuffer::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Statistics statistics = {};
+
+    for (const auto& heap : m_Heaps)
+    {
+        if (heap)
+        {
+            statistics.Capacity += heap->m_Ring.GetCapacity();
+            statistics.UsedSize += heap->m_Ring.GetUsedSize();
+        }
+    }
+
+    statistics.NumRingHeaps = static_cast<uint32_t>(m_RingHeaps.size());
+    for (const auto& bucket : m_DedicatedHeaps)
+    {
+        statistics.NumDedicatedHeaps += static_cast<uint32_t>(bucket.second.size());
+    }
+
+    statistics.HeapsUsedLastFrame = m_HeapsUsedLastFrame;
+    statistics.BytesLeasedLastFrame = m_BytesLeasedLastFrame;
+    statistics.HighWaterMark = m_HighWaterMark;
+    statistics.NumTrimmedHeaps = m_NumTrimmedHeaps;
+
+    return statistics;
+}
+
+void DDM::UploadRingBuffer::ReleaseCompletedBlocks()
+{
+    uint64_t completedFenceValue = m_d3d12Fence ? m_d3d12Fence->GetCompletedValue() : 0;
+
+    for (auto& heap : m_Heaps)
+    {
+        // Trimmed heaps leave an empty slot.
+        if (heap)
+        {
+            heap->m_Ring.ReleaseCompletedBlocks(completedFenceValue);
+        }
+    }
+}
+
+uint64_t DDM::UploadRingBuffer::GetBucketSize(uint64_t sizeInBytes)
+{
+    uint64_t step = std::max<uint64_t>(std::bit_floor(sizeInBytes) / 4, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    return Math::AlignUp(sizeInBytes, step);
+}
+
+DDM::UploadRingBuffer::Block DDM::UploadRingBuffer::MakeBlock(uint32_t heapIndex, uint64_t offset, size_t sizeInBytes)
+{
+    Heap& heap = *m_Heaps[heapIndex];
+
+    if (heap.m_LastUsedFrame != m_FrameIndex)
+    {
+        heap.m_LastUsedFrame = m_FrameIndex;
+        ++m_HeapsUsedThisFrame;
+    }
+
+    m_BytesLeasedThisFrame += sizeInBytes;
+
+    Block block;
+    block.CPU = static_cast<uint8_t*>(heap.m_CPUPtr) + offset;
+    block.GPU = heap.m_GPUPtr + offset;
+    block.Size = sizeInBytes;
+    block.Resource = heap.m_d3d12Resource.Get();
+    block.HeapIndex = heapIndex;
+    block.Offset = offset;
+
+    return block;
+}
+
+uint32_t DDM::UploadRingBuffer::CreateHeap(size_t sizeInBytes)
+{
+    uint32_t heapIndex;
+
+    if (!m_FreeHeapSlots.empty())
+    {
+        heapIndex = m_FreeHeapSlots.back();
+        m_FreeHeapSlots.pop_back();
+    }
+    else
+    {
+        heapIndex = static_cast<uint32_t>(m_Heaps.size());
+        m_Heaps.emplace_back();
+    }
+
+    m_Heaps[heapIndex] = std::make_unique<Heap>(sizeInBytes);
+    // Make sure MakeBlock counts the new heap as used in this frame.
+    m_Heaps[heapIndex]->m_LastUsedFrame = m_FrameIndex - 1;
+
+    return heapIndex;
+}
+
+void DDM::UploadRingBuffer::TrimHeaps()
+{
+    size_t ringCapacity = 0;
+    for (uint32_t heapIndex : m_RingHeaps)
+    {
+        ringCapacity += m_Heaps[heapIndex]->m_Ring.GetCapacity();
+    }
+
+    for (auto iter = m_RingHeaps.begin(); iter != m_RingHeaps.end();)
+    {
+        Heap& heap = *m_Heaps[*iter];
+        size_t heapCapacity = heap.m_Ring.GetCapacity();
+
+        // Keep enough ring memory to hold the high-water mark.
+        if (CanTrimHeap(heap) && ringCapacity - heapCapacity >= m_HighWaterMark)
+        {
+            ringCapacity -= heapCapacity;
+
+            m_Heaps[*iter].reset();
+            m_FreeHeapSlots.push_back(*iter);
+            ++m_NumTrimmedHeaps;
+
+            iter = m_RingHeaps.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    for (auto bucketIter = m_DedicatedHeaps.begin(); bucketIter != m_DedicatedHeaps.end();)
+    {
+        auto& bucket = bucketIter->second;
+
+        for (auto iter = bucket.begin(); iter != bucket.end();)
+        {
+            if (CanTrimHeap(*m_Heaps[*iter]))
+            {
+                m_Heaps[*iter].reset();
+                m_FreeHeapSlots.push_back(*iter);
+                ++m_NumTrimmedHeaps;
+
+                iter = bucket.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        if (bucket.empty())
+        {
+            bucketIter = m_DedicatedHeaps.erase(bucketIter);
+        }
+        else
+        {
+            ++bucketIter;
+        }
+    }
+}
+
+bool DDM::UploadRingBuffer::CanTrimHeap(const Heap& heap) const
+{
+    return heap.m_Ring.IsEmpty() && m_FrameIndex - heap.m_LastUsedFrame >= m_TrimFrameCount;
+}
+
+DDM::UploadRingBuffer::Heap::Heap(size_t sizeInBytes)
+    : m_CPUPtr(nullptr)
+    , m_GPUPtr(D3D12_GPU_VIRTUAL_ADDRESS(0))
+    , m_Ring(sizeInBytes)
+    , m_LastUsedFrame(0)
+{
+    auto device = Application::Get().GetDevice();
+
+    auto properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes);
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &properties,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_d3d12Resource)
+    ));
+
+    m_GPUPtr = m_d3d12Resource->GetGPUVirtualAddress();
+    ThrowIfFailed(m_d3d12Resource->Map(0, nullptr, &m_CPUPtr));
+}
+
+DDM::UploadRingBuffer::Heap::~Heap()
+{
+    m_d3d12Resource->Unmap(0, nullptr);
+    m_CPUPtr = nullptr;
+    m_GPUPtr = D3D12_GPU_VIRTUAL_ADDRESS(0);
+}
@@ -0,0 +1,213 @@
+// UploadRingBuffer.h
+
+/**
+ * Upload memory that is shared by all the command lists of a command queue.
+ *
+ * The memory consists of one or more persistently mapped upload heaps that are
+ * each managed by a FenceRingAllocator. Command lists lease blocks from the ring
+ * and retire them with the fence value of the submission that uses them, so the
+ * memory is reused as soon as that submission has completed on the GPU.
+ * A new heap is only added when none of the existing heaps has room left after
+ * the completed blocks were reclaimed, so the upload memory stays bounded by the
+ * amount that is in flight.
+ *
+ * Requests that are too large for a ring are served from dedicated heaps. These are
+ * pooled in size buckets and reused once their fence has completed, instead of being
+ * created and released every frame.
+ *
+ * EndFrame keeps per frame counters and a decaying high-water mark of the bytes that
+ * are leased per frame. Heaps that have not been used for a number of frames are
+ * released, so a single spike does not pin its peak memory for the rest of the run.
+ */
+
+#ifndef _UPLOAD_RING_BUFFER_
+#define _UPLOAD_RING_BUFFER_
+
+// File includes
+#include "FenceRingAllocator.h"
+#include "Helpers/Defines.h"
+#include "Includes/DirectXIncludes.h"
+
+// Standard library includes
+#include <wrl.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DDM
+{
+	class UploadRingBuffer final
+	{
+	public:
+		// A block of upload memory leased from the ring.
+		struct Block
+		{
+			void* CPU;
+			D3D12_GPU_VIRTUAL_ADDRESS GPU;
+			size_t Size;
+
+			// The upload heap, the block starts at Offset within it. Used as the source of copies.
+			ID3D12Resource* Resource;
+
+			// The heap and offset within that heap, used to retire the block.
+			uint32_t HeapIndex;
+			uint64_t Offset;
+		};
+
+		// Upload memory counters, for example for a memory overlay.
+		struct Statistics
+		{
+			// The total size of the upload heaps.
+			size_t Capacity;
+			// The number of bytes that are leased or waiting for their fence.
+			size_t UsedSize;
+			uint32_t NumRingHeaps;
+			uint32_t NumDedicatedHeaps;
+			// The number of heaps and bytes that were leased from in the last frame.
+			uint32_t HeapsUsedLastFrame;
+			size_t BytesLeasedLastFrame;
+			// The peak of the bytes leased per frame, decaying over time.
+			size_t HighWaterMark;
+			// The number of heaps that were released by trimming.
+			uint64_t NumTrimmedHeaps;
+		};
+
+		// Heaps that are not used for this many frames are released by default.
+		static constexpr uint32_t DefaultTrimFrameCount = 120;
+
+		/**
+		 * @param fence The fence that is signaled by the command queue that uses
+		 * the ring. Can be nullptr, in which case only blocks that are retired
+		 * with a fence value of 0 are reused.
+		 * @param heapSize The size of each upload heap in the ring.
+		 */
+		explicit UploadRingBuffer(Microsoft::WRL::ComPtr<ID3D12Fence> fence, size_t heapSize = _16MB);
+
+		~UploadRingBuffer();
+
+		UploadRingBuffer(UploadRingBuffer& other) = delete;
+		UploadRingBuffer(UploadRingBuffer&& other) = delete;
+
+		UploadRingBuffer& operator=(UploadRingBuffer& other) = delete;
+		UploadRingBuffer& operator=(UploadRingBuffer&& other) = delete;
+
+		/**
+		 * Lease a block of upload memory.
+		 * The blocks of completed submissions are reclaimed first, a new upload heap
+		 * is created if there is still no room.
+		 */
+		Block Allocate(size_t sizeInBytes);
+
+		/**
+		 * Lease a dedicated upload heap for a request that is too large for a ring.
+		 * The size is rounded up to a bucket size and the heap is taken from the pool
+		 * of that bucket, a new heap is only created if all of them are in flight.
+		 * The returned block starts at the beginning of the heap and its size is the
+		 * bucket size.
+		 */
+		Block AllocateDedicated(size_t sizeInBytes);
+
+		/**
+		 * Return a block to the ring. The block is reused once the fence
+		 * reaches the fence value.
+		 */
+		void Retire(const Block& block, uint64_t fenceValue);
+
+		// Reclaim the blocks of which the fence value has completed, instead of on the next allocation.
+		void ReclaimCompletedBlocks();
+
+		// Get the total size of the upload heaps.
+		size_t GetCapacity() const;
+
+		// Get the number of bytes that are leased or waiting for their fence.
+		size_t GetUsedSize() const;
+
+		/**
+		 * Close the current frame. This updates the per frame counters and the
+		 * high-water mark, and releases the heaps that have not been used for the
+		 * trim frame count. Ring heaps are only released while the remaining ring
+		 * heaps can still hold the high-water mark.
+		 */
+		void EndFrame();
+
+		// Set the number of frames a heap has to be unused before it is released.
+		void SetTrimFrameCount(uint32_t frameCount);
+
+		Statistics GetStatistics() const;
+
+	private:
+		// A persistently mapped upload heap and the ring that manages it.
+		struct Heap
+		{
+			explicit Heap(size_t sizeInBytes);
+
+			~Heap();
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
+
+			// Base pointer.
+			void* m_CPUPtr;
+			D3D12_GPU_VIRTUAL_ADDRESS m_GPUPtr;
+
+			FenceRingAllocator m_Ring;
+
+			// The last frame that a block was leased from this heap.
+			uint64_t m_LastUsedFrame;
+		};
+
+		// The high-water mark loses 1/HighWaterMarkDecay of its value every frame.
+		static constexpr size_t HighWaterMarkDecay = 64;
+
+		// Reclaim the blocks of which the fence has completed.
+		// The mutex must be held.
+		void ReleaseCompletedBlocks();
+
+		// Round a dedicated allocation up to the size of its bucket.
+		// Buckets are spaced a quarter of a power of two apart.
+		static uint64_t GetBucketSize(uint64_t sizeInBytes);
+
+		// Create a block for the allocation at the offset in the heap
+		// and count it in the statistics of the current frame.
+		Block MakeBlock(uint32_t heapIndex, uint64_t offset, size_t sizeInBytes);
+
+		// Create a heap in a free slot of m_Heaps and return its index.
+		uint32_t CreateHeap(size_t sizeInBytes);
+
+		// Release the heaps that have not been used for the trim frame count.
+		// The mutex must be held.
+		void TrimHeaps();
+
+		// Check to see if the heap is unused and has been for the trim frame count.
+		bool CanTrimHeap(const Heap& heap) const;
+
+		// All the heaps, both ring and dedicated. Blocks refer to heaps by index.
+		// Released heaps leave an empty slot that is reused by the next heap.
+		std::vector<std::unique_ptr<Heap>> m_Heaps;
+		std::vector<uint32_t> m_FreeHeapSlots;
+		// Indices of the heaps that are used as a ring.
+		std::vector<uint32_t> m_RingHeaps;
+		// Indices of the dedicated heaps per bucket size.
+		std::map<uint64_t, std::vector<uint32_t>> m_DedicatedHeaps;
+
+		Microsoft::WRL::ComPtr<ID3D12Fence> m_d3d12Fence;
+
+		// The size of each upload heap.
+		size_t m_HeapSize;
+
+		uint64_t m_FrameIndex;
+		uint32_t m_TrimFrameCount;
+
+		uint32_t m_HeapsUsedThisFrame;
+		size_t m_BytesLeasedThisFrame;
+		uint32_t m_HeapsUsedLastFrame;
+		size_t m_BytesLeasedLastFrame;
+		size_t m_HighWaterMark;
+		uint64_t m_NumTrimmedHeaps;
+
+		mutable std::mutex m_Mutex;
+	};
+}
+
+#endif // !_UPLOAD_RING_BUFFER_
@@ -146,6 +146,8 @@ void DDM::Window::OnRender(RenderEventArgs&)
     {
         RenderEventArgs renderEventArgs(m_pRenderClock->GetElapsedSec(), m_pRenderClock->GetTotalTime());
         m_pGame->OnRender(renderEventArgs);
+
+        Application::Get().EndFrame();
     }
 }
 
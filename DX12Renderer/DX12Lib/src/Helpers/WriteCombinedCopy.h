@@ -0,0 +1,235 @@
+// WriteCombinedCopy.h
+
+/**
+ * Copy kernels for writing to write-combined memory, such as mapped upload heaps.
+ *
+ * Write-combined memory is not cached, so the data is best written in full, aligned
+ * and sequential chunks. The SSE2 and AVX2 kernels copy the unaligned head of the
+ * destination with a plain copy, stream the rest with non-temporal stores and finish
+ * the tail with a plain copy. The scalar kernel is used on CPUs without SSE2.
+ * The fastest kernel the CPU supports is selected once with CPUID.
+ *
+ * This header has no dependencies on the rest of the library so the DXR helpers
+ * can use it as well.
+ */
+
+#ifndef WriteCombinedCopyIncluded
+#define WriteCombinedCopyIncluded
+
+// Standard library includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DDM_WRITE_COMBINED_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define DDM_WRITE_COMBINED_X86 0
+#endif
+
+// MSVC allows AVX2 intrinsics in any function, GCC and Clang need the target attribute.
+#if DDM_WRITE_COMBINED_X86 && !defined(_MSC_VER)
+#define DDM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DDM_TARGET_AVX2
+#endif
+
+namespace DDM
+{
+	namespace WriteCombined
+	{
+		enum class CopyKernel
+		{
+			Scalar,
+			SSE2,
+			AVX2
+		};
+
+		// Copies smaller than this are not worth the setup of the streaming loop.
+		constexpr size_t StreamingThreshold = 256;
+
+		inline void CopyScalar(void* destination, const void* source, size_t sizeInBytes)
+		{
+			std::memcpy(destination, source, sizeInBytes);
+		}
+
+#if DDM_WRITE_COMBINED_X86
+		inline void CopySSE2(void* destination, const void* source, size_t sizeInBytes)
+		{
+			if (sizeInBytes < StreamingThreshold)
+			{
+				std::memcpy(destination, source, sizeInBytes);
+				return;
+			}
+
+			auto* pDestination = static_cast<uint8_t*>(destination);
+			auto* pSource = static_cast<const uint8_t*>(source);
+
+			// Copy the head so that the streaming stores are 16 byte aligned.
+			size_t headSize = (16 - (reinterpret_cast<uintptr_t>(pDestination) & 15)) & 15;
+			std::memcpy(pDestination, pSource, headSize);
+			pDestination += headSize;
+			pSource += headSize;
+			sizeInBytes -= headSize;
+
+			// Fill a full 64 byte write-combining buffer per iteration.
+			for (; sizeInBytes >= 64; sizeInBytes -= 64, pDestination += 64, pSource += 64)
+			{
+				__m128i data0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource));
+				__m128i data1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 16));
+				__m128i data2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 32));
+				__m128i data3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 48));
+
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination), data0);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination + 16), data1);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination + 32), data2);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination + 48), data3);
+			}
+
+			for (; sizeInBytes >= 16; sizeInBytes -= 16, pDestination += 16, pSource += 16)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource)));
+			}
+
+			std::memcpy(pDestination, pSource, sizeInBytes);
+
+			// Make the streaming stores visible before the memory is handed to the GPU.
+			_mm_sfence();
+		}
+
+		DDM_TARGET_AVX2 inline void CopyAVX2(void* destination, const void* source, size_t sizeInBytes)
+		{
+			if (sizeInBytes < StreamingThreshold)
+			{
+				std::memcpy(destination, source, sizeInBytes);
+				return;
+			}
+
+			auto* pDestination = static_cast<uint8_t*>(destination);
+			auto* pSource = static_cast<const uint8_t*>(source);
+
+			// Copy the head so that the streaming stores are 32 byte aligned.
+			size_t headSize = (32 - (reinterpret_cast<uintptr_t>(pDestination) & 31)) & 31;
+			std::memcpy(pDestination, pSource, headSize);
+			pDestination += headSize;
+			pSource += headSize;
+			sizeInBytes -= headSize;
+
+			// Fill two full 64 byte write-combining buffers per iteration.
+			for (; sizeInBytes >= 128; sizeInBytes -= 128, pDestination += 128, pSource += 128)
+			{
+				__m256i data0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource));
+				__m256i data1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 32));
+				__m256i data2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 64));
+				__m256i data3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 96));
+
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(pDestination), data0);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(pDestination + 32), data1);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(pDestination + 64), data2);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(pDestination + 96), data3);
+			}
+
+			for (; sizeInBytes >= 32; sizeInBytes -= 32, pDestination += 32, pSource += 32)
+			{
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(pDestination),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource)));
+			}
+
+			std::memcpy(pDestination, pSource, sizeInBytes);
+
+			// Make the streaming stores visible before the memory is handed to the GPU.
+			_mm_sfence();
+		}
+#endif
+
+		// Query CPUID for the fastest kernel that is supported by the CPU and the OS.
+		inline CopyKernel DetectCopyKernel()
+		{
+#if DDM_WRITE_COMBINED_X86
+			auto cpuid = [](int leaf, int subleaf, unsigned int registers[4])
+			{
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuidex(info, leaf, subleaf);
+				for (int i = 0; i < 4; ++i)
+				{
+					registers[i] = static_cast<unsigned int>(info[i]);
+				}
+#else
+				__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+			};
+
+			unsigned int registers[4];
+			cpuid(0, 0, registers);
+			unsigned int maxLeaf = registers[0];
+
+			cpuid(1, 0, registers);
+			bool hasSSE2 = (registers[3] & (1u << 26)) != 0;
+			bool hasOSXSave = (registers[2] & (1u << 27)) != 0;
+			bool hasAVX = (registers[2] & (1u << 28)) != 0;
+
+			if (maxLeaf >= 7 && hasOSXSave && hasAVX)
+			{
+				// The OS has to save the YMM registers on a context switch.
+#if defined(_MSC_VER)
+				uint64_t enabledState = _xgetbv(0);
+#else
+				unsigned int eax, edx;
+				__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+				uint64_t enabledState = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+				if ((enabledState & 0x6) == 0x6)
+				{
+					cpuid(7, 0, registers);
+					if (registers[1] & (1u << 5))
+					{
+						return CopyKernel::AVX2;
+					}
+				}
+			}
+
+			if (hasSSE2)
+			{
+				return CopyKernel::SSE2;
+			}
+#endif
+			return CopyKernel::Scalar;
+		}
+
+		// The kernel that is used by Copy, detected on first use.
+		inline CopyKernel GetCopyKernel()
+		{
+			static const CopyKernel kernel = DetectCopyKernel();
+			return kernel;
+		}
+
+		// Copy data to write-combined memory using the fastest supported kernel.
+		inline void Copy(void* destination, const void* source, size_t sizeInBytes)
+		{
+			switch (GetCopyKernel())
+			{
+#if DDM_WRITE_COMBINED_X86
+			case CopyKernel::AVX2:
+				CopyAVX2(destination, source, sizeInBytes);
+				break;
+			case CopyKernel::SSE2:
+				CopySSE2(destination, source, sizeInBytes);
+				break;
+#endif
+			default:
+				CopyScalar(destination, source, sizeInBytes);
+				break;
+			}
+		}
+	}
+}
+
+#endif // !WriteCombinedCopyIncluded
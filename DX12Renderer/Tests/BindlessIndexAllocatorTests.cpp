@@ -0,0 +1,120 @@
+// BindlessIndexAllocatorTests.cpp
+
+/**
+ * Tests of the index allocation, free list recycling and fence based reuse of the BindlessIndexAllocator.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "Application/DescriptorAllocator/BindlessIndexAllocator.h"
+
+// Standard library includes
+#include <cstdint>
+
+using DDM::BindlessIndexAllocator;
+
+TEST_CASE(BindlessIndicesAreHandedOutInOrder)
+{
+	BindlessIndexAllocator allocator(8);
+
+	CHECK_EQUAL(allocator.Allocate(), 0u);
+	CHECK_EQUAL(allocator.Allocate(), 1u);
+	CHECK_EQUAL(allocator.Allocate(), 2u);
+	CHECK_EQUAL(allocator.GetNumAllocated(), 3u);
+}
+
+TEST_CASE(BindlessFreedIndicesAreReusedLastInFirstOut)
+{
+	BindlessIndexAllocator allocator(8);
+
+	for (int i = 0; i < 4; ++i)
+	{
+		allocator.Allocate();
+	}
+
+	allocator.Free(1, 0);
+	allocator.Free(3, 0);
+	CHECK_EQUAL(allocator.GetNumAllocated(), 2u);
+
+	// The most recently freed index first, then the free list is empty and the unused indices follow.
+	CHECK_EQUAL(allocator.Allocate(), 3u);
+	CHECK_EQUAL(allocator.Allocate(), 1u);
+	CHECK_EQUAL(allocator.Allocate(), 4u);
+}
+
+TEST_CASE(BindlessAllocateFailsWhenAllIndicesAreInUse)
+{
+	BindlessIndexAllocator allocator(2);
+
+	CHECK_EQUAL(allocator.Allocate(), 0u);
+	CHECK_EQUAL(allocator.Allocate(), 1u);
+	CHECK_EQUAL(allocator.Allocate(), BindlessIndexAllocator::InvalidIndex);
+
+	// An index that waits for its fence is still in use.
+	allocator.Free(0, 5);
+	CHECK_EQUAL(allocator.Allocate(), BindlessIndexAllocator::InvalidIndex);
+	CHECK_EQUAL(allocator.GetNumAllocated(), 2u);
+
+	allocator.ReleaseCompletedIndices(5);
+	CHECK_EQUAL(allocator.Allocate(), 0u);
+}
+
+TEST_CASE(BindlessFreedIndexWaitsForItsFence)
+{
+	BindlessIndexAllocator allocator(8);
+
+	uint32_t index = allocator.Allocate();
+	allocator.Free(index, 3);
+	CHECK_EQUAL(allocator.GetNumPending(), 1u);
+
+	allocator.ReleaseCompletedIndices(2);
+	CHECK_EQUAL(allocator.GetNumPending(), 1u);
+	CHECK_EQUAL(allocator.Allocate(), 1u);
+
+	allocator.ReleaseCompletedIndices(3);
+	CHECK_EQUAL(allocator.GetNumPending(), 0u);
+	CHECK_EQUAL(allocator.Allocate(), index);
+}
+
+TEST_CASE(BindlessFreedIndexWaitsForEveryQueue)
+{
+	BindlessIndexAllocator allocator(8, 2);
+
+	uint32_t index = allocator.Allocate();
+	const uint64_t fenceValues[] = { 4, 7 };
+	allocator.Free(index, fenceValues);
+
+	// Only the first queue has completed.
+	const uint64_t firstCompleted[] = { 4, 6 };
+	allocator.ReleaseCompletedIndices(firstCompleted);
+	CHECK_EQUAL(allocator.GetNumPending(), 1u);
+
+	// Only the second queue has completed.
+	const uint64_t secondCompleted[] = { 3, 7 };
+	allocator.ReleaseCompletedIndices(secondCompleted);
+	CHECK_EQUAL(allocator.GetNumPending(), 1u);
+
+	const uint64_t bothCompleted[] = { 4, 7 };
+	allocator.ReleaseCompletedIndices(bothCompleted);
+	CHECK_EQUAL(allocator.GetNumPending(), 0u);
+	CHECK_EQUAL(allocator.Allocate(), index);
+}
+
+TEST_CASE(BindlessReleaseStopsAtTheFirstIndexInFlight)
+{
+	BindlessIndexAllocator allocator(8);
+
+	uint32_t first = allocator.Allocate();
+	uint32_t second = allocator.Allocate();
+	allocator.Free(first, 5);
+	allocator.Free(second, 2);
+
+	// The second index has completed, but it was freed after an index that is still in flight.
+	allocator.ReleaseCompletedIndices(4);
+	CHECK_EQUAL(allocator.GetNumPending(), 2u);
+	CHECK_EQUAL(allocator.GetNumAllocated(), 2u);
+
+	allocator.ReleaseCompletedIndices(5);
+	CHECK_EQUAL(allocator.GetNumPending(), 0u);
+	CHECK_EQUAL(allocator.GetNumAllocated(), 0u);
+}
@@ -0,0 +1,138 @@
+// DescriptorSegmentRingTests.cpp
+
+/**
+ * Tests of the segment bookkeeping of the shader visible descriptor ring, driven by a
+ * fence that is signaled on the CPU.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "FakeFence.h"
+#include "Application/DescriptorAllocator/DescriptorSegmentRing.h"
+
+// Standard library includes
+#include <memory>
+#include <new>
+
+using DDM::DescriptorSegmentRing;
+using DDM::Tests::FakeFence;
+
+TEST_CASE(SegmentRingLeasesSegmentsOfAtLeastTheSegmentSize)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DescriptorSegmentRing ring(256, 32, fence);
+
+	DescriptorSegmentRing::Segment small = ring.Allocate(4);
+	CHECK_EQUAL(small.Offset, 0u);
+	CHECK_EQUAL(small.NumDescriptors, 32u);
+
+	// A larger request gets a larger segment.
+	DescriptorSegmentRing::Segment large = ring.Allocate(48);
+	CHECK_EQUAL(large.Offset, 32u);
+	CHECK_EQUAL(large.NumDescriptors, 48u);
+
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 80u);
+}
+
+TEST_CASE(SegmentRingReclaimsRetiredSegmentsOnceTheirFenceCompletes)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DescriptorSegmentRing ring(256, 32, fence);
+
+	DescriptorSegmentRing::Segment first = ring.Allocate(32);
+	DescriptorSegmentRing::Segment second = ring.Allocate(32);
+	ring.Retire(first, 1);
+	ring.Retire(second, 2);
+
+	ring.ReclaimCompletedSegments();
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 64u);
+
+	fence->CompletedValue = 1;
+	ring.ReclaimCompletedSegments();
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 32u);
+
+	fence->CompletedValue = 2;
+	ring.ReclaimCompletedSegments();
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 0u);
+}
+
+TEST_CASE(SegmentRingAllocateReclaimsCompletedSegments)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DescriptorSegmentRing ring(64, 32, fence);
+
+	ring.Retire(ring.Allocate(32), 1);
+	ring.Retire(ring.Allocate(32), 1);
+	fence->CompletedValue = 1;
+
+	// The ring is full, the allocation reclaims the completed segments without waiting.
+	DescriptorSegmentRing::Segment segment = ring.Allocate(32);
+	CHECK_EQUAL(segment.Offset, 0u);
+	CHECK_EQUAL(fence->NumWaits, 0u);
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 32u);
+}
+
+TEST_CASE(SegmentRingWaitsForTheOldestRetiredSegmentWhenFull)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DescriptorSegmentRing ring(64, 32, fence);
+
+	ring.Retire(ring.Allocate(32), 1);
+	ring.Retire(ring.Allocate(32), 2);
+
+	// Only the oldest segment is waited for.
+	DescriptorSegmentRing::Segment segment = ring.Allocate(32);
+	CHECK_EQUAL(segment.Offset, 0u);
+	CHECK_EQUAL(fence->NumWaits, 1u);
+	CHECK_EQUAL(fence->CompletedValue, 1u);
+}
+
+TEST_CASE(SegmentRingThrowsWhenAllSegmentsAreLeased)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DescriptorSegmentRing ring(64, 32, fence);
+
+	ring.Allocate(32);
+	ring.Allocate(32);
+
+	// Waiting would never end, the segments have not been submitted.
+	bool hasThrown = false;
+	try
+	{
+		ring.Allocate(32);
+	}
+	catch (const std::bad_alloc&)
+	{
+		hasThrown = true;
+	}
+
+	CHECK(hasThrown);
+	CHECK_EQUAL(fence->NumWaits, 0u);
+}
+
+TEST_CASE(SegmentRingWithoutFenceOnlyReusesSegmentsRetiredWithZero)
+{
+	DescriptorSegmentRing ring(64, 32, nullptr);
+
+	DescriptorSegmentRing::Segment first = ring.Allocate(32);
+	DescriptorSegmentRing::Segment second = ring.Allocate(32);
+	ring.Retire(first, 0);
+	ring.Retire(second, 1);
+
+	ring.ReclaimCompletedSegments();
+	CHECK_EQUAL(ring.GetNumUsedDescriptors(), 32u);
+
+	CHECK_EQUAL(ring.Allocate(32).Offset, 0u);
+
+	// The segment retired with 1 is never reclaimed, waiting on it would never end.
+	bool hasThrown = false;
+	try
+	{
+		ring.Allocate(32);
+	}
+	catch (const std::bad_alloc&)
+	{
+		hasThrown = true;
+	}
+	CHECK(hasThrown);
+}
@@ -0,0 +1,200 @@
+// EnhancedBarrierBuilderTests.cpp
+
+/**
+ * Tests of the translation of legacy barriers into enhanced barriers.
+ * The resources are never dereferenced, so any distinct pointer will do.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "Application/Resources/EnhancedBarrierBuilder.h"
+
+// Standard library includes
+#include <cstdint>
+
+using DDM::EnhancedBarrierBuilder;
+
+namespace
+{
+	ID3D12Resource* const Resource = reinterpret_cast<ID3D12Resource*>(uintptr_t(0x1000));
+}
+
+TEST_CASE(BarrierStateOfCommonState)
+{
+	EnhancedBarrierBuilder::BarrierState texture = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_COMMON, true);
+	CHECK_EQUAL(texture.Layout, D3D12_BARRIER_LAYOUT_COMMON);
+	CHECK_EQUAL(texture.Sync, D3D12_BARRIER_SYNC_ALL);
+	CHECK_EQUAL(texture.Access, D3D12_BARRIER_ACCESS_COMMON);
+
+	// Buffers have no layout.
+	EnhancedBarrierBuilder::BarrierState buffer = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_COMMON, false);
+	CHECK_EQUAL(buffer.Layout, D3D12_BARRIER_LAYOUT_UNDEFINED);
+	CHECK_EQUAL(buffer.Sync, D3D12_BARRIER_SYNC_ALL);
+}
+
+TEST_CASE(BarrierStateOfSingleStates)
+{
+	EnhancedBarrierBuilder::BarrierState renderTarget = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+	CHECK_EQUAL(renderTarget.Layout, D3D12_BARRIER_LAYOUT_RENDER_TARGET);
+	CHECK_EQUAL(renderTarget.Sync, D3D12_BARRIER_SYNC_RENDER_TARGET);
+	CHECK_EQUAL(renderTarget.Access, D3D12_BARRIER_ACCESS_RENDER_TARGET);
+
+	EnhancedBarrierBuilder::BarrierState copyDest = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_COPY_DEST, true);
+	CHECK_EQUAL(copyDest.Layout, D3D12_BARRIER_LAYOUT_COPY_DEST);
+	CHECK_EQUAL(copyDest.Sync, D3D12_BARRIER_SYNC_COPY);
+	CHECK_EQUAL(copyDest.Access, D3D12_BARRIER_ACCESS_COPY_DEST);
+
+	EnhancedBarrierBuilder::BarrierState unorderedAccess = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_UNORDERED_ACCESS, false);
+	CHECK_EQUAL(unorderedAccess.Layout, D3D12_BARRIER_LAYOUT_UNDEFINED);
+	CHECK_EQUAL(unorderedAccess.Access, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+}
+
+TEST_CASE(BarrierStateOfCombinedReadStates)
+{
+	// Both shader resource states share the shader resource layout.
+	EnhancedBarrierBuilder::BarrierState shaderResource = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, true);
+	CHECK_EQUAL(shaderResource.Layout, D3D12_BARRIER_LAYOUT_SHADER_RESOURCE);
+	CHECK_EQUAL(shaderResource.Sync, D3D12_BARRIER_SYNC_NON_PIXEL_SHADING | D3D12_BARRIER_SYNC_PIXEL_SHADING);
+	CHECK_EQUAL(shaderResource.Access, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+
+	// Read states with different layouts fall back to the generic read layout.
+	EnhancedBarrierBuilder::BarrierState copyAndShader = EnhancedBarrierBuilder::GetBarrierState(
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+	CHECK_EQUAL(copyAndShader.Layout, D3D12_BARRIER_LAYOUT_GENERIC_READ);
+	CHECK_EQUAL(copyAndShader.Sync, D3D12_BARRIER_SYNC_PIXEL_SHADING | D3D12_BARRIER_SYNC_COPY);
+	CHECK_EQUAL(copyAndShader.Access, D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_COPY_SOURCE);
+
+	// Unless one of them is a depth read.
+	EnhancedBarrierBuilder::BarrierState depthAndShader = EnhancedBarrierBuilder::GetBarrierState(
+		D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, true);
+	CHECK_EQUAL(depthAndShader.Layout, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ);
+
+	// The generic read state of buffers.
+	EnhancedBarrierBuilder::BarrierState genericRead = EnhancedBarrierBuilder::GetBarrierState(D3D12_RESOURCE_STATE_GENERIC_READ, false);
+	CHECK_EQUAL(genericRead.Layout, D3D12_BARRIER_LAYOUT_UNDEFINED);
+	CHECK((genericRead.Access & D3D12_BARRIER_ACCESS_VERTEX_BUFFER) != 0);
+	CHECK((genericRead.Access & D3D12_BARRIER_ACCESS_INDEX_BUFFER) != 0);
+	CHECK((genericRead.Access & D3D12_BARRIER_ACCESS_COPY_SOURCE) != 0);
+}
+
+TEST_CASE(TextureTransitionBecomesTextureBarrier)
+{
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 3), true);
+
+	REQUIRE(builder.GetTextureBarriers().size() == 1);
+	CHECK(builder.GetBufferBarriers().empty());
+	CHECK(builder.GetGlobalBarriers().empty());
+
+	const D3D12_TEXTURE_BARRIER& barrier = builder.GetTextureBarriers()[0];
+	CHECK(barrier.pResource == Resource);
+	CHECK_EQUAL(barrier.LayoutBefore, D3D12_BARRIER_LAYOUT_RENDER_TARGET);
+	CHECK_EQUAL(barrier.LayoutAfter, D3D12_BARRIER_LAYOUT_SHADER_RESOURCE);
+	CHECK_EQUAL(barrier.SyncBefore, D3D12_BARRIER_SYNC_RENDER_TARGET);
+	CHECK_EQUAL(barrier.SyncAfter, D3D12_BARRIER_SYNC_PIXEL_SHADING);
+	CHECK_EQUAL(barrier.AccessBefore, D3D12_BARRIER_ACCESS_RENDER_TARGET);
+	CHECK_EQUAL(barrier.AccessAfter, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+	CHECK_EQUAL(barrier.Subresources.IndexOrFirstMipLevel, 3u);
+	CHECK_EQUAL(barrier.Subresources.NumMipLevels, 0u);
+}
+
+TEST_CASE(TextureTransitionFromCommonStateStartsInCommonLayout)
+{
+	// With enhanced barriers a texture is not promoted, its first use is an explicit transition.
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_COMMON,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE), true);
+
+	REQUIRE(builder.GetTextureBarriers().size() == 1);
+
+	const D3D12_TEXTURE_BARRIER& barrier = builder.GetTextureBarriers()[0];
+	CHECK_EQUAL(barrier.LayoutBefore, D3D12_BARRIER_LAYOUT_COMMON);
+	CHECK_EQUAL(barrier.LayoutAfter, D3D12_BARRIER_LAYOUT_SHADER_RESOURCE);
+	CHECK_EQUAL(barrier.AccessAfter, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+}
+
+TEST_CASE(PromotedTextureStaysInCommonLayout)
+{
+	// A texture that allows simultaneous access was promoted to the shader resource state,
+	// its layout is still common.
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_RENDER_TARGET), true, true);
+
+	REQUIRE(builder.GetTextureBarriers().size() == 1);
+
+	const D3D12_TEXTURE_BARRIER& barrier = builder.GetTextureBarriers()[0];
+	CHECK_EQUAL(barrier.LayoutBefore, D3D12_BARRIER_LAYOUT_COMMON);
+	CHECK_EQUAL(barrier.LayoutAfter, D3D12_BARRIER_LAYOUT_COMMON);
+
+	// The scopes still follow the states.
+	CHECK_EQUAL(barrier.SyncBefore, D3D12_BARRIER_SYNC_PIXEL_SHADING);
+	CHECK_EQUAL(barrier.SyncAfter, D3D12_BARRIER_SYNC_RENDER_TARGET);
+	CHECK_EQUAL(barrier.AccessBefore, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+	CHECK_EQUAL(barrier.AccessAfter, D3D12_BARRIER_ACCESS_RENDER_TARGET);
+}
+
+TEST_CASE(BufferTransitionBecomesBufferBarrier)
+{
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER), false);
+
+	REQUIRE(builder.GetBufferBarriers().size() == 1);
+	CHECK(builder.GetTextureBarriers().empty());
+
+	const D3D12_BUFFER_BARRIER& barrier = builder.GetBufferBarriers()[0];
+	CHECK(barrier.pResource == Resource);
+	CHECK_EQUAL(barrier.SyncBefore, D3D12_BARRIER_SYNC_COPY);
+	CHECK_EQUAL(barrier.AccessBefore, D3D12_BARRIER_ACCESS_COPY_DEST);
+	CHECK_EQUAL(barrier.AccessAfter, D3D12_BARRIER_ACCESS_VERTEX_BUFFER | D3D12_BARRIER_ACCESS_CONSTANT_BUFFER);
+	CHECK_EQUAL(barrier.Offset, 0u);
+	CHECK_EQUAL(barrier.Size, UINT64_MAX);
+}
+
+TEST_CASE(SplitTransitionUsesSplitSync)
+{
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY), true);
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Transition(Resource, D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY), true);
+
+	REQUIRE(builder.GetTextureBarriers().size() == 2);
+
+	const D3D12_TEXTURE_BARRIER& begin = builder.GetTextureBarriers()[0];
+	CHECK_EQUAL(begin.SyncBefore, D3D12_BARRIER_SYNC_RENDER_TARGET);
+	CHECK_EQUAL(begin.SyncAfter, D3D12_BARRIER_SYNC_SPLIT);
+
+	const D3D12_TEXTURE_BARRIER& end = builder.GetTextureBarriers()[1];
+	CHECK_EQUAL(end.SyncBefore, D3D12_BARRIER_SYNC_SPLIT);
+	CHECK_EQUAL(end.SyncAfter, D3D12_BARRIER_SYNC_PIXEL_SHADING);
+
+	// Both halves describe the same layout transition.
+	CHECK_EQUAL(begin.LayoutBefore, end.LayoutBefore);
+	CHECK_EQUAL(begin.LayoutAfter, end.LayoutAfter);
+}
+
+TEST_CASE(UAVAndAliasingBarriersBecomeGlobalBarriers)
+{
+	EnhancedBarrierBuilder builder;
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::UAV(Resource), false);
+	builder.AddBarrier(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, Resource), false);
+
+	REQUIRE(builder.GetGlobalBarriers().size() == 2);
+	CHECK(builder.GetTextureBarriers().empty());
+	CHECK(builder.GetBufferBarriers().empty());
+
+	const D3D12_GLOBAL_BARRIER& uav = builder.GetGlobalBarriers()[0];
+	CHECK_EQUAL(uav.SyncBefore, D3D12_BARRIER_SYNC_ALL);
+	CHECK((uav.AccessBefore & D3D12_BARRIER_ACCESS_UNORDERED_ACCESS) != 0);
+	CHECK((uav.AccessAfter & D3D12_BARRIER_ACCESS_UNORDERED_ACCESS) != 0);
+
+	const D3D12_GLOBAL_BARRIER& aliasing = builder.GetGlobalBarriers()[1];
+	CHECK_EQUAL(aliasing.SyncBefore, D3D12_BARRIER_SYNC_ALL);
+	CHECK_EQUAL(aliasing.SyncAfter, D3D12_BARRIER_SYNC_ALL);
+
+	builder.Clear();
+	CHECK(builder.GetGlobalBarriers().empty());
+}
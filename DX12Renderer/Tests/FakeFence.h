@@ -0,0 +1,41 @@
+// FakeFence.h
+
+/**
+ * A fence that is signaled on the CPU by the tests, to drive fence timelines without a device.
+ */
+
+#ifndef _FAKE_FENCE_
+#define _FAKE_FENCE_
+
+// File includes
+#include "Application/FenceTimeline.h"
+
+// Standard library includes
+#include <algorithm>
+#include <cstdint>
+
+namespace DDM::Tests
+{
+	// The test sets the completed value. Waiting completes the value right away.
+	class FakeFence final : public Fence
+	{
+	public:
+		uint64_t GetCompletedValue() override
+		{
+			++NumQueries;
+			return CompletedValue;
+		}
+
+		void WaitForValue(uint64_t value) override
+		{
+			++NumWaits;
+			CompletedValue = std::max(CompletedValue, value);
+		}
+
+		uint64_t CompletedValue = 0;
+		uint32_t NumQueries = 0;
+		uint32_t NumWaits = 0;
+	};
+}
+
+#endif // !_FAKE_FENCE_
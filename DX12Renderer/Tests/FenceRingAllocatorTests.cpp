@@ -0,0 +1,144 @@
+// FenceRingAllocatorTests.cpp
+
+/**
+ * Tests of the FenceRingAllocator, of which the blocks are reclaimed with the completed
+ * value of a fence that is signaled on the CPU.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "FakeFence.h"
+#include "Application/FenceRingAllocator.h"
+
+using DDM::FenceRingAllocator;
+using DDM::Tests::FakeFence;
+
+TEST_CASE(RingReclaimsBlocksWhenTheirFenceValueCompletes)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(256);
+
+	CHECK_EQUAL(ring.Allocate(64), 0u);
+	CHECK_EQUAL(ring.Allocate(64), 64u);
+	CHECK_EQUAL(ring.GetUsedSize(), 128u);
+
+	ring.Retire(0, 1);
+	ring.Retire(64, 2);
+
+	fence.CompletedValue = 1;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK_EQUAL(ring.GetUsedSize(), 64u);
+	CHECK_EQUAL(ring.GetTailFenceValue(), 2u);
+
+	fence.CompletedValue = 2;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK(ring.IsEmpty());
+	CHECK_EQUAL(ring.GetUsedSize(), 0u);
+	CHECK_EQUAL(ring.GetTailFenceValue(), 0u);
+}
+
+TEST_CASE(RingSkipsTheEndWhenABlockDoesNotFit)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(100);
+
+	CHECK_EQUAL(ring.Allocate(40), 0u);
+	CHECK_EQUAL(ring.Allocate(40), 40u);
+	ring.Retire(0, 1);
+
+	fence.CompletedValue = 1;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK_EQUAL(ring.GetUsedSize(), 40u);
+
+	// The 20 bytes at the end are skipped, and counted as used until the block is reclaimed.
+	CHECK_EQUAL(ring.Allocate(30), 0u);
+	CHECK_EQUAL(ring.GetUsedSize(), 90u);
+
+	ring.Retire(40, 2);
+	ring.Retire(0, 3);
+
+	fence.CompletedValue = 3;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK(ring.IsEmpty());
+	CHECK_EQUAL(ring.GetUsedSize(), 0u);
+}
+
+TEST_CASE(RingRestartsAtTheBeginningWhenEmpty)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(100);
+
+	CHECK_EQUAL(ring.Allocate(60), 0u);
+	ring.Retire(0, 1);
+
+	fence.CompletedValue = 1;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+
+	// Nothing is skipped, the head moved back to the beginning.
+	CHECK_EQUAL(ring.Allocate(60), 0u);
+	CHECK_EQUAL(ring.GetUsedSize(), 60u);
+}
+
+TEST_CASE(RingPendingBlockKeepsLaterBlocksAlive)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(256);
+
+	ring.Allocate(64);
+	ring.Allocate(64);
+	CHECK_EQUAL(ring.GetTailFenceValue(), FenceRingAllocator::PendingFenceValue);
+
+	// Retired out of order, the tail has not been retired yet.
+	ring.Retire(64, 1);
+	fence.CompletedValue = 1;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK_EQUAL(ring.GetUsedSize(), 128u);
+	CHECK_EQUAL(ring.GetTailFenceValue(), FenceRingAllocator::PendingFenceValue);
+
+	// The tail is retired with a later value, the block after it waits for it.
+	ring.Retire(0, 2);
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK_EQUAL(ring.GetUsedSize(), 128u);
+	CHECK_EQUAL(ring.GetTailFenceValue(), 2u);
+
+	fence.CompletedValue = 2;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK(ring.IsEmpty());
+}
+
+TEST_CASE(RingBlockRetiredWithZeroIsReclaimedRightAway)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(256);
+
+	ring.Allocate(64);
+	ring.Retire(0, 0);
+
+	// Nothing has been signaled yet.
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+	CHECK(ring.IsEmpty());
+}
+
+TEST_CASE(RingFailsWhenFull)
+{
+	FakeFence fence;
+	FenceRingAllocator ring(64);
+
+	// Larger than the ring.
+	CHECK_EQUAL(ring.Allocate(65), FenceRingAllocator::InvalidOffset);
+
+	CHECK_EQUAL(ring.Allocate(32), 0u);
+	CHECK_EQUAL(ring.Allocate(32), 32u);
+	CHECK_EQUAL(ring.GetUsedSize(), 64u);
+	CHECK_EQUAL(ring.Allocate(1), FenceRingAllocator::InvalidOffset);
+
+	// A failed allocation does not change the ring.
+	CHECK_EQUAL(ring.GetUsedSize(), 64u);
+
+	ring.Retire(0, 1);
+	fence.CompletedValue = 1;
+	ring.ReleaseCompletedBlocks(fence.GetCompletedValue());
+
+	CHECK_EQUAL(ring.Allocate(32), 0u);
+	CHECK_EQUAL(ring.Allocate(1), FenceRingAllocator::InvalidOffset);
+}
@@ -0,0 +1,126 @@
+// FenceTimelineTests.cpp
+
+/**
+ * Tests of the FenceTimeline, driven by a fence that is signaled on the CPU.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "FakeFence.h"
+#include "Application/FenceTimeline.h"
+
+// Standard library includes
+#include <memory>
+#include <vector>
+
+using DDM::Tests::FakeFence;
+
+TEST_CASE(TimelineOnlyQueriesFenceWhenCacheIsBehind)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DDM::FenceTimeline timeline(fence);
+
+	fence->CompletedValue = 5;
+	uint32_t numQueries = fence->NumQueries;
+
+	CHECK(timeline.IsComplete(3));
+	CHECK_EQUAL(fence->NumQueries, numQueries + 1);
+	CHECK_EQUAL(timeline.GetCachedCompletedValue(), 5u);
+
+	// The cache has passed these values, the fence is not queried again.
+	CHECK(timeline.IsComplete(3));
+	CHECK(timeline.IsComplete(5));
+	CHECK_EQUAL(fence->NumQueries, numQueries + 1);
+
+	CHECK(!timeline.IsComplete(6));
+	CHECK_EQUAL(fence->NumQueries, numQueries + 2);
+}
+
+TEST_CASE(TimelineRunsCallbacksInOrderOfTheirValues)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DDM::FenceTimeline timeline(fence);
+
+	std::vector<int> order;
+	timeline.AddCompletionCallback(3, [&]() { order.push_back(3); });
+	timeline.AddCompletionCallback(1, [&]() { order.push_back(1); });
+	timeline.AddCompletionCallback(2, [&]() { order.push_back(2); });
+	CHECK_EQUAL(timeline.GetNumPendingCallbacks(), 3u);
+
+	// Nothing has completed yet.
+	CHECK_EQUAL(timeline.Poll(), 0u);
+	CHECK(order.empty());
+
+	fence->CompletedValue = 2;
+	CHECK_EQUAL(timeline.Poll(), 2u);
+	REQUIRE(order.size() == 2);
+	CHECK_EQUAL(order[0], 1);
+	CHECK_EQUAL(order[1], 2);
+	CHECK_EQUAL(timeline.GetNumPendingCallbacks(), 1u);
+
+	fence->CompletedValue = 3;
+	timeline.Poll();
+	REQUIRE(order.size() == 3);
+	CHECK_EQUAL(order[2], 3);
+	CHECK_EQUAL(timeline.GetNumPendingCallbacks(), 0u);
+}
+
+TEST_CASE(TimelineRunsCallbackOfCompletedValueRightAway)
+{
+	auto fence = std::make_shared<FakeFence>();
+	fence->CompletedValue = 4;
+	DDM::FenceTimeline timeline(fence);
+
+	bool hasRun = false;
+	timeline.AddCompletionCallback(4, [&]() { hasRun = true; });
+
+	CHECK(hasRun);
+	CHECK_EQUAL(timeline.GetNumPendingCallbacks(), 0u);
+}
+
+TEST_CASE(TimelineCallbacksCanAddCallbacks)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DDM::FenceTimeline timeline(fence);
+
+	int numRuns = 0;
+	timeline.AddCompletionCallback(1, [&]()
+		{
+			++numRuns;
+			// Already completed, runs right away.
+			timeline.AddCompletionCallback(1, [&]() { ++numRuns; });
+			// Runs on a later poll.
+			timeline.AddCompletionCallback(2, [&]() { ++numRuns; });
+		});
+
+	fence->CompletedValue = 1;
+	timeline.Poll();
+	CHECK_EQUAL(numRuns, 2);
+	CHECK_EQUAL(timeline.GetNumPendingCallbacks(), 1u);
+
+	fence->CompletedValue = 2;
+	timeline.Poll();
+	CHECK_EQUAL(numRuns, 3);
+}
+
+TEST_CASE(TimelineWaitOnlyWaitsForIncompleteValues)
+{
+	auto fence = std::make_shared<FakeFence>();
+	fence->CompletedValue = 2;
+	DDM::FenceTimeline timeline(fence);
+
+	timeline.WaitForValue(2);
+	CHECK_EQUAL(fence->NumWaits, 0u);
+
+	bool hasRun = false;
+	timeline.AddCompletionCallback(5, [&]() { hasRun = true; });
+
+	timeline.WaitForValue(5);
+	CHECK_EQUAL(fence->NumWaits, 1u);
+	CHECK_EQUAL(timeline.GetCachedCompletedValue(), 5u);
+
+	// Waiting leaves the callbacks to the next poll.
+	CHECK(!hasRun);
+	timeline.Poll();
+	CHECK(hasRun);
+}
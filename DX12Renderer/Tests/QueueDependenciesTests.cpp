@@ -0,0 +1,68 @@
+// QueueDependenciesTests.cpp
+
+/**
+ * Tests of the QueueDependencies, with the other queues represented by fence timelines
+ * of fences that are signaled on the CPU.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "FakeFence.h"
+#include "Application/FenceTimeline.h"
+#include "Application/QueueDependencies.h"
+
+// Standard library includes
+#include <memory>
+
+using DDM::Tests::FakeFence;
+
+TEST_CASE(DependencyOnCompletedValueIsNotWaitedOn)
+{
+	auto fence = std::make_shared<FakeFence>();
+	fence->CompletedValue = 3;
+	DDM::FenceTimeline otherTimeline(fence);
+
+	DDM::QueueDependencies dependencies;
+	CHECK(!dependencies.AddDependency(otherTimeline, 2));
+	CHECK(!dependencies.AddDependency(otherTimeline, 3));
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(otherTimeline), 0u);
+}
+
+TEST_CASE(DependencyIsOnlyWaitedOnOnce)
+{
+	auto fence = std::make_shared<FakeFence>();
+	DDM::FenceTimeline otherTimeline(fence);
+
+	DDM::QueueDependencies dependencies;
+	CHECK(dependencies.AddDependency(otherTimeline, 5));
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(otherTimeline), 5u);
+
+	// The wait on 5 also covers the earlier values.
+	CHECK(!dependencies.AddDependency(otherTimeline, 5));
+	CHECK(!dependencies.AddDependency(otherTimeline, 4));
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(otherTimeline), 5u);
+
+	// A later value needs a wait of its own.
+	CHECK(dependencies.AddDependency(otherTimeline, 7));
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(otherTimeline), 7u);
+}
+
+TEST_CASE(DependenciesOnQueuesAreKeptApart)
+{
+	auto fenceA = std::make_shared<FakeFence>();
+	auto fenceB = std::make_shared<FakeFence>();
+	DDM::FenceTimeline timelineA(fenceA);
+	DDM::FenceTimeline timelineB(fenceB);
+
+	DDM::QueueDependencies dependencies;
+	CHECK(dependencies.AddDependency(timelineA, 4));
+	CHECK(dependencies.AddDependency(timelineB, 2));
+
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(timelineA), 4u);
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(timelineB), 2u);
+
+	// Once the other queue is done, a later value is not waited on either.
+	fenceB->CompletedValue = 6;
+	CHECK(!dependencies.AddDependency(timelineB, 6));
+	CHECK_EQUAL(dependencies.GetWaitedFenceValue(timelineB), 2u);
+}
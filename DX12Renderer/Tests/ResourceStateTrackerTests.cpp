@@ -0,0 +1,175 @@
+// ResourceStateTrackerTests.cpp
+
+/**
+ * Tests of the barrier coalescing and the read state merging of the ResourceStateTracker.
+ * The resources are never dereferenced, so any distinct pointer will do.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "Application/Resources/ResourceStateTracker.h"
+
+// Standard library includes
+#include <cstdint>
+
+using DDM::ResourceStateTracker;
+
+namespace
+{
+	ID3D12Resource* const ResourceA = reinterpret_cast<ID3D12Resource*>(uintptr_t(0x1000));
+	ID3D12Resource* const ResourceB = reinterpret_cast<ID3D12Resource*>(uintptr_t(0x2000));
+
+	bool IsTransition(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource, UINT subresource,
+		D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+	{
+		return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION
+			&& barrier.Transition.pResource == resource
+			&& barrier.Transition.Subresource == subresource
+			&& barrier.Transition.StateBefore == stateBefore
+			&& barrier.Transition.StateAfter == stateAfter;
+	}
+}
+
+TEST_CASE(CoalesceMergesChainOfTransitions)
+{
+	// A->B followed by B->C becomes A->C.
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	REQUIRE(barriers.size() == 1);
+	CHECK(IsTransition(barriers[0], ResourceA, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
+
+TEST_CASE(CoalesceDropsChainBackToTheFirstState)
+{
+	// A->B followed by B->A is not a transition at all.
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	CHECK(barriers.empty());
+}
+
+TEST_CASE(CoalesceMergesAcrossOtherResources)
+{
+	// The transitions of another resource in between do not stop the chain.
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceB, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	REQUIRE(barriers.size() == 2);
+	CHECK(IsTransition(barriers[0], ResourceA, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
+	CHECK(IsTransition(barriers[1], ResourceB, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER));
+}
+
+TEST_CASE(CoalesceKeepsSubresourcesApart)
+{
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE, 0),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 1),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	CHECK(barriers.size() == 2);
+}
+
+TEST_CASE(CoalesceDoesNotMergeAcrossUAVBarrier)
+{
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+		CD3DX12_RESOURCE_BARRIER::UAV(ResourceA),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	REQUIRE(barriers.size() == 3);
+	CHECK(IsTransition(barriers[0], ResourceA, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	CHECK(barriers[1].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV);
+	CHECK(IsTransition(barriers[2], ResourceA, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
+
+TEST_CASE(CoalesceDoesNotMergeAcrossAliasingBarrier)
+{
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+		CD3DX12_RESOURCE_BARRIER::Aliasing(ResourceB, ResourceA),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	REQUIRE(barriers.size() == 3);
+	CHECK(barriers[1].Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING);
+}
+
+TEST_CASE(CoalesceDoesNotMergeSplitBarriers)
+{
+	// Neither the begin and end halves of a split transition, nor a transition that
+	// follows the end of one, are merged.
+	ResourceStateTracker::ResourceBarriers barriers =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+			D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceB, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(ResourceB, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+			D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY),
+	};
+
+	ResourceStateTracker::CoalesceResourceBarriers(barriers);
+
+	REQUIRE(barriers.size() == 4);
+	CHECK(barriers[0].Flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+	CHECK(IsTransition(barriers[1], ResourceA, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	CHECK(barriers[3].Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+}
+
+TEST_CASE(CombineReadStatesMergesReadStates)
+{
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+		D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_INDEX_BUFFER),
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER);
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		D3D12_RESOURCE_STATE_COPY_SOURCE);
+}
+
+TEST_CASE(CombineReadStatesKeepsWriteAndCommonStates)
+{
+	// A write state replaces the read states, and the read states replace a write state.
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	// The common state is not a read state.
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		D3D12_RESOURCE_STATE_COPY_SOURCE);
+	CHECK_EQUAL(ResourceStateTracker::CombineReadStates(D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+		D3D12_RESOURCE_STATE_COMMON);
+}
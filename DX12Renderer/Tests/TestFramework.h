@@ -0,0 +1,74 @@
+// TestFramework.h
+
+/**
+ * A minimal test runner for the CPU tests of DX12Lib.
+ *
+ * TEST_CASE defines a test function that registers itself before main runs.
+ * CHECK and CHECK_EQUAL report a failure with its location and let the test
+ * continue, REQUIRE returns from the test when the condition does not hold.
+ */
+
+#ifndef _TEST_FRAMEWORK_
+#define _TEST_FRAMEWORK_
+
+// Standard library includes
+#include <cstdio>
+#include <vector>
+
+namespace DDM::Tests
+{
+	using TestFunction = void(*)();
+
+	struct TestCase
+	{
+		const char* Name;
+		TestFunction Function;
+	};
+
+	inline std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	// The number of failed checks of the test that is running.
+	inline int& GetNumFailedChecks()
+	{
+		static int numFailedChecks = 0;
+		return numFailedChecks;
+	}
+
+	struct TestRegistration
+	{
+		TestRegistration(const char* name, TestFunction function)
+		{
+			GetTestCases().push_back({ name, function });
+		}
+	};
+
+	inline bool ReportCheck(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed)
+		{
+			std::printf("%s(%d): check failed: %s\n", file, line, expression);
+			++GetNumFailedChecks();
+		}
+		return passed;
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const DDM::Tests::TestRegistration name##Registration(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	DDM::Tests::ReportCheck(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+#define CHECK_EQUAL(actual, expected) \
+	DDM::Tests::ReportCheck((actual) == (expected), #actual " == " #expected, __FILE__, __LINE__)
+
+#define REQUIRE(expression) \
+	do { if (!CHECK(expression)) return; } while (false)
+
+#endif // !_TEST_FRAMEWORK_
@@ -0,0 +1,34 @@
+// TestMain.cpp
+
+/**
+ * Runs all the registered test cases, the exit code is the number of failed tests.
+ */
+
+// File includes
+#include "TestFramework.h"
+
+// Standard library includes
+#include <cstdio>
+
+int main()
+{
+	int numFailedTests = 0;
+
+	for (const DDM::Tests::TestCase& testCase : DDM::Tests::GetTestCases())
+	{
+		DDM::Tests::GetNumFailedChecks() = 0;
+		testCase.Function();
+
+		bool passed = DDM::Tests::GetNumFailedChecks() == 0;
+		std::printf("[%s] %s\n", passed ? "  OK  " : " FAIL ", testCase.Name);
+
+		if (!passed)
+		{
+			++numFailedTests;
+		}
+	}
+
+	std::printf("%zu tests, %d failed\n", DDM::Tests::GetTestCases().size(), numFailedTests);
+
+	return numFailedTests;
+}
@@ -0,0 +1,107 @@
+// UploadBatchSchedulerTests.cpp
+
+/**
+ * Tests of how the UploadBatchScheduler groups uploads into batches and maps them to fence values.
+ */
+
+// File includes
+#include "TestFramework.h"
+#include "Application/UploadBatchScheduler.h"
+
+using DDM::UploadBatchScheduler;
+
+TEST_CASE(SchedulerAddsUploadsToTheOpenBatch)
+{
+	UploadBatchScheduler scheduler(1024, 8);
+	CHECK(!scheduler.HasOpenBatch());
+
+	CHECK_EQUAL(scheduler.AddUpload(100), 0u);
+	CHECK_EQUAL(scheduler.AddUpload(200), 0u);
+	CHECK(scheduler.HasOpenBatch());
+	CHECK_EQUAL(scheduler.GetOpenBatchSize(), 300u);
+	CHECK_EQUAL(scheduler.GetNumOpenBatchUploads(), 2u);
+	CHECK(!scheduler.IsBatchFull());
+
+	// The open batch has no fence value yet.
+	CHECK(!scheduler.IsSubmitted(0));
+	CHECK_EQUAL(scheduler.GetFenceValue(0), 0u);
+}
+
+TEST_CASE(SchedulerBatchIsFullAtEitherLimit)
+{
+	UploadBatchScheduler bySize(1024, 8);
+	bySize.AddUpload(1024);
+	CHECK(bySize.IsBatchFull());
+
+	UploadBatchScheduler byCount(1024, 2);
+	byCount.AddUpload(1);
+	CHECK(!byCount.IsBatchFull());
+	byCount.AddUpload(1);
+	CHECK(byCount.IsBatchFull());
+}
+
+TEST_CASE(SchedulerSubmitsBeforeUploadThatDoesNotFit)
+{
+	UploadBatchScheduler scheduler(1024, 8);
+
+	// An upload larger than a batch does not need an empty batch to be submitted first.
+	CHECK(!scheduler.MustSubmitBefore(4096));
+
+	scheduler.AddUpload(1000);
+	CHECK(!scheduler.MustSubmitBefore(24));
+	CHECK(scheduler.MustSubmitBefore(25));
+}
+
+TEST_CASE(SchedulerMapsBatchesToFenceValues)
+{
+	UploadBatchScheduler scheduler(1024, 8);
+
+	scheduler.AddUpload(10);
+	CHECK_EQUAL(scheduler.SubmitBatch(5), 0u);
+	CHECK(!scheduler.HasOpenBatch());
+	CHECK_EQUAL(scheduler.GetOpenBatchSize(), 0u);
+
+	CHECK_EQUAL(scheduler.AddUpload(10), 1u);
+	CHECK_EQUAL(scheduler.SubmitBatch(7), 1u);
+
+	CHECK(scheduler.IsSubmitted(0));
+	CHECK(scheduler.IsSubmitted(1));
+	CHECK(!scheduler.IsSubmitted(2));
+	CHECK_EQUAL(scheduler.GetFenceValue(0), 5u);
+	CHECK_EQUAL(scheduler.GetFenceValue(1), 7u);
+	CHECK_EQUAL(scheduler.GetOpenBatchIndex(), 2u);
+}
+
+TEST_CASE(SchedulerReleasedBatchesKeepACompletedFenceValue)
+{
+	UploadBatchScheduler scheduler(1024, 8);
+
+	scheduler.AddUpload(10);
+	scheduler.SubmitBatch(5);
+	scheduler.AddUpload(10);
+	scheduler.SubmitBatch(7);
+
+	// Only the first batch has completed.
+	scheduler.ReleaseCompletedBatches(6);
+	CHECK_EQUAL(scheduler.GetFenceValue(0), 5u);
+	CHECK_EQUAL(scheduler.GetFenceValue(1), 7u);
+
+	// Released batches report the fence value of the last released batch, which has completed as well.
+	scheduler.ReleaseCompletedBatches(7);
+	CHECK_EQUAL(scheduler.GetFenceValue(0), 7u);
+	CHECK_EQUAL(scheduler.GetFenceValue(1), 7u);
+}
+
+TEST_CASE(SchedulerInvalidBatchIsAlreadyComplete)
+{
+	UploadBatchScheduler scheduler(1024, 8);
+
+	// Nothing has been submitted, the invalid batch must not be mistaken for the open batch 0.
+	scheduler.AddUpload(10);
+	CHECK(scheduler.IsSubmitted(UploadBatchScheduler::InvalidBatchIndex));
+	CHECK_EQUAL(scheduler.GetFenceValue(UploadBatchScheduler::InvalidBatchIndex), 0u);
+
+	scheduler.SubmitBatch(5);
+	scheduler.ReleaseCompletedBatches(5);
+	CHECK_EQUAL(scheduler.GetFenceValue(UploadBatchScheduler::InvalidBatchIndex), 0u);
+}
@@ -7,6 +7,7 @@
 #include "Application/Application.h"
 #include "Helpers/Helpers.h"
 #include "Application/CommandList.h"
+#include "Application/UploadManager.h"
 #include "Application/DataTypes/Structs.h"
 #include "Includes/DXRHelpersIncludes.h"
 
@@ -76,14 +77,13 @@ DDM::Tutorial3::Tutorial3(const std::wstring& name, int width, int height, bool
 bool DDM::Tutorial3::LoadContent()
 {
     auto device = Application::Get().GetDevice();
-    auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-    auto commandList = commandQueue->GetCommandList();
-    auto d3dCommandList = commandList->GetGraphicsCommandList();
+    auto uploadManager = Application::Get().GetUploadManager();
 
-    m_pMesh1 = Mesh::CreateCube(*commandList);
+    // Both cubes are uploaded in the same batch on the copy queue.
+    m_pMesh1 = Mesh::CreateCube(*uploadManager);
     m_pMesh1->SetPosition(1.5f, 0, 0);
 
-    m_pMesh2 = Mesh::CreateCube(*commandList);
+    m_pMesh2 = Mesh::CreateCube(*uploadManager);
     m_pMesh2->SetPosition(-1.5f, 0, 0);
 
 
@@ -168,8 +168,10 @@ bool DDM::Tutorial3::LoadContent()
     };
     ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
 
-    auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-    commandQueue->WaitForFenceValue(fenceValue);
+    // The direct queue waits for the uploads on the GPU, the CPU does not block on the copy queue.
+    auto directQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    uploadManager->Wait(*directQueue, m_pMesh1->GetUploadTicket());
+    uploadManager->Wait(*directQueue, m_pMesh2->GetUploadTicket());
 
     m_ContentLoaded = true;
 